@@ -0,0 +1,678 @@
+// SPDX-License-Identifier: BSL-1.0
+
+/// E57FormatBench writes a deterministic set of synthetic E57 files, then times encoding, opening, metadata access,
+/// decoding (without the open), checksum-verified reads and blob I/O on them.  Every result is printed to stdout as
+/// one line of JSON, so runs before and after a change can be compared by a script.
+///
+/// Usage: E57FormatBench [--dir <directory>] [--points <count>] [--repeat <count>] [--keep]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "E57Format.h"
+
+using namespace e57;
+
+namespace
+{
+   using Clock = std::chrono::steady_clock;
+
+   /// Records given to each CompressedVectorWriter::write() and read into each buffer
+   constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+   /// Results that are otherwise unused are stored here, so their computation can't be optimized away
+   volatile uint32_t sink = 0;
+
+   struct Options
+   {
+      std::string dir = ".";
+      int64_t points = 1000000; /// points in each of the large corpus files
+      int repeat = 3;           /// runs of each measurement, the fastest is reported
+      bool keep = false;        /// leave the corpus files behind
+   };
+
+   enum FieldType
+   {
+      FIELD_FLOAT,
+      FIELD_SCALED_INTEGER,
+      FIELD_INTEGER,
+      FIELD_STRING
+   };
+
+   struct Field
+   {
+      ustring name;
+      FieldType type;
+      double minimum;
+      double maximum;
+   };
+
+   /// One synthetic file.  Every scan has the same prototype and point count.
+   struct Corpus
+   {
+      std::string name;
+      std::vector<Field> fields;
+      int64_t scanCount;
+      int64_t pointsPerScan;
+      int64_t columns;     /// for gridded scans, 0 otherwise
+      ustring subsetField; /// the single field read by the column-subset benchmark
+      std::string fileName;
+   };
+
+   double secondsSince( Clock::time_point start )
+   {
+      return std::chrono::duration<double>( Clock::now() - start ).count();
+   }
+
+   /// Print one result as a line of JSON
+   void report( const std::string &benchmark, const std::string &corpus, double seconds, uint64_t items,
+                uint64_t bytes )
+   {
+      const double itemsPerSecond = ( seconds > 0.0 ) ? items / seconds : 0.0;
+      const double mbPerSecond = ( seconds > 0.0 ) ? bytes / seconds / ( 1024.0 * 1024.0 ) : 0.0;
+
+      std::printf( "{\"benchmark\":\"%s\",\"corpus\":\"%s\",\"seconds\":%.6f,\"items\":%llu,\"bytes\":%llu,"
+                   "\"items_per_s\":%.1f,\"mb_per_s\":%.3f}\n",
+                   benchmark.c_str(), corpus.c_str(), seconds, static_cast<unsigned long long>( items ),
+                   static_cast<unsigned long long>( bytes ), itemsPerSecond, mbPerSecond );
+      std::fflush( stdout );
+   }
+
+   /// Run a measurement several times, and return the fastest
+   template <typename FUNC> double fastest( int repeat, FUNC func )
+   {
+      double best = 0.0;
+
+      for ( int i = 0; i < repeat; ++i )
+      {
+         const auto start = Clock::now();
+
+         func();
+
+         const double seconds = secondsSince( start );
+
+         if ( i == 0 || seconds < best )
+         {
+            best = seconds;
+         }
+      }
+
+      return best;
+   }
+
+   uint64_t fileSize( const std::string &fileName )
+   {
+      std::ifstream file( fileName, std::ios::binary | std::ios::ate );
+
+      return file ? static_cast<uint64_t>( file.tellg() ) : 0;
+   }
+
+   /// Length of the XML section, from the file header
+   uint64_t xmlLength( const std::string &fileName )
+   {
+      std::ifstream file( fileName, std::ios::binary );
+      uint64_t length = 0;
+
+      /// xmlLogicalLength follows the signature, the versions, the file length and the XML offset
+      file.seekg( 32 );
+      file.read( reinterpret_cast<char *>( &length ), sizeof( length ) );
+
+      return length;
+   }
+
+   std::vector<Corpus> makeCorpora( const Options &options )
+   {
+      const Field x{ "cartesianX", FIELD_FLOAT, -100.0, 100.0 };
+      const Field y{ "cartesianY", FIELD_FLOAT, -100.0, 100.0 };
+      const Field z{ "cartesianZ", FIELD_FLOAT, -10.0, 10.0 };
+
+      const Field scaledX{ "cartesianX", FIELD_SCALED_INTEGER, -100.0, 100.0 };
+      const Field scaledY{ "cartesianY", FIELD_SCALED_INTEGER, -100.0, 100.0 };
+      const Field scaledZ{ "cartesianZ", FIELD_SCALED_INTEGER, -10.0, 10.0 };
+
+      const int64_t columns = 1000;
+      const int64_t griddedPoints = std::max<int64_t>( options.points / columns, 1 ) * columns;
+
+      std::vector<Corpus> corpora;
+
+      corpora.push_back( { "float_xyz", { x, y, z }, 1, options.points, 0, "cartesianX", "" } );
+      corpora.push_back( { "scaled_xyz_intensity_rgb",
+                           { scaledX,
+                             scaledY,
+                             scaledZ,
+                             { "intensity", FIELD_INTEGER, 0.0, 4095.0 },
+                             { "colorRed", FIELD_INTEGER, 0.0, 255.0 },
+                             { "colorGreen", FIELD_INTEGER, 0.0, 255.0 },
+                             { "colorBlue", FIELD_INTEGER, 0.0, 255.0 } },
+                           1,
+                           options.points,
+                           0,
+                           "intensity",
+                           "" } );
+      corpora.push_back( { "gridded",
+                           { { "rowIndex", FIELD_INTEGER, 0.0, static_cast<double>( griddedPoints / columns - 1 ) },
+                             { "columnIndex", FIELD_INTEGER, 0.0, static_cast<double>( columns - 1 ) },
+                             { "sphericalRange", FIELD_FLOAT, 0.0, 200.0 },
+                             { "sphericalAzimuth", FIELD_FLOAT, -3.15, 3.15 },
+                             { "sphericalElevation", FIELD_FLOAT, -1.58, 1.58 } },
+                           1,
+                           griddedPoints,
+                           columns,
+                           "sphericalRange",
+                           "" } );
+      corpora.push_back( { "strings",
+                           { x, y, z, { "label", FIELD_STRING, 0.0, 0.0 } },
+                           1,
+                           std::max<int64_t>( options.points / 10, 1 ),
+                           0,
+                           "label",
+                           "" } );
+      corpora.push_back( { "many_small_scans", { x, y, z }, 1000, 256, 0, "cartesianX", "" } );
+
+      for ( auto &corpus : corpora )
+      {
+         corpus.fileName = options.dir + "/E57FormatBench_" + corpus.name + ".e57";
+      }
+
+      return corpora;
+   }
+
+   Node makePrototypeField( ImageFile imf, const Field &field )
+   {
+      switch ( field.type )
+      {
+         case FIELD_FLOAT:
+            return FloatNode( imf, 0.0, E57_SINGLE, field.minimum, field.maximum );
+
+         case FIELD_SCALED_INTEGER:
+            return ScaledIntegerNode( imf, 0.0, field.minimum, field.maximum, 0.0001 );
+
+         case FIELD_INTEGER:
+            return IntegerNode( imf, 0, static_cast<int64_t>( field.minimum ), static_cast<int64_t>( field.maximum ) );
+
+         case FIELD_STRING:
+         default:
+            return StringNode( imf );
+      }
+   }
+
+   /// Buffers for every field of a corpus, used for writing and for reading
+   struct Buffers
+   {
+      std::vector<std::vector<double>> numbers;  /// one per field, empty for string fields
+      std::vector<std::vector<ustring>> strings; /// one per field, empty for numeric fields
+
+      Buffers( const Corpus &corpus, size_t capacity ) :
+         numbers( corpus.fields.size() ), strings( corpus.fields.size() )
+      {
+         for ( size_t i = 0; i < corpus.fields.size(); ++i )
+         {
+            if ( corpus.fields[i].type == FIELD_STRING )
+            {
+               strings[i].resize( capacity );
+            }
+            else
+            {
+               numbers[i].resize( capacity );
+            }
+         }
+      }
+
+      /// Buffers of one field, or of all fields if only is empty
+      std::vector<SourceDestBuffer> sourceDest( ImageFile imf, const Corpus &corpus, const ustring &only = ustring() )
+      {
+         std::vector<SourceDestBuffer> buffers;
+
+         for ( size_t i = 0; i < corpus.fields.size(); ++i )
+         {
+            const ustring &name = corpus.fields[i].name;
+
+            if ( !only.empty() && name != only )
+            {
+               continue;
+            }
+
+            if ( corpus.fields[i].type == FIELD_STRING )
+            {
+               buffers.emplace_back( imf, name, &strings[i] );
+            }
+            else
+            {
+               buffers.emplace_back( imf, name, numbers[i].data(), numbers[i].size(), true, true );
+            }
+         }
+
+         return buffers;
+      }
+
+      /// Fill the first count records with values of the points starting at first
+      void generate( const Corpus &corpus, std::mt19937 &random, int64_t first, size_t count )
+      {
+         std::uniform_real_distribution<double> unit( 0.0, 1.0 );
+
+         for ( size_t i = 0; i < corpus.fields.size(); ++i )
+         {
+            const Field &field = corpus.fields[i];
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+               const int64_t point = first + static_cast<int64_t>( j );
+
+               if ( field.type == FIELD_STRING )
+               {
+                  strings[i][j] = "point" + std::to_string( point % 97 );
+               }
+               else if ( field.name == "rowIndex" )
+               {
+                  numbers[i][j] = static_cast<double>( point / corpus.columns );
+               }
+               else if ( field.name == "columnIndex" )
+               {
+                  numbers[i][j] = static_cast<double>( point % corpus.columns );
+               }
+               else if ( field.type == FIELD_INTEGER )
+               {
+                  const double value = field.minimum + ( field.maximum - field.minimum + 1.0 ) * unit( random );
+
+                  numbers[i][j] = std::min( std::floor( value ), field.maximum );
+               }
+               else
+               {
+                  numbers[i][j] = field.minimum + ( field.maximum - field.minimum ) * unit( random );
+               }
+            }
+         }
+      }
+   };
+
+   void writeCorpus( const Corpus &corpus )
+   {
+      ImageFile imf( corpus.fileName, "w" );
+      StructureNode root = imf.root();
+
+      root.set( "formatName", StringNode( imf, "ASTM E57 3D Imaging Data File" ) );
+      root.set( "guid", StringNode( imf, "{E57FormatBench-" + corpus.name + "}" ) );
+      root.set( "versionMajor", IntegerNode( imf, 1 ) );
+      root.set( "versionMinor", IntegerNode( imf, 0 ) );
+
+      VectorNode data3D( imf, true );
+      root.set( "data3D", data3D );
+      root.set( "images2D", VectorNode( imf, true ) );
+
+      /// The same seed every run, so the files are identical
+      std::mt19937 random( 57 );
+      Buffers buffers( corpus, BLOCK_SIZE );
+
+      for ( int64_t scan = 0; scan < corpus.scanCount; ++scan )
+      {
+         StructureNode scanNode( imf );
+         scanNode.set( "guid", StringNode( imf, "{E57FormatBench-scan-" + std::to_string( scan ) + "}" ) );
+         scanNode.set( "name", StringNode( imf, "scan " + std::to_string( scan ) ) );
+
+         StructureNode prototype( imf );
+         for ( const auto &field : corpus.fields )
+         {
+            prototype.set( field.name, makePrototypeField( imf, field ) );
+         }
+
+         CompressedVectorNode points( imf, prototype, VectorNode( imf, true ) );
+         scanNode.set( "points", points );
+         data3D.append( scanNode );
+
+         std::vector<SourceDestBuffer> sbufs = buffers.sourceDest( imf, corpus );
+         CompressedVectorWriter writer = points.writer( sbufs );
+
+         for ( int64_t first = 0; first < corpus.pointsPerScan; first += BLOCK_SIZE )
+         {
+            const auto count = static_cast<size_t>( std::min<int64_t>( BLOCK_SIZE, corpus.pointsPerScan - first ) );
+
+            buffers.generate( corpus, random, first, count );
+            writer.write( count );
+         }
+
+         writer.close();
+      }
+
+      imf.close();
+   }
+
+   /// Read every scan of an open corpus file, all fields or just one.  Returns the number of points read.
+   uint64_t readCorpus( ImageFile imf, const Corpus &corpus, const ustring &only )
+   {
+      const VectorNode data3D( imf.root().get( "data3D" ) );
+      Buffers buffers( corpus, BLOCK_SIZE );
+      uint64_t pointCount = 0;
+
+      for ( int64_t scan = 0; scan < data3D.childCount(); ++scan )
+      {
+         const StructureNode scanNode( data3D.get( scan ) );
+         CompressedVectorNode points( scanNode.get( "points" ) );
+
+         std::vector<SourceDestBuffer> dbufs = buffers.sourceDest( imf, corpus, only );
+         CompressedVectorReader reader = points.reader( dbufs );
+
+         unsigned count = 0;
+         while ( ( count = reader.read() ) > 0 )
+         {
+            pointCount += count;
+         }
+
+         reader.close();
+      }
+
+      return pointCount;
+   }
+
+   /// Time readCorpus() without opening the file, so changes to the XML parser and to decoding show up separately.
+   /// Returns the fastest run.
+   double timeDecode( const Options &options, const Corpus &corpus, const ustring &only, uint64_t &pointCount,
+                      uint64_t &bytesRead )
+   {
+      double best = 0.0;
+
+      for ( int i = 0; i < options.repeat; ++i )
+      {
+         ImageFile imf( corpus.fileName, "r" );
+
+         /// Enabled after the open, so only the bytes of the binary sections are counted
+         imf.setStatisticsEnabled( true );
+
+         const auto start = Clock::now();
+
+         pointCount = readCorpus( imf, corpus, only );
+
+         const double seconds = secondsSince( start );
+
+         bytesRead = imf.statistics().bytesRead;
+         imf.close();
+
+         if ( i == 0 || seconds < best )
+         {
+            best = seconds;
+         }
+      }
+
+      return best;
+   }
+
+   /// Visit every node of the metadata tree.  Returns the number of nodes.
+   uint64_t walk( const Node &node )
+   {
+      uint64_t count = 1;
+
+      switch ( node.type() )
+      {
+         case E57_STRUCTURE:
+         {
+            const StructureNode structure( node );
+            for ( int64_t i = 0; i < structure.childCount(); ++i )
+            {
+               count += walk( structure.get( i ) );
+            }
+            break;
+         }
+
+         case E57_VECTOR:
+         {
+            const VectorNode vector( node );
+            for ( int64_t i = 0; i < vector.childCount(); ++i )
+            {
+               count += walk( vector.get( i ) );
+            }
+            break;
+         }
+
+         case E57_COMPRESSED_VECTOR:
+            count += walk( CompressedVectorNode( node ).prototype() );
+            break;
+
+         default:
+            /// Touch the name, so leaves cost something like a real metadata reader
+            sink = sink + static_cast<uint32_t>( node.elementName().size() );
+            break;
+      }
+
+      return count;
+   }
+
+   void benchmarkCorpus( const Options &options, const Corpus &corpus )
+   {
+      const uint64_t totalPoints = static_cast<uint64_t>( corpus.scanCount * corpus.pointsPerScan );
+
+      const double encodeSeconds = fastest( options.repeat, [&] { writeCorpus( corpus ); } );
+      const uint64_t size = fileSize( corpus.fileName );
+
+      report( "encode", corpus.name, encodeSeconds, totalPoints, size );
+
+      /// Opening parses the whole XML section, so report its rate
+      const double openSeconds = fastest( options.repeat, [&] {
+         ImageFile imf( corpus.fileName, "r" );
+         imf.close();
+      } );
+
+      report( "open", corpus.name, openSeconds, 1, xmlLength( corpus.fileName ) );
+
+      uint64_t nodeCount = 0;
+      const double walkSeconds = fastest( options.repeat, [&] {
+         ImageFile imf( corpus.fileName, "r" );
+         nodeCount = walk( imf.root() );
+         imf.close();
+      } );
+
+      report( "metadata_walk", corpus.name, walkSeconds, nodeCount, 0 );
+
+      uint64_t bytesRead = 0;
+      uint64_t pointCount = 0;
+      const double decodeSeconds = timeDecode( options, corpus, ustring(), pointCount, bytesRead );
+
+      report( "decode", corpus.name, decodeSeconds, pointCount, bytesRead );
+
+      const double subsetSeconds = timeDecode( options, corpus, corpus.subsetField, pointCount, bytesRead );
+
+      report( "decode_subset", corpus.name, subsetSeconds, pointCount, bytesRead );
+   }
+
+   /// Page checksums, through the library's own read path: the same blob is read with every page verified and
+   /// with none, and the difference is the cost of verifying.
+   void benchmarkChecksum( const Options &options )
+   {
+      const std::string fileName = options.dir + "/E57FormatBench_checksum.e57";
+      const size_t blockSize = 1024 * 1024;
+      const int64_t byteCount = std::max<int64_t>( options.points * 16, blockSize );
+
+      std::vector<uint8_t> block( blockSize );
+      std::mt19937 random( 57 );
+      std::generate( block.begin(), block.end(), [&random] { return static_cast<uint8_t>( random() ); } );
+
+      {
+         ImageFile imf( fileName, "w" );
+         BlobNode blob( imf, byteCount );
+         imf.root().set( "blob", blob );
+
+         for ( int64_t start = 0; start < byteCount; start += blockSize )
+         {
+            blob.write( block.data(), start, static_cast<size_t>( std::min<int64_t>( blockSize, byteCount - start ) ) );
+         }
+
+         imf.close();
+      }
+
+      /// Returns the fastest read of the whole blob, not counting the open
+      uint64_t pagesVerified = 0;
+      auto timeRead = [&]( ReadChecksumPolicy policy ) {
+         double best = 0.0;
+
+         for ( int i = 0; i < options.repeat; ++i )
+         {
+            ImageFile imf( fileName, "r", policy );
+            BlobNode blob( imf.root().get( "blob" ) );
+
+            imf.setStatisticsEnabled( true );
+
+            const auto start = Clock::now();
+
+            for ( int64_t first = 0; first < byteCount; first += blockSize )
+            {
+               blob.read( block.data(), first,
+                          static_cast<size_t>( std::min<int64_t>( blockSize, byteCount - first ) ) );
+            }
+
+            const double seconds = secondsSince( start );
+
+            pagesVerified = imf.statistics().pagesVerified;
+            imf.close();
+
+            if ( i == 0 || seconds < best )
+            {
+               best = seconds;
+            }
+         }
+
+         return best;
+      };
+
+      const double allSeconds = timeRead( CHECKSUM_POLICY_ALL );
+      const uint64_t pageCount = pagesVerified;
+
+      report( "read_checksum_all", "blob", allSeconds, pageCount, static_cast<uint64_t>( byteCount ) );
+
+      const double noneSeconds = timeRead( CHECKSUM_POLICY_NONE );
+
+      report( "read_checksum_none", "blob", noneSeconds, pagesVerified, static_cast<uint64_t>( byteCount ) );
+
+      report( "checksum", "pages", std::max( allSeconds - noneSeconds, 0.0 ), pageCount,
+              static_cast<uint64_t>( byteCount ) );
+
+      if ( !options.keep )
+      {
+         std::remove( fileName.c_str() );
+      }
+   }
+
+   void benchmarkBlob( const Options &options )
+   {
+      const std::string fileName = options.dir + "/E57FormatBench_blob.e57";
+      const size_t blockSize = 1024 * 1024;
+      const int64_t byteCount = std::max<int64_t>( options.points * 16, blockSize );
+
+      std::vector<uint8_t> block( blockSize );
+      std::mt19937 random( 57 );
+      std::generate( block.begin(), block.end(), [&random] { return static_cast<uint8_t>( random() ); } );
+
+      const double writeSeconds = fastest( options.repeat, [&] {
+         ImageFile imf( fileName, "w" );
+         BlobNode blob( imf, byteCount );
+         imf.root().set( "blob", blob );
+
+         for ( int64_t start = 0; start < byteCount; start += blockSize )
+         {
+            blob.write( block.data(), start, static_cast<size_t>( std::min<int64_t>( blockSize, byteCount - start ) ) );
+         }
+
+         imf.close();
+      } );
+
+      report( "blob_write", "blob", writeSeconds, 1, static_cast<uint64_t>( byteCount ) );
+
+      const double readSeconds = fastest( options.repeat, [&] {
+         ImageFile imf( fileName, "r" );
+         BlobNode blob( imf.root().get( "blob" ) );
+
+         for ( int64_t start = 0; start < byteCount; start += blockSize )
+         {
+            blob.read( block.data(), start, static_cast<size_t>( std::min<int64_t>( blockSize, byteCount - start ) ) );
+         }
+
+         imf.close();
+      } );
+
+      report( "blob_read", "blob", readSeconds, 1, static_cast<uint64_t>( byteCount ) );
+
+      if ( !options.keep )
+      {
+         std::remove( fileName.c_str() );
+      }
+   }
+
+   bool parseOptions( int argc, char **argv, Options &options )
+   {
+      for ( int i = 1; i < argc; ++i )
+      {
+         const std::string arg = argv[i];
+         const bool hasValue = ( i + 1 < argc );
+
+         if ( arg == "--dir" && hasValue )
+         {
+            options.dir = argv[++i];
+         }
+         else if ( arg == "--points" && hasValue )
+         {
+            options.points = std::max<int64_t>( std::atoll( argv[++i] ), 1 );
+         }
+         else if ( arg == "--repeat" && hasValue )
+         {
+            options.repeat = std::max( std::atoi( argv[++i] ), 1 );
+         }
+         else if ( arg == "--keep" )
+         {
+            options.keep = true;
+         }
+         else
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+}
+
+int main( int argc, char **argv )
+{
+   Options options;
+
+   if ( !parseOptions( argc, argv, options ) )
+   {
+      std::cerr << "Usage: " << argv[0] << " [--dir <directory>] [--points <count>] [--repeat <count>] [--keep]"
+                << std::endl;
+      return 2;
+   }
+
+   try
+   {
+      for ( const auto &corpus : makeCorpora( options ) )
+      {
+         benchmarkCorpus( options, corpus );
+
+         if ( !options.keep )
+         {
+            std::remove( corpus.fileName.c_str() );
+         }
+      }
+
+      benchmarkChecksum( options );
+      benchmarkBlob( options );
+   }
+   catch ( E57Exception &ex )
+   {
+      ex.report( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ), std::cerr );
+      return 1;
+   }
+   catch ( std::exception &ex )
+   {
+      std::cerr << "Got an std::exception, what=" << ex.what() << std::endl;
+      return 1;
+   }
+
+   return 0;
+}
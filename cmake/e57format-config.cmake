@@ -1,5 +1,6 @@
 include(CMakeFindDependencyMacro)
 
+find_dependency(Threads REQUIRED)
 find_dependency(XercesC REQUIRED)
 include(${CMAKE_CURRENT_LIST_DIR}/E57Format-export.cmake)
 
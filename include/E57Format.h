@@ -32,6 +32,7 @@
 //! @file  E57Format.h header file for the E57 API
 
 #include <cfloat>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -102,6 +103,98 @@ namespace e57
    //! Verify all checksums. This is the default. (slow)
    constexpr ReadChecksumPolicy CHECKSUM_POLICY_ALL = 100;
 
+   //! @brief Specifies how a CompressedVectorWriter lays out bytestreams in data packets.
+   using PacketLayoutPolicy = int;
+
+   //! Every data packet holds a proportional share of every bytestream. This is the default.
+   constexpr PacketLayoutPolicy PACKET_LAYOUT_INTERLEAVED = 0;
+   //! Each data packet is filled by as few bytestreams as possible, the rest have zero-length buffers.
+   //! Readers of a subset of fields can then skip most of the file.
+   constexpr PacketLayoutPolicy PACKET_LAYOUT_COLUMNAR = 1;
+
+   //! @brief Specifies which parser reads the XML section of an ImageFile opened for reading.
+   using XmlParserPolicy = int;
+
+   //! The parser selected when the library was built, Xerces-C unless the E57_BUILTIN_XML_PARSER CMake option is on.
+   //! This is the default.
+   constexpr XmlParserPolicy XML_PARSER_DEFAULT = 0;
+   //! Xerces-C, with schema validation.
+   constexpr XmlParserPolicy XML_PARSER_XERCES = 1;
+   //! Built-in non-validating UTF-8 parser of the subset of XML written in E57 files. (fast)
+   constexpr XmlParserPolicy XML_PARSER_BUILTIN = 2;
+
+   //! @brief Controls the threads and memory the library uses for work on an ImageFile
+   //! @details Set on an ImageFile with ImageFile::setExecutionContext() or when it is opened, or passed to e57::Reader
+   //! and e57::Writer.
+   struct E57_DLL ExecutionContext
+   {
+      //! Runs a task on some thread. The task must be run exactly once, and may be run after a later task.
+      using Executor = std::function<void( std::function<void()> task )>;
+
+      //! Most threads working on one call, including the calling thread, or 0 for the number of hardware threads
+      unsigned threadCount{ 0 };
+
+      //! Runs the library's parallel work on the caller's thread pool instead of threads of its own. Tasks that
+      //! haven't started when the calling thread has finished the work do nothing, so a busy pool doesn't block.
+      Executor executor;
+
+      //! Most bytes of buffers allocated at once for parallel work on the file, or 0 for no limit. It also limits the
+      //! data packets CompressedVectorWriters keep in memory while another writer has the end of the file.
+      uint64_t memoryBudget{ 0 };
+
+      //! Whether points may be decoded ahead on a background thread (see e57::Data3DPointsAsyncReader)
+      bool prefetch{ true };
+
+      //! Parser of the XML section, used when an ImageFile is opened for reading with this context
+      XmlParserPolicy xmlParser{ XML_PARSER_DEFAULT };
+
+      //! Whether the children of the scans in /data3D and the images in /images2D are parsed when first accessed
+      //! instead of when the ImageFile is opened. Their XML is checked then too. Implies XML_PARSER_BUILTIN.
+      bool lazyMetadata{ false };
+   };
+
+   //! @brief Counters of the file I/O of an ImageFile (see ImageFile::statistics())
+   struct E57_DLL ImageFileStatistics
+   {
+      uint64_t bytesRead{ 0 };     //!< Logical bytes read, without checksums
+      uint64_t bytesWritten{ 0 };  //!< Logical bytes written, without checksums
+      uint64_t pagesRead{ 0 };     //!< Physical pages read from the file or buffer
+      uint64_t pagesWritten{ 0 };  //!< Physical pages written to the file
+      uint64_t pagesVerified{ 0 }; //!< Pages whose checksum was verified
+      uint64_t ioNanoseconds{ 0 }; //!< Time spent reading and writing pages, summed over all threads
+   };
+
+   //! @brief Counters of one bytestream of a CompressedVectorReader or CompressedVectorWriter
+   struct E57_DLL BytestreamStatistics
+   {
+      ustring pathName;             //!< Path name of the field in the prototype
+      uint64_t bytes{ 0 };          //!< Bytes consumed by the decoder, or produced by the encoder
+      uint64_t cpuNanoseconds{ 0 }; //!< Time spent decoding or encoding
+   };
+
+   //! @brief Counters of a CompressedVectorReader (see CompressedVectorReader::statistics())
+   struct E57_DLL CompressedVectorReaderStatistics
+   {
+      uint64_t packetsDecoded{ 0 };  //!< Data packets fed to the decoders
+      uint64_t cacheHits{ 0 };       //!< Packets found in the packet cache
+      uint64_t cacheMisses{ 0 };     //!< Packets read from the file
+      uint64_t cacheEvictions{ 0 };  //!< Cached packets replaced by another one
+      uint64_t recordsProduced{ 0 }; //!< Records returned by read()
+      uint64_t ioNanoseconds{ 0 };   //!< Time spent reading packets from the file
+
+      std::vector<BytestreamStatistics> bytestreams; //!< One per buffer, in the order of the reader's buffers
+   };
+
+   //! @brief Counters of a CompressedVectorWriter (see CompressedVectorWriter::statistics())
+   struct E57_DLL CompressedVectorWriterStatistics
+   {
+      uint64_t packetsWritten{ 0 }; //!< Data packets written to the file, or spooled
+      uint64_t recordsWritten{ 0 }; //!< Records passed to write()
+      uint64_t ioNanoseconds{ 0 };  //!< Time spent writing packets, including waiting for other writers
+
+      std::vector<BytestreamStatistics> bytestreams; //!< One per bytestream, in the order of the prototype
+   };
+
    //! @brief The URI of ASTM E57 v1.0 standard XML namespace
    //! Note that even though this URI does not point to a valid document, the standard (section 8.4.2.3)
    //! says that this is the required namespace.
@@ -182,6 +275,24 @@ protected:
    class VectorNode;
    class VectorNodeImpl;
 
+   //! @brief A path name split into element names and checked once, for repeated lookups in a tree
+   //! @details Lookups with a PathName skip the parsing done for every lookup with a string. The prefixes of extended
+   //! element names are checked against the extensions of the ImageFile it is created with.
+   class E57_DLL PathName
+   {
+   public:
+      PathName( const ImageFile &imf, const ustring &pathName );
+
+      const ustring &str() const;
+      bool isRelative() const;
+      const std::vector<ustring> &elementNames() const;
+
+   private:
+      ustring pathName_;
+      bool isRelative_ = true;
+      std::vector<ustring> elementNames_;
+   };
+
    class E57_DLL Node
    {
    public:
@@ -221,8 +332,10 @@ protected:
 
       int64_t childCount() const;
       bool isDefined( const ustring &pathName ) const;
+      bool isDefined( const PathName &pathName ) const;
       Node get( int64_t index ) const;
       Node get( const ustring &pathName ) const;
+      Node get( const PathName &pathName ) const;
       void set( const ustring &pathName, const Node &n );
 
       // Up/Down cast conversion
@@ -264,8 +377,10 @@ protected:
 
       int64_t childCount() const;
       bool isDefined( const ustring &pathName ) const;
+      bool isDefined( const PathName &pathName ) const;
       Node get( int64_t index ) const;
       Node get( const ustring &pathName ) const;
+      Node get( const PathName &pathName ) const;
       void append( const Node &n );
 
       // Up/Down cast conversion
@@ -341,6 +456,57 @@ protected:
       //! \endcond
    };
 
+   //! @brief A range condition on one field, used to filter records read by a CompressedVectorReader.
+   //! @details A record passes if the value read for the field at @a pathName is in [@a minimum, @a maximum].
+   //! @see CompressedVectorReader::setFilter
+   struct E57_DLL ReadFilterCondition
+   {
+      ReadFilterCondition() = default;
+      ReadFilterCondition( const ustring &pathName, double minimum, double maximum );
+
+      ustring pathName;                //!< Path name of field, must match one of the reader's SourceDestBuffers
+      double minimum = E57_DOUBLE_MIN; //!< Smallest value accepted
+      double maximum = E57_DOUBLE_MAX; //!< Largest value accepted
+   };
+
+   //! @brief A run of consecutive records of a CompressedVectorNode, used to select records read by a
+   //! CompressedVectorReader.
+   //! @see CompressedVectorReader::setRecordRanges
+   struct E57_DLL RecordRange
+   {
+      RecordRange() = default;
+      RecordRange( uint64_t start, uint64_t count );
+
+      uint64_t start = 0; //!< Index of the first record of the run
+      uint64_t count = 0; //!< Number of records in the run
+   };
+
+   //! @brief A rigid transform applied to three coordinate fields, used to transform records read by a
+   //! CompressedVectorReader.
+   //! @details Each point (x, y, z) read from the fields is replaced by @a rotation * (x, y, z) + @a translation.
+   //! @see CompressedVectorReader::setTransform
+   struct E57_DLL ReadTransform
+   {
+      ustring xPathName = "cartesianX"; //!< Path name of X field, must match one of the reader's SourceDestBuffers
+      ustring yPathName = "cartesianY"; //!< Path name of Y field, must match one of the reader's SourceDestBuffers
+      ustring zPathName = "cartesianZ"; //!< Path name of Z field, must match one of the reader's SourceDestBuffers
+      double rotation[3][3] = { { 1., 0., 0. }, { 0., 1., 0. }, { 0., 0., 1. } }; //!< Row major rotation matrix
+      double translation[3] = { 0., 0., 0. }; //!< Added after the rotation
+
+      bool isIdentity() const;
+   };
+
+   //! @brief Names the spherical coordinate fields that a CompressedVectorReader converts to cartesian coordinates.
+   //! @details After conversion, the buffers for range, azimuth, and elevation hold X, Y, and Z.
+   //! @see CompressedVectorReader::setSphericalConversion
+   struct E57_DLL ReadSphericalConversion
+   {
+      ustring rangePathName = "sphericalRange";         //!< Path name of range field, its buffer receives X
+      ustring azimuthPathName = "sphericalAzimuth";     //!< Path name of azimuth field, its buffer receives Y
+      ustring elevationPathName = "sphericalElevation"; //!< Path name of elevation field, its buffer receives Z
+      ustring invalidStatePathName = "sphericalInvalidState"; //!< Path name of invalid state field, or empty
+   };
+
    class E57_DLL CompressedVectorReader
    {
    public:
@@ -348,10 +514,17 @@ protected:
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
+      void setFilter( const std::vector<ReadFilterCondition> &conditions );
+      void setDecimation( uint64_t interval );
+      void setRandomDecimation( double rate, uint64_t seed = 0 );
+      void setRecordRanges( const std::vector<RecordRange> &ranges );
+      void setTransform( const ReadTransform &transform );
+      void setSphericalConversion( const ReadSphericalConversion &conversion );
       void seek( int64_t recordNumber ); // !!! not implemented yet
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
+      CompressedVectorReaderStatistics statistics() const;
 
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
       void checkInvariant( bool doRecurse = true );
@@ -378,6 +551,7 @@ protected:
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
+      CompressedVectorWriterStatistics statistics() const;
 
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
       void checkInvariant( bool doRecurse = true );
@@ -405,7 +579,8 @@ protected:
       VectorNode codecs() const;
 
       // Iterators
-      CompressedVectorWriter writer( std::vector<SourceDestBuffer> &sbufs );
+      CompressedVectorWriter writer( std::vector<SourceDestBuffer> &sbufs,
+                                     PacketLayoutPolicy layout = PACKET_LAYOUT_INTERLEAVED );
       CompressedVectorReader reader( const std::vector<SourceDestBuffer> &dbufs );
 
       // Up/Down cast conversion
@@ -643,6 +818,12 @@ protected:
       ImageFile() = delete;
       ImageFile( const ustring &fname, const ustring &mode, ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
       ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
+      ImageFile( const ustring &fname, const ustring &mode, const ExecutionContext &context,
+                 ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
+      ImageFile( const char *input, const uint64_t size, const ExecutionContext &context,
+                 ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
+      explicit ImageFile( std::vector<char> &output );
+      ImageFile( std::vector<char> &output, const ExecutionContext &context );
 
       StructureNode root() const;
       void close();
@@ -653,6 +834,15 @@ protected:
       int writerCount() const;
       int readerCount() const;
 
+      // Threads and memory used for work on the file
+      void setExecutionContext( const ExecutionContext &context );
+      ExecutionContext executionContext() const;
+
+      // Performance counters, off by default
+      void setStatisticsEnabled( bool enabled );
+      bool statisticsEnabled() const;
+      ImageFileStatistics statistics() const;
+
       // Manipulate registered extensions in the file
       void extensionsAdd( const ustring &prefix, const ustring &uri );
       bool extensionsLookupPrefix( const ustring &prefix, ustring &uri ) const;
@@ -693,4 +883,17 @@ protected:
                                              // last in object
       //! \endcond
    };
+
+   //! @brief Chrome trace event output of the phases of reading and writing, for finding where time goes
+   namespace Trace
+   {
+      //! @brief True if the library was built with E57_ENABLE_TRACE
+      E57_DLL bool available();
+
+      //! @brief Record spans from all threads to a JSON file until stop()
+      E57_DLL bool start( const ustring &fileName );
+
+      //! @brief Stop recording, and complete the trace file
+      E57_DLL void stop();
+   }
 }
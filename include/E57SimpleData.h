@@ -31,6 +31,9 @@
 
 //! @file E57SimpleData.h Data structures for E57 Simple API
 
+#include <functional>
+#include <limits>
+
 #include "E57Format.h"
 
 namespace e57
@@ -435,6 +438,9 @@ namespace e57
    };
 
    //! @brief Stores pointers to user-provided buffers
+   //! @details When reading a scan that only has spherical coordinates, giving cartesianX/Y/Z buffers instead of the
+   //! spherical ones makes the reader convert the points to cartesian coordinates as they are decoded. A
+   //! cartesianInvalidState buffer then receives the sphericalInvalidState values.
    template <typename COORDTYPE = float> struct Data3DPointsData_t
    {
       COORDTYPE *cartesianX{
@@ -497,6 +503,100 @@ namespace e57
    typedef Data3DPointsData_t<float> Data3DPointsData;
    typedef Data3DPointsData_t<double> Data3DPointsData_d;
 
+   //! @brief Owns the buffers of a whole scan read by Reader::ReadData3DPoints()
+   //! @details The buffers are in one block of memory, which is freed with the object. Moving the object keeps the
+   //! buffers where they are.
+   template <typename COORDTYPE = float> struct Data3DPointsArrays_t
+   {
+      int64_t pointCount{ 0 };               //!< Number of points, which is the size of each buffer
+      Data3DPointsData_t<COORDTYPE> buffers; //!< Buffers of the fields that were read, the others are NULL
+      std::unique_ptr<double[]> storage;     //!< Memory holding the buffers
+   };
+
+   typedef Data3DPointsArrays_t<float> Data3DPointsArrays;
+   typedef Data3DPointsArrays_t<double> Data3DPointsArrays_d;
+
+   //! @brief Receives each scan read by Reader::ImportData3DPoints()
+   //! @details Called with the dataIndex of the scan and its points. The points may be moved out of the arrays to
+   //! keep them, otherwise they are freed when the callback returns.
+   template <typename COORDTYPE = float>
+   using Data3DPointsCallback_t = std::function<void( int64_t dataIndex, Data3DPointsArrays_t<COORDTYPE> &points )>;
+
+   typedef Data3DPointsCallback_t<float> Data3DPointsCallback;
+   typedef Data3DPointsCallback_t<double> Data3DPointsCallback_d;
+
+   //! @brief Selects the scans read by Reader::ImportData3DPoints() and how they are read
+   struct E57_DLL Data3DPointsImportOptions
+   {
+      std::vector<int64_t> dataIndices; //!< Scans to read, or empty to read all of them
+
+      //! Number of threads reading scans, or 0 for the threadCount of the file's ExecutionContext
+      unsigned threadCount{ 0 };
+
+      //! Most bytes of point buffers held at once, or 0 for the memoryBudget of the file's ExecutionContext. A scan
+      //! larger than this is read on its own.
+      uint64_t memoryBudget{ 0 };
+   };
+
+   //! @brief Selects which points are returned when reading 3D data (see Reader::SetUpData3DPointsData)
+   //! @details Points are tested right after they are decoded, and only passing points are stored in the buffers.
+   //! The fields used by a test must have buffers in the Data3DPointsData_t. Tests on fields that aren't in the
+   //! scan's prototype are ignored.
+   struct E57_DLL Data3DPointsFilter
+   {
+      CartesianBounds cartesianBounds; //!< Only return points inside this box (bounds are inclusive)
+
+      double timeMinimum{ -E57_DOUBLE_MAX }; //!< Only return points with timeStamp at or after this time
+      double timeMaximum{ E57_DOUBLE_MAX };  //!< Only return points with timeStamp at or before this time
+
+      bool rejectInvalidCartesian{ false }; //!< Only return points with cartesianInvalidState = 0
+      bool rejectInvalidIntensity{ false }; //!< Only return points with isIntensityInvalid = 0
+      bool rejectInvalidColor{ false };     //!< Only return points with isColorInvalid = 0
+   };
+
+   //! @brief Describes one field of the user's interleaved point records (see Data3DPointsLayout)
+   struct E57_DLL Data3DPointsField
+   {
+      Data3DPointsField() = default;
+      Data3DPointsField( const ustring &name, MemoryRepresentation type, size_t offset );
+
+      ustring name; //!< Element name in the points prototype, e.g. "cartesianX" or "nor:normalX"
+      MemoryRepresentation type{ E57_REAL32 }; //!< Type of the field in the record. E57_USTRING isn't allowed
+      size_t offset{ 0 };                      //!< Byte offset of the field from the start of the record
+   };
+
+   //! @brief Describes a user-provided array of interleaved (array of structures) point records
+   //! @details Lets points be read directly into (or written from) an array of the user's own structure, e.g.
+   //! struct Point { float x, y, z; uint8_t r, g, b; float i; }, without re-packing Data3DPointsData_t buffers.
+   //! Fields that aren't in the scan's prototype are ignored.
+   struct E57_DLL Data3DPointsLayout
+   {
+      void *records{ nullptr };              //!< pointer to the first record of the user-provided array
+      size_t stride{ 0 };                    //!< Size of one record in bytes (distance between consecutive records)
+      std::vector<Data3DPointsField> fields; //!< The fields to be read or written
+
+      //! @brief Returns a SourceDestBuffer for one field of the records, for use with the Foundation API
+      //! @param [in] imf the ImageFile the buffer is used with
+      //! @param [in] field one of fields
+      //! @param [in] count number of records in the user-provided array
+      //! @param [in] doScaling true to convert scaled integers to and from their scaled value
+      SourceDestBuffer sourceDestBuffer( ImageFile imf, const Data3DPointsField &field, size_t count,
+                                         bool doScaling ) const;
+   };
+
+   //! @brief Selects the rows and columns of a gridded scan to read as rasters (see Reader::ReadData3DPointsRaster)
+   //! @details Rows and columns are rowIndex and columnIndex values, and the bounds are inclusive.
+   struct E57_DLL Data3DPointsRasterWindow
+   {
+      int64_t rowMinimum{ -1 };    //!< First row to read, or negative for the scan's first row
+      int64_t rowMaximum{ -1 };    //!< Last row to read, or negative for the scan's last row
+      int64_t columnMinimum{ -1 }; //!< First column to read, or negative for the scan's first column
+      int64_t columnMaximum{ -1 }; //!< Last column to read, or negative for the scan's last column
+
+      //! Value of floating point fields in cells without a point
+      double sentinel{ std::numeric_limits<double>::quiet_NaN() };
+   };
+
    //! @brief Stores an image that is to be used only as a visual reference.
    struct E57_DLL VisualReferenceRepresentation
    {
@@ -650,4 +750,54 @@ namespace e57
       E57_CYLINDRICAL = 4    //!< CylindricalRepresentation for the image data
    };
 
+   //! @brief Describes one field of the points of a Data3D (see Data3DProbe)
+   struct E57_DLL Data3DProbeField
+   {
+      ustring name;               //!< Path name in the points prototype, e.g. "cartesianX" or "nor:normalX"
+      NodeType type{ E57_FLOAT }; //!< E57_INTEGER, E57_SCALED_INTEGER, E57_FLOAT or E57_STRING
+      int64_t minimum{ 0 };       //!< Smallest raw value of an E57_INTEGER or E57_SCALED_INTEGER
+      int64_t maximum{ 0 };       //!< Largest raw value of an E57_INTEGER or E57_SCALED_INTEGER
+      double scale{ 1. };         //!< Scale of an E57_SCALED_INTEGER
+      double offset{ 0. };        //!< Offset of an E57_SCALED_INTEGER
+      unsigned bitWidth{ 0 };     //!< Bits of each value in the file: 32 or 64 for floats, the bits needed for the
+                                  //!< range of integers, 0 for strings
+   };
+
+   //! @brief Summary of a Data3D read by Probe()
+   struct E57_DLL Data3DProbe
+   {
+      ustring name;                         //!< A user-defined name for the Data3D.
+      ustring guid;                         //!< A globally unique identification string for the Data3D
+      int64_t pointsSize{ 0 };              //!< Number of point records
+      std::vector<Data3DProbeField> fields; //!< The fields of each point record, in the order of the prototype
+      RigidBodyTransform pose;         //!< Coordinate frame of the scanner origin in the file-level coordinate system
+      IndexBounds indexBounds;         //!< The bounds of the row, column, and return number of the points
+      CartesianBounds cartesianBounds; //!< The bounds of the points in cartesian coordinates
+      SphericalBounds sphericalBounds; //!< The bounds of the points in spherical coordinates
+   };
+
+   //! @brief Summary of an Image2D read by Probe()
+   //! @details The sizes of the images and masks of a representation are the lengths of their blobs. Representations
+   //! that aren't in the file have all sizes 0.
+   struct E57_DLL Image2DProbe
+   {
+      ustring name;                 //!< A user-defined name for the Image2D.
+      ustring guid;                 //!< A globally unique identification string for the Image2D
+      ustring associatedData3DGuid; //!< The guid of the Data3D that was being acquired when the picture was taken
+      RigidBodyTransform pose;      //!< Coordinate frame of the camera in the file-level coordinate system
+
+      VisualReferenceRepresentation visualReferenceRepresentation; //!< Image for visual reference only
+      PinholeRepresentation pinholeRepresentation;         //!< Image using the pinhole camera projection model
+      SphericalRepresentation sphericalRepresentation;     //!< Image using the spherical camera projection model
+      CylindricalRepresentation cylindricalRepresentation; //!< Image using the cylindrical camera projection model
+   };
+
+   //! @brief Summary of an E57 file read by Probe() from its header and XML section only
+   struct E57_DLL FileProbe
+   {
+      E57Root root;                       //!< Information of the XML section, with the numbers of Data3D and Image2D
+      std::vector<Data3DProbe> data3D;    //!< One per Data3D, in order
+      std::vector<Image2DProbe> images2D; //!< One per Image2D, in order
+   };
+
 } // end namespace e57
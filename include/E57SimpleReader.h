@@ -35,6 +35,10 @@
 
 namespace e57
 {
+   //! @cond documentNonPublic   The following isn't part of the API, and isn't documented.
+   template <typename COORDTYPE> class Data3DPointsAsyncReader_t;
+   template <typename COORDTYPE> class Data3DPointsAsyncReaderImpl;
+   //! @endcond
 
    //! @brief Used for reading of the E57 file with E57 Simple API
    class E57_DLL Reader
@@ -43,6 +47,12 @@ namespace e57
       //! @brief This function is the constructor for the reader class
       //! @param [in] filePath file path to E57 file
       Reader( const ustring &filePath );
+
+      //! @brief This function is the constructor for the reader class
+      //! @param [in] filePath file path to E57 file
+      //! @param [in] context threads and memory used for reading the file
+      Reader( const ustring &filePath, const ExecutionContext &context );
+
       //! @brief This function returns true if the file is open
       bool IsOpen() const;
 
@@ -155,6 +165,141 @@ namespace e57
       CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                     const Data3DPointsData_d &buffers ) const;
 
+      //! @brief Use this function to read all the 3D points of a scan at once
+      //! @details The buffers are sized for the whole scan, and each field is decoded straight into its buffer by
+      //!          its own reader, with the readers running in parallel. Spherical coordinates are converted to the
+      //!          cartesian fields if those are asked for, as with SetUpData3DPointsData().
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] fields the fields to read, usually the Data3D pointFields
+      //! @param [out] points the buffers holding the points
+      //! @return Returns true if successful, false if dataIndex is out of range
+      bool ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                             Data3DPointsArrays &points ) const;
+
+      //! @brief Use this function to read all the 3D points of a scan at once
+      //! @details Same as above, with double coordinates.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] fields the fields to read, usually the Data3D pointFields
+      //! @param [out] points the buffers holding the points
+      //! @return Returns true if successful, false if dataIndex is out of range
+      bool ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                             Data3DPointsArrays_d &points ) const;
+
+      //! @brief Use this function to read the 3D points of many scans, several at a time
+      //! @details Scans are read on a pool of threads, the largest ones first, each into buffers sized for the whole
+      //!          scan holding the fields in its Data3D pointFields. Each scan is handed to the callback as soon as it
+      //!          is read. The callback is called on one of the pool's threads, but never for two scans at the same
+      //!          time, so it needs no locking of its own. A scan is only started when its buffers fit in the
+      //!          memory budget along with the scans being read or handed to the callback; a scan's memory counts
+      //!          until the callback returns. If reading a scan or the callback throws, no more scans are started
+      //!          and the exception is rethrown once the scans in progress are finished.
+      //! @param [in] options the scans to read, the number of threads and the memory budget
+      //! @param [in] callback receives each scan
+      //! @return Returns true if successful, false if a dataIndex is out of range
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options, const Data3DPointsCallback &callback ) const;
+
+      //! @brief Use this function to read the 3D points of many scans, several at a time
+      //! @details Same as above, with double coordinates.
+      //! @param [in] options the scans to read, the number of threads and the memory budget
+      //! @param [in] callback receives each scan
+      //! @return Returns true if successful, false if a dataIndex is out of range
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options, const Data3DPointsCallback_d &callback ) const;
+
+      //! @brief Use this function to read the 3D points of many scans into per-scan buffers, several at a time
+      //! @details Same as above, with each scan stored in scans instead of being handed to a callback. scans has
+      //!          one entry per dataIndex in options, in the same order, or one per Data3D if options has none. As
+      //!          all the scans are kept, the memory budget only limits how much is allocated while reading.
+      //! @param [in] options the scans to read, the number of threads and the memory budget
+      //! @param [out] scans the buffers holding the points of each scan
+      //! @return Returns true if successful, false if a dataIndex is out of range or given twice
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options, std::vector<Data3DPointsArrays> &scans ) const;
+
+      //! @brief Use this function to read the 3D points of many scans into per-scan buffers, several at a time
+      //! @details Same as above, with double coordinates.
+      //! @param [in] options the scans to read, the number of threads and the memory budget
+      //! @param [out] scans the buffers holding the points of each scan
+      //! @return Returns true if successful, false if a dataIndex is out of range or given twice
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options,
+                               std::vector<Data3DPointsArrays_d> &scans ) const;
+
+      //! @brief Use this function to read only the 3D points that pass a filter
+      //! @details All the non-NULL buffers in buffers have number of elements = pointCount.
+      //!          Call the CompressedVectorReader::read() until it returns 0. Each call fills the buffers with
+      //!          passing points, so it may have decoded many more points than it returns.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] pointCount size of each element buffer.
+      //! @param [in] buffers pointers to user-provided buffers
+      //! @param [in] filter tests that points must pass to be stored in the buffers
+      //! @return vector reader setup to read the selected data into the provided buffers
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsData &buffers,
+                                                    const Data3DPointsFilter &filter ) const;
+
+      //! @brief Use this function to read only the 3D points that pass a filter
+      //! @details All the non-NULL buffers in buffers have number of elements = pointCount.
+      //!          Call the CompressedVectorReader::read() until it returns 0. Each call fills the buffers with
+      //!          passing points, so it may have decoded many more points than it returns.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] pointCount size of each element buffer.
+      //! @param [in] buffers pointers to user-provided buffers
+      //! @param [in] filter tests that points must pass to be stored in the buffers
+      //! @return vector reader setup to read the selected data into the provided buffers
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsData_d &buffers,
+                                                    const Data3DPointsFilter &filter ) const;
+
+      //! @brief Use this function to read the actual 3D data into an array of the user's own point structure
+      //! @details The array described by layout has pointCount records. Each value is stored directly into its
+      //!          field of the record, so no re-packing is needed. Fields not in the scan are left untouched.
+      //!          Call the CompressedVectorReader::read() until all data is read.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] pointCount number of records in the user-provided array.
+      //! @param [in] layout describes the user-provided array and the fields of each record
+      //! @return vector reader setup to read the selected data into the provided records
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsLayout &layout ) const;
+
+      //! @brief Use this function to have a reader return cartesian points in the file's coordinate system
+      //! @details The Data3D pose, followed by extraTransform, is applied to cartesianX/Y/Z by each
+      //!          CompressedVectorReader::read() right after the points are decoded. The cartesian buffers must be all
+      //!          float or all double; use double to keep full resolution when the translation is large.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] reader a reader returned by SetUpData3DPointsData() for the same dataIndex
+      //! @param [in] extraTransform transform applied after the pose, e.g. into a project coordinate system
+      //!          For a scan with only spherical coordinates, the reader must convert them (see Data3DPointsData_t),
+      //!          otherwise E57_ERROR_BAD_API_ARGUMENT is thrown rather than transforming the spherical values.
+      //! @return Returns true if successful, false if the Data3D has no cartesian or spherical coordinates
+      bool SetUpData3DPointsPose( int64_t dataIndex, CompressedVectorReader &reader,
+                                  const RigidBodyTransform &extraTransform = RigidBodyTransform::identity() ) const;
+
+      //! @brief Use this function to read a gridded scan as an organized point cloud (range image)
+      //! @details Each non-NULL buffer in rasters is a row-major raster of the window, with
+      //!          (rowMaximum - rowMinimum + 1) * (columnMaximum - columnMinimum + 1) elements; the point at
+      //!          (row, column) is stored at element (row - rowMinimum) * columns + (column - columnMinimum). Cells
+      //!          without a point keep their "no point" value: window.sentinel for floating point fields, 2 for the
+      //!          cartesian and spherical invalid states, 1 for the other invalid flags, -1 for rowIndex and
+      //!          columnIndex and 0 for the other integer fields. Only the first return of each point is stored.
+      //!          If the scan has line groups, only the lines crossing the window are decoded.
+      //!          Spherical coordinates are converted as with SetUpData3DPointsData().
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] rasters pointers to user-provided rasters
+      //! @param [in] window the rows and columns to read. Bounds not given are taken from the scan's indexBounds,
+      //!          or start at 0 and span GetData3DSizes() if it has none.
+      //! @return Returns true if successful, false if the scan has no rowIndex and columnIndex or the window is
+      //!         empty
+      bool ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData &rasters,
+                                   const Data3DPointsRasterWindow &window = {} ) const;
+
+      //! @brief Use this function to read a gridded scan as an organized point cloud (range image)
+      //! @details Same as above, with double coordinates.
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] rasters pointers to user-provided rasters
+      //! @param [in] window the rows and columns to read, as above
+      //! @return Returns true if successful, false if the scan has no rowIndex and columnIndex or the window is
+      //!         empty
+      bool ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_d &rasters,
+                                   const Data3DPointsRasterWindow &window = {} ) const;
+
       //!@}
 
       //! @name Foundation API file information
@@ -178,9 +323,75 @@ namespace e57
       //! documented.
    protected:
       friend class ReaderImpl;
+      template <typename COORDTYPE> friend class Data3DPointsAsyncReader_t;
 
       E57_OBJECT_IMPLEMENTATION( Reader ) // Internal implementation details, not part of API, must be last in object
       //! @endcond
    }; // end Reader class
 
+   //! @brief Reads a summary of an E57 file without opening it
+   //! @details Only the file header and the XML section are read, and only the checksums of their pages are verified.
+   //!          The XML is scanned for the values in the summary instead of being parsed into a tree of nodes, which
+   //!          makes this much cheaper than opening the file, e.g. to triage files by their scans and images.
+   //! @param [in] filePath file path to E57 file
+   //! @param [in] checksumPolicy the percentage of the pages read whose checksum is verified
+   //! @return the summary of the file
+   E57_DLL FileProbe Probe( const ustring &filePath, ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
+
+   //! @brief Reads the 3D points of a scan on a background thread, so decoding overlaps processing
+   //! @details The points are decoded in batches into a fixed number of buffer sets, which bounds the memory used to
+   //! bufferCount * pointCount points. While the caller processes a batch it has acquired, the next batches are
+   //! decoded into the free sets:
+   //! @code
+   //! Data3DPointsAsyncReader async( reader, 0, 65536, data3DHeader.pointFields );
+   //! Data3DPointsData buffers;
+   //! while ( size_t count = async.acquire( buffers ) )
+   //! {
+   //!    process( buffers, count );
+   //!    async.release();
+   //! }
+   //! @endcode
+   //! The Reader may still be used to read other data of the file while points are being decoded.
+   //! If the file's ExecutionContext disables prefetch, no thread is started and each batch is decoded by acquire().
+   template <typename COORDTYPE = float> class E57_DLL Data3DPointsAsyncReader_t
+   {
+   public:
+      //! @brief Sets up an asynchronous read of the 3D data of a scan
+      //! @param [in] reader the reader of the E57 file
+      //! @param [in] dataIndex data block index given by the NewData3D
+      //! @param [in] pointCount maximum number of points in each batch
+      //! @param [in] fields the fields to read, usually the Data3D pointFields. Set cartesian fields of a scan with
+      //!             only spherical coordinates to have them converted (see Data3DPointsData_t).
+      //! @param [in] bufferCount number of buffer sets, at least 2
+      Data3DPointsAsyncReader_t( const Reader &reader, int64_t dataIndex, size_t pointCount,
+                                 const PointStandardizedFieldsAvailable &fields, size_t bufferCount = 2 );
+
+      //! @brief Returns the CompressedVectorReader that decodes the points, e.g. for Reader::SetUpData3DPointsPose()
+      //! @details Decoding starts with the first acquire(), so the reader may only be set up before then.
+      CompressedVectorReader compressedVectorReader() const;
+
+      //! @brief Waits for the next batch of points and hands it to the caller
+      //! @details The batch's buffers stay valid until it is released. Several batches may be held at once, but
+      //!          decoding stops until one is released if all bufferCount are held.
+      //! @param [out] buffers set to the buffers of the batch; buffers of fields that aren't read are NULL
+      //! @return number of points in the batch, or 0 when all points have been read
+      size_t acquire( Data3DPointsData_t<COORDTYPE> &buffers );
+
+      //! @brief Hands the oldest acquired batch back, so its buffers can be decoded into again
+      void release();
+
+      //! @cond documentNonPublic   The following isn't part of the API, and isn't documented.
+   protected:
+      std::shared_ptr<Data3DPointsAsyncReaderImpl<COORDTYPE>> impl_;
+      //! @endcond
+   };
+
+   typedef Data3DPointsAsyncReader_t<float> Data3DPointsAsyncReader;
+   typedef Data3DPointsAsyncReader_t<double> Data3DPointsAsyncReader_d;
+
+   //! @cond documentNonPublic   The following isn't part of the API, and isn't documented.
+   extern template class Data3DPointsAsyncReader_t<float>;
+   extern template class Data3DPointsAsyncReader_t<double>;
+   //! @endcond
+
 } // end namespace e57
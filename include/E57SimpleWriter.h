@@ -45,6 +45,25 @@ namespace e57
       //! @param [in] coordinateMetaData Information describing the Coordinate Reference System to be used for the file
       Writer( const ustring &filePath, const ustring &coordinateMetaData = {} );
 
+      //! @brief This function is the constructor for the writer class
+      //! @param [in] filePath file path to E57 file
+      //! @param [in] coordinateMetaData Information describing the Coordinate Reference System to be used for the file
+      //! @param [in] context threads and memory used for writing the file
+      Writer( const ustring &filePath, const ustring &coordinateMetaData, const ExecutionContext &context );
+
+      //! @brief This function is the constructor for a writer to memory
+      //! @param [in] output buffer the E57 file is written to, emptied first. It must outlive the writer, and holds
+      //! the complete file after Close().
+      //! @param [in] coordinateMetaData Information describing the Coordinate Reference System to be used for the file
+      Writer( std::vector<char> &output, const ustring &coordinateMetaData = {} );
+
+      //! @brief This function is the constructor for a writer to memory
+      //! @param [in] output buffer the E57 file is written to, emptied first. It must outlive the writer, and holds
+      //! the complete file after Close().
+      //! @param [in] coordinateMetaData Information describing the Coordinate Reference System to be used for the file
+      //! @param [in] context threads and memory used for writing the file
+      Writer( std::vector<char> &output, const ustring &coordinateMetaData, const ExecutionContext &context );
+
       //! @brief This function returns true if the file is open
       bool IsOpen() const;
 
@@ -99,6 +118,16 @@ namespace e57
       CompressedVectorWriter SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                     const Data3DPointsData_d &buffers );
 
+      //! @brief This function setups a writer to write the actual scan data from an array of the user's own point
+      //! structure
+      //! @details The layout must describe a field for every element of the scan's points prototype.
+      //! @param [in] dataIndex index returned by NewData3D
+      //! @param [in] pointCount Number of points to write (number of records in the user-provided array)
+      //! @param [in] layout describes the user-provided array and the fields of each record
+      //! @return returns a vector writer setup to write the selected scan data
+      CompressedVectorWriter SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsLayout &layout );
+
       //! @brief This function writes out the group data
       //! @param [in] dataIndex data block index given by the NewData3D
       //! @param [in] groupCount size of each of the buffers given
@@ -29,6 +29,7 @@
 #include "CheckedFile.h"
 #include "ImageFileImpl.h"
 #include "SectionHeaders.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -49,6 +50,15 @@ namespace e57
          binarySectionLogicalLength_ += 4 - remainder;
       }
 
+      std::lock_guard<std::mutex> lock( imf->writeMutex_ );
+
+      /// An open writer may be appending its section to the end of the file, which the blob would split
+      if ( imf->writerCount() > 0 )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS, "fileName=" + imf->fileName() + " writerCount=" +
+                                                              toString( imf->writerCount() ) );
+      }
+
       /// Reserve space for blob in file, extend with zeros since writes will
       /// happen at later time by caller
       binarySectionLogicalStart_ = imf->allocateSpace( binarySectionLogicalLength_, true );
@@ -132,9 +142,8 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->read( reinterpret_cast<char *>( buf ),
-                        static_cast<size_t>( count ) ); //??? arg1 void* ?
+      imf->file_->readAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                          reinterpret_cast<char *>( buf ), static_cast<size_t>( count ) );
    }
 
    void BlobNodeImpl::write( uint8_t *buf, int64_t start, size_t count )
@@ -161,6 +170,7 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
+      std::lock_guard<std::mutex> lock( imf->writeMutex_ );
       imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
       imf->file_->write( reinterpret_cast<char *>( buf ),
                          static_cast<size_t>( count ) ); //??? arg1 void* ?
@@ -178,7 +188,7 @@ namespace e57
       }
    }
 
-   void BlobNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, CheckedFile &cf, int indent,
+   void BlobNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, XmlWriter &xml, int indent,
                                 const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -190,15 +200,15 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
       //??? need to implement
       //??? Type --> type
       //??? need to have length?, check same as in section header?
-      uint64_t physicalOffset = cf.logicalToPhysical( binarySectionLogicalStart_ );
-      cf << space( indent ) << "<" << fieldName << " type=\"Blob\" fileOffset=\"" << physicalOffset << "\" length=\""
-         << blobLogicalLength_ << "\"/>\n";
+      uint64_t physicalOffset = CheckedFile::logicalToPhysical( binarySectionLogicalStart_ );
+      xml << space( indent ) << "<" << fieldName << " type=\"Blob\" fileOffset=\"" << physicalOffset << "\" length=\""
+          << blobLogicalLength_ << "\"/>\n";
    }
 
 #ifdef E57_DEBUG
@@ -59,6 +59,8 @@
 #include "CRC.h"
 
 #include "CheckedFile.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 //#define E57_CHECK_FILE_DEBUG
 #ifdef E57_CHECK_FILE_DEBUG
@@ -120,6 +122,17 @@ public:
       return true;
    }
 
+   bool readAt( char *buffer, uint64_t offset, uint64_t count ) const
+   {
+      if ( offset > streamSize_ || count > streamSize_ - offset )
+      {
+         return false;
+      }
+
+      memcpy( buffer, stream_ + offset, count );
+      return true;
+   }
+
    void read( char *buffer, uint64_t count )
    {
       const uint64_t start = cursorStream_;
@@ -136,6 +149,81 @@ private:
    const char *stream_;
 };
 
+/// Growable memory buffer written instead of a file, with the same
+/// cursor semantics: seeking past the end is allowed, and a write
+/// there zero fills the gap.
+///
+/// WARNING: the vector is owned by the user!
+class e57::WriteBuffer
+{
+public:
+   /// @param[IN] output: emptied, then holds the bytes written.
+   explicit WriteBuffer( std::vector<char> &output ) : output_( output )
+   {
+      output_.clear();
+   }
+
+   uint64_t pos() const
+   {
+      return cursor_;
+   }
+
+   bool seek( int64_t offset, int whence )
+   {
+      int64_t base = 0;
+
+      if ( whence == SEEK_CUR )
+      {
+         base = static_cast<int64_t>( cursor_ );
+      }
+      else if ( whence == SEEK_END )
+      {
+         base = static_cast<int64_t>( output_.size() );
+      }
+
+      if ( base + offset < 0 )
+      {
+         return false;
+      }
+
+      cursor_ = static_cast<uint64_t>( base + offset );
+      return true;
+   }
+
+   bool readAt( char *buffer, uint64_t offset, uint64_t count ) const
+   {
+      if ( offset > output_.size() || count > output_.size() - offset )
+      {
+         return false;
+      }
+
+      memcpy( buffer, output_.data() + offset, count );
+      return true;
+   }
+
+   void write( const char *buffer, uint64_t count )
+   {
+      /// resize() grows the capacity geometrically, so appending pages is amortized constant time
+      if ( cursor_ + count > output_.size() )
+      {
+         output_.resize( static_cast<size_t>( cursor_ + count ) );
+      }
+
+      memcpy( output_.data() + cursor_, buffer, count );
+      cursor_ += count;
+   }
+
+   void clear()
+   {
+      output_.clear();
+      cursor_ = 0;
+   }
+
+private:
+   std::vector<char> &output_;
+   uint64_t cursor_ = 0;
+};
+
 CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy policy ) :
    fileName_( fileName ), checkSumPolicy_( policy )
 {
@@ -178,6 +266,11 @@ CheckedFile::CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy p
    logicalLength_ = physicalToLogical( physicalLength_ );
 }
 
+CheckedFile::CheckedFile( std::vector<char> &output ) : fileName_( "<MemoryBuffer>" )
+{
+   writeBuffer_ = new WriteBuffer( output );
+}
+
 int CheckedFile::open64( const ustring &fileName, int flags, int mode )
 {
 #if defined( _MSC_VER )
@@ -220,11 +313,26 @@ CheckedFile::~CheckedFile()
 
 void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
 {
-   //??? what if read past logical end?, or physical end?
-   //??? need to keep track of logical length?
    //??? check bufSize OK
 
-   const uint64_t end = position( Logical ) + nRead;
+   const uint64_t start = position( Logical );
+
+   readAt( start, buf, nRead );
+
+   /// When done, leave cursor just past end of last byte read
+   seek( start + nRead, Logical );
+}
+
+void CheckedFile::readAt( uint64_t logicalOffset, char *buf, size_t nRead )
+{
+   /// Doesn't use or move the file cursor, so readers on several threads can share the file
+
+   if ( statisticsEnabled_ )
+   {
+      bytesRead_ += nRead;
+   }
+
+   const uint64_t end = logicalOffset + nRead;
    const uint64_t logicalLength = length( Logical );
 
    if ( end > logicalLength )
@@ -233,10 +341,8 @@ void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
                                                    " length=" + toString( logicalLength ) );
    }
 
-   uint64_t page = 0;
-   size_t pageOffset = 0;
-
-   getCurrentPageAndOffset( page, pageOffset );
+   uint64_t page = logicalOffset / logicalPageSize;
+   size_t pageOffset = static_cast<size_t>( logicalOffset - page * logicalPageSize );
 
    size_t n = std::min( nRead, logicalPageSize - pageOffset );
 
@@ -276,9 +382,6 @@ void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
 
       n = std::min( nRead, logicalPageSize );
    }
-
-   /// When done, leave cursor just past end of last byte read
-   seek( end, Logical );
 }
 
 void CheckedFile::write( const char *buf, size_t nWrite )
@@ -292,6 +395,11 @@ void CheckedFile::write( const char *buf, size_t nWrite )
       throw E57_EXCEPTION2( E57_ERROR_FILE_IS_READ_ONLY, "fileName=" + fileName_ );
    }
 
+   if ( statisticsEnabled_ )
+   {
+      bytesWritten_ += nWrite;
+   }
+
    uint64_t end = position( Logical ) + nWrite;
 
    uint64_t page = 0;
@@ -342,105 +450,6 @@ void CheckedFile::write( const char *buf, size_t nWrite )
    seek( end, Logical );
 }
 
-CheckedFile &CheckedFile::operator<<( const ustring &s )
-{
-   write( s.c_str(), s.length() ); //??? should be times size of uchar?
-   return ( *this );
-}
-
-CheckedFile &CheckedFile::operator<<( int64_t i )
-{
-   std::stringstream ss;
-   ss << i;
-   return ( *this << ss.str() );
-}
-
-CheckedFile &CheckedFile::operator<<( uint64_t i )
-{
-   std::stringstream ss;
-   ss << i;
-   return ( *this << ss.str() );
-}
-
-CheckedFile &CheckedFile::operator<<( float f )
-{
-   //??? is 7 digits right number?
-   return writeFloatingPoint( f, 7 );
-}
-
-CheckedFile &CheckedFile::operator<<( double d )
-{
-   //??? is 17 digits right number?
-   return writeFloatingPoint( d, 17 );
-}
-
-template <class FTYPE> CheckedFile &CheckedFile::writeFloatingPoint( FTYPE value, int precision )
-{
-#ifdef E57_MAX_VERBOSE
-   std::cout << "CheckedFile::writeFloatingPoint, value=" << value << " precision=" << precision << std::endl;
-#endif
-
-   std::stringstream ss;
-   ss << std::scientific << std::setprecision( precision ) << value;
-
-   /// Try to remove trailing zeroes and decimal point
-   /// E.g. 1.23456000000000000e+005  ==> 1.23456e+005
-   /// E.g. 2.00000000000000000e+005  ==> 2e+005
-
-   ustring s = ss.str();
-   const size_t len = s.length();
-
-#ifdef E57_MAX_DEBUG
-   ustring old_s = s;
-#endif
-
-   /// Split into mantissa and exponent
-   /// E.g. 1.23456000000000000e+005  ==> "1.23456000000000000" + "e+005"
-   ustring mantissa = s.substr( 0, len - 5 );
-   ustring exponent = s.substr( len - 5, 5 );
-
-   /// Double check that we understand the formatting
-   if ( exponent[0] == 'e' )
-   {
-      /// Trim of any trailing zeros in mantissa
-      while ( mantissa[mantissa.length() - 1] == '0' )
-      {
-         mantissa = mantissa.substr( 0, mantissa.length() - 1 );
-      }
-
-      /// Make one attempt to trim off trailing decimal point
-      if ( mantissa[mantissa.length() - 1] == '.' )
-      {
-         mantissa = mantissa.substr( 0, mantissa.length() - 1 );
-      }
-
-      /// Reassemble whole floating point number
-      /// Check if can drop exponent.
-      if ( exponent == "e+000" )
-      {
-         s = mantissa;
-      }
-      else
-      {
-         s = mantissa + exponent;
-      }
-   }
-
-   // Disable these checks because they compare floats using "!=" which is
-   // invalid
-#if 0 // E57_MAX_DEBUG
-   /// Double check same value
-   FTYPE old_value = static_cast<FTYPE>(atof(old_s.c_str()));
-   FTYPE new_value = static_cast<FTYPE>(atof(s.c_str()));
-   if (old_value != new_value)
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " oldValue=" + toString(old_value) + " newValue=" + toString(new_value));
-   if (new_value != value)
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " newValue=" + toString(new_value) + " value=" + toString(value));
-#endif
-
-   return ( *this << s );
-}
-
 void CheckedFile::seek( uint64_t offset, OffsetMode omode )
 {
    //??? check for seek beyond logicalLength_
@@ -468,6 +477,17 @@ uint64_t CheckedFile::lseek64( int64_t offset, int whence )
                                                        " whence=" + toString( whence ) );
    }
 
+   if ( writeBuffer_ != nullptr )
+   {
+      if ( writeBuffer_->seek( offset, whence ) )
+      {
+         return writeBuffer_->pos();
+      }
+
+      throw E57_EXCEPTION2( E57_ERROR_LSEEK_FAILED, "fileName=" + fileName_ + " offset=" + toString( offset ) +
+                                                       " whence=" + toString( whence ) );
+   }
+
 #if defined( _WIN32 )
 #if defined( _MSC_VER ) || defined( __MINGW32__ ) //<rs 2010-06-16> mingw _is_ WIN32!
    __int64 result = _lseeki64( fd_, offset, whence );
@@ -660,10 +680,44 @@ void CheckedFile::close()
       // WARNING: do NOT delete buffer of bufView_ because
       // pointer is handled by user !!
    }
+
+   if ( writeBuffer_ != nullptr )
+   {
+      /// The vector keeps what was written
+      delete writeBuffer_;
+      writeBuffer_ = nullptr;
+   }
+}
+
+void CheckedFile::setStatisticsEnabled( bool enabled )
+{
+   statisticsEnabled_ = enabled;
+}
+
+ImageFileStatistics CheckedFile::statistics() const
+{
+   ImageFileStatistics statistics;
+
+   statistics.bytesRead = bytesRead_;
+   statistics.bytesWritten = bytesWritten_;
+   statistics.pagesRead = pagesRead_;
+   statistics.pagesWritten = pagesWritten_;
+   statistics.pagesVerified = pagesVerified_;
+   statistics.ioNanoseconds = ioNanoseconds_;
+
+   return statistics;
 }
 
 void CheckedFile::unlink()
 {
+   /// There is no file to remove, just discard what was written
+   if ( writeBuffer_ != nullptr )
+   {
+      writeBuffer_->clear();
+      close();
+      return;
+   }
+
    close();
 
    /// Try to remove the file, don't report a failure
@@ -701,6 +755,13 @@ uint32_t CheckedFile::checksum( char *buf, size_t size ) const
 
 void CheckedFile::verifyChecksum( char *page_buffer, size_t page )
 {
+   E57_TRACE_SPAN_ARG( "verifyChecksum", "page", page );
+
+   if ( statisticsEnabled_ )
+   {
+      ++pagesVerified_;
+   }
+
    const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
    const uint32_t check_sum_in_page = *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] );
 
@@ -743,21 +804,57 @@ void CheckedFile::readPhysicalPage( char *page_buffer, uint64_t page )
    assert( page * physicalPageSize < physicalLength );
 #endif
 
-   /// Seek to start of physical page
-   seek( page * physicalPageSize, Physical );
+   /// Read at the start of physical page without moving the file cursor
+   const uint64_t offset = page * physicalPageSize;
+
+   if ( statisticsEnabled_ )
+   {
+      ++pagesRead_;
+   }
+
+   E57_TRACE_SPAN_ARG( "readPage", "page", page );
+   ScopedTimer<std::atomic<uint64_t>> timer( statisticsEnabled_ ? &ioNanoseconds_ : nullptr );
 
    if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
    {
-      bufView_->read( page_buffer, physicalPageSize );
+      if ( !bufView_->readAt( page_buffer, offset, physicalPageSize ) )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " page=" + toString( page ) );
+      }
+      return;
+   }
+
+   if ( writeBuffer_ != nullptr )
+   {
+      if ( !writeBuffer_->readAt( page_buffer, offset, physicalPageSize ) )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " page=" + toString( page ) );
+      }
       return;
    }
 
+#if defined( _WIN32 )
+   /// No pread() here, so seek and read under a lock, and put the cursor back
+   std::lock_guard<std::mutex> lock( seekReadMutex_ );
+
+   const uint64_t cursor = lseek64( 0LL, SEEK_CUR );
+   lseek64( static_cast<int64_t>( offset ), SEEK_SET );
+
 #if defined( _MSC_VER )
    int result = ::_read( fd_, page_buffer, physicalPageSize );
 #elif defined( __GNUC__ )
    ssize_t result = ::read( fd_, page_buffer, physicalPageSize );
 #else
 #error "no supported compiler defined"
+#endif
+
+   lseek64( static_cast<int64_t>( cursor ), SEEK_SET );
+#elif defined( __linux__ )
+   ssize_t result = ::pread64( fd_, page_buffer, physicalPageSize, static_cast<off64_t>( offset ) );
+#elif defined( __APPLE__ )
+   ssize_t result = ::pread( fd_, page_buffer, physicalPageSize, static_cast<off_t>( offset ) );
+#else
+#error "no supported OS platform defined"
 #endif
 
    if ( result < 0 || static_cast<size_t>( result ) != physicalPageSize )
@@ -776,9 +873,23 @@ void CheckedFile::writePhysicalPage( char *page_buffer, uint64_t page )
    uint32_t check_sum = checksum( page_buffer, logicalPageSize );
    *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] ) = check_sum; //??? little endian dependency
 
+   if ( statisticsEnabled_ )
+   {
+      ++pagesWritten_;
+   }
+
+   E57_TRACE_SPAN_ARG( "writePage", "page", page );
+   ScopedTimer<std::atomic<uint64_t>> timer( statisticsEnabled_ ? &ioNanoseconds_ : nullptr );
+
    /// Seek to start of physical page
    seek( page * physicalPageSize, Physical );
 
+   if ( writeBuffer_ != nullptr )
+   {
+      writeBuffer_->write( page_buffer, physicalPageSize );
+      return;
+   }
+
 #if defined( _MSC_VER )
    int result = ::_write( fd_, page_buffer, physicalPageSize );
 #elif defined( __GNUC__ )
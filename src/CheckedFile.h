@@ -28,6 +28,9 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 #include "Common.h"
 
@@ -39,6 +42,11 @@ namespace e57
    /// WARNING: pointer input is handled by user!
    class BufferView;
 
+   /// Growable memory buffer written instead of a file.
+   ///
+   /// WARNING: the vector is owned by the user!
+   class WriteBuffer;
+
    class CheckedFile
    {
    public:
@@ -63,15 +71,12 @@ namespace e57
 
       CheckedFile( const e57::ustring &fileName, Mode mode, ReadChecksumPolicy policy );
       CheckedFile( const char *input, uint64_t size, ReadChecksumPolicy policy );
+      explicit CheckedFile( std::vector<char> &output );
       ~CheckedFile();
 
       void read( char *buf, size_t nRead, size_t bufSize = 0 );
+      void readAt( uint64_t logicalOffset, char *buf, size_t nRead );
       void write( const char *buf, size_t nWrite );
-      CheckedFile &operator<<( const e57::ustring &s );
-      CheckedFile &operator<<( int64_t i );
-      CheckedFile &operator<<( uint64_t i );
-      CheckedFile &operator<<( float f );
-      CheckedFile &operator<<( double d );
       void seek( uint64_t offset, OffsetMode omode = Logical );
       uint64_t position( OffsetMode omode = Logical );
       uint64_t length( OffsetMode omode = Logical );
@@ -83,6 +88,10 @@ namespace e57
       void close();
       void unlink();
 
+      /// Counting is off by default, and should be switched before the file is used by several threads
+      void setStatisticsEnabled( bool enabled );
+      ImageFileStatistics statistics() const;
+
       static inline uint64_t logicalToPhysical( uint64_t logicalOffset );
       static inline uint64_t physicalToLogical( uint64_t physicalOffset );
 
@@ -90,8 +99,6 @@ namespace e57
       uint32_t checksum( char *buf, size_t size ) const;
       void verifyChecksum( char *page_buffer, size_t page );
 
-      template <class FTYPE> CheckedFile &writeFloatingPoint( FTYPE value, int precision );
-
       void getCurrentPageAndOffset( uint64_t &page, size_t &pageOffset, OffsetMode omode = Logical );
       void readPhysicalPage( char *page_buffer, uint64_t page );
       void writePhysicalPage( char *page_buffer, uint64_t page );
@@ -106,7 +113,20 @@ namespace e57
 
       int fd_ = -1;
       BufferView *bufView_ = nullptr;
+      WriteBuffer *writeBuffer_ = nullptr;
       bool readOnly_ = false;
+
+      /// Makes a seek and read one step where there is no positional read
+      std::mutex seekReadMutex_;
+
+      /// Performance counters, only kept if statisticsEnabled_.  Atomic since readers on several threads share them.
+      bool statisticsEnabled_ = false;
+      std::atomic<uint64_t> bytesRead_{ 0 };
+      std::atomic<uint64_t> bytesWritten_{ 0 };
+      std::atomic<uint64_t> pagesRead_{ 0 };
+      std::atomic<uint64_t> pagesWritten_{ 0 };
+      std::atomic<uint64_t> pagesVerified_{ 0 };
+      std::atomic<uint64_t> ioNanoseconds_{ 0 };
    };
 
    inline uint64_t CheckedFile::logicalToPhysical( uint64_t logicalOffset )
@@ -31,6 +31,7 @@
 #include "CompressedVectorWriterImpl.h"
 #include "ImageFileImpl.h"
 #include "VectorNodeImpl.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -196,7 +197,7 @@ namespace e57
       throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "this->pathName=" + this->pathName() );
    }
 
-   void CompressedVectorNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
+   void CompressedVectorNodeImpl::writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent,
                                             const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -208,24 +209,24 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      uint64_t physicalStart = cf.logicalToPhysical( binarySectionLogicalStart_ );
+      uint64_t physicalStart = CheckedFile::logicalToPhysical( binarySectionLogicalStart_ );
 
-      cf << space( indent ) << "<" << fieldName << " type=\"CompressedVector\"";
-      cf << " fileOffset=\"" << physicalStart;
-      cf << "\" recordCount=\"" << recordCount_ << "\">\n";
+      xml << space( indent ) << "<" << fieldName << " type=\"CompressedVector\"";
+      xml << " fileOffset=\"" << physicalStart;
+      xml << "\" recordCount=\"" << recordCount_ << "\">\n";
 
       if ( prototype_ )
       {
-         prototype_->writeXml( imf, cf, indent + 2, "prototype" );
+         prototype_->writeXml( imf, xml, indent + 2, "prototype" );
       }
       if ( codecs_ )
       {
-         codecs_->writeXml( imf, cf, indent + 2, "codecs" );
+         codecs_->writeXml( imf, xml, indent + 2, "codecs" );
       }
-      cf << space( indent ) << "</" << fieldName << ">\n";
+      xml << space( indent ) << "</" << fieldName << ">\n";
    }
 
 #ifdef E57_DEBUG
@@ -257,20 +258,14 @@ namespace e57
    }
 #endif
 
-   std::shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer( std::vector<SourceDestBuffer> sbufs )
+   std::shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer( std::vector<SourceDestBuffer> sbufs,
+                                                                                 PacketLayoutPolicy layout )
    {
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      /// Check don't have any writers/readers open for this ImageFile
-      if ( destImageFile->writerCount() > 0 )
-      {
-         throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
-                               "fileName=" + destImageFile->fileName() +
-                                  " writerCount=" + toString( destImageFile->writerCount() ) +
-                                  " readerCount=" + toString( destImageFile->readerCount() ) );
-      }
+      /// Check don't have any readers open for this ImageFile.  Other writers are fine, their sections are kept apart.
       if ( destImageFile->readerCount() > 0 )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_READERS,
@@ -295,6 +290,21 @@ namespace e57
          throw E57_EXCEPTION2( E57_ERROR_NODE_UNATTACHED, "fileName=" + destImageFile->fileName() );
       }
 
+      /// Writers of other nodes may be open, but not another one of this node
+      if ( writerOpen_.exchange( true ) )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
+                               "fileName=" + destImageFile->fileName() + " this->pathName=" + this->pathName() );
+      }
+
+      /// The binary section of a node can only be written once
+      if ( sectionWritten_ )
+      {
+         writerOpen_ = false;
+         throw E57_EXCEPTION2( E57_ERROR_SET_TWICE,
+                               "fileName=" + destImageFile->fileName() + " this->pathName=" + this->pathName() );
+      }
+
       /// Get pointer to me (really shared_ptr<CompressedVectorNodeImpl>)
       NodeImplSharedPtr ni( shared_from_this() );
 
@@ -302,8 +312,22 @@ namespace e57
       std::shared_ptr<CompressedVectorNodeImpl> cai( std::static_pointer_cast<CompressedVectorNodeImpl>( ni ) );
 
       /// Return a shared_ptr to new object
-      std::shared_ptr<CompressedVectorWriterImpl> cvwi( new CompressedVectorWriterImpl( cai, sbufs ) );
-      return ( cvwi );
+      try
+      {
+         std::shared_ptr<CompressedVectorWriterImpl> cvwi( new CompressedVectorWriterImpl( cai, sbufs, layout ) );
+         return ( cvwi );
+      }
+      catch ( ... )
+      {
+         writerOpen_ = false;
+         throw;
+      }
+   }
+
+   void CompressedVectorNodeImpl::setWriterClosed()
+   {
+      sectionWritten_ = true;
+      writerOpen_ = false;
    }
 
    std::shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader( std::vector<SourceDestBuffer> dbufs )
@@ -312,7 +336,8 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      /// Check don't have any writers/readers open for this ImageFile
+      /// Check don't have any writers open for this ImageFile. Readers of a file opened for reading can be open at
+      /// the same time, its packets are read with pread().
       if ( destImageFile->writerCount() > 0 )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
@@ -320,7 +345,7 @@ namespace e57
                                   " writerCount=" + toString( destImageFile->writerCount() ) +
                                   " readerCount=" + toString( destImageFile->readerCount() ) );
       }
-      if ( destImageFile->readerCount() > 0 )
+      if ( destImageFile->isWriter() && ( destImageFile->readerCount() > 0 ) )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_READERS,
                                "fileName=" + destImageFile->fileName() +
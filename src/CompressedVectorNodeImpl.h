@@ -26,6 +26,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <atomic>
+
 #include "NodeImpl.h"
 
 namespace e57
@@ -53,11 +55,12 @@ namespace e57
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
-      void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
+      void writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent,
                      const char *forcedFieldName = nullptr ) override;
 
       /// Iterator constructors
-      std::shared_ptr<CompressedVectorWriterImpl> writer( std::vector<SourceDestBuffer> sbufs );
+      std::shared_ptr<CompressedVectorWriterImpl> writer( std::vector<SourceDestBuffer> sbufs,
+                                                          PacketLayoutPolicy layout );
       std::shared_ptr<CompressedVectorReaderImpl> reader( std::vector<SourceDestBuffer> dbufs );
 
       int64_t getRecordCount() const
@@ -77,6 +80,9 @@ namespace e57
          binarySectionLogicalStart_ = binarySectionLogicalStart;
       }
 
+      /// Called once by the writer of this node when it closes, no other writer can be opened afterwards
+      void setWriterClosed();
+
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -89,5 +95,10 @@ namespace e57
 
       int64_t recordCount_ = 0;
       uint64_t binarySectionLogicalStart_ = 0;
+
+      /// Only one writer per node, which writes its only binary section.  Writers of other nodes may be on other
+      /// threads, so the flag is atomic, and sectionWritten_ is only accessed by whoever set it.
+      std::atomic<bool> writerOpen_{ false };
+      bool sectionWritten_ = false;
    };
 }
@@ -25,6 +25,11 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 #include "CompressedVectorReaderImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
@@ -32,6 +37,8 @@
 #include "Packet.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 namespace e57
 {
@@ -97,6 +104,28 @@ namespace e57
       //??? what if fault in this constructor?
       cache_ = new PacketReadCache( imf->file_, 32 );
 
+      /// Only the bytestreams of the requested fields need to be read from each data packet
+      std::vector<unsigned> neededBytestreams;
+      for ( const auto &channel : channels_ )
+      {
+         neededBytestreams.push_back( channel.bytestreamNumber );
+      }
+      cache_->setNeededBytestreams( neededBytestreams );
+
+      statisticsEnabled_ = imf->statisticsEnabled();
+
+      if ( statisticsEnabled_ )
+      {
+         statistics_.bytestreams.resize( channels_.size() );
+
+         for ( unsigned i = 0; i < channels_.size(); ++i )
+         {
+            statistics_.bytestreams[i].pathName = dbufs_.at( i ).pathName();
+         }
+
+         cache_->setStatistics( &statistics_ );
+      }
+
       /// Read CompressedVector section header
       CompressedVectorSectionHeader sectionHeader;
       uint64_t sectionLogicalStart = cVector_->getBinarySectionLogicalStart();
@@ -108,8 +137,7 @@ namespace e57
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
                                "imageFileName=" + cVector_->imageFileName() + " cvPathName=" + cVector_->pathName() );
       }
-      imf->file_->seek( sectionLogicalStart, CheckedFile::Logical );
-      imf->file_->read( reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
+      imf->file_->readAt( sectionLogicalStart, reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
 
 #ifdef E57_DEBUG
       sectionHeader.verify( imf->file_->length( CheckedFile::Physical ) );
@@ -200,6 +228,16 @@ namespace e57
       }
 
       dbufs_ = dbufs;
+
+      /// Point the decoders at the new dbufs, so reads can alternate between sets of buffers.  There are no channels
+      /// yet when called from the constructor.
+      for ( size_t i = 0; i < channels_.size(); i++ )
+      {
+         std::vector<SourceDestBuffer> theDbuf( 1, dbufs_[i] );
+
+         channels_[i].dbuf = dbufs_[i];
+         channels_[i].decoder->destBufferSetNew( theDbuf );
+      }
    }
 
    unsigned CompressedVectorReaderImpl::read( std::vector<SourceDestBuffer> &dbufs )
@@ -223,18 +261,59 @@ namespace e57
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
-      /// Rewind all dbufs so start writing to them at beginning
+      const unsigned count = readRecords();
+
+      if ( statisticsEnabled_ )
+      {
+         statistics_.recordsProduced += count;
+      }
+
+      return count;
+   }
+
+   unsigned CompressedVectorReaderImpl::readRecords()
+   {
+      if ( filter_.empty() )
+      {
+         return decodeRecords( 0 );
+      }
+
+      /// Filter each decoded block in place, then decode more records into the space freed by rejected ones.  Stop
+      /// when dbufs are full of passing records, or when no more records could be decoded.
+      const auto capacity = static_cast<unsigned>( dbufs_.at( 0 ).impl()->capacity() );
+      unsigned passCount = 0;
+
+      while ( passCount < capacity )
+      {
+         const unsigned endIndex = decodeRecords( passCount );
+
+         if ( endIndex == passCount )
+         {
+            break;
+         }
+
+         passCount = filterRecords( passCount, endIndex );
+      }
+
+      return passCount;
+   }
+
+   unsigned CompressedVectorReaderImpl::decodeRecords( unsigned startIndex )
+   {
+      /// Set all dbufs so start writing to them at startIndex
       for ( auto &dbuf : dbufs_ )
       {
-         dbuf.impl()->rewind();
+         dbuf.impl()->setNextIndex( startIndex );
       }
 
       /// Allow decoders to use data they already have in their queue to fill newly
       /// empty dbufs This helps to keep decoder input queues smaller, which
       /// reduces backtracking in the packet cache.
-      for ( auto &channel : channels_ )
+      for ( unsigned i = 0; i < channels_.size(); ++i )
       {
-         channel.decoder->inputProcess( nullptr, 0 );
+         ScopedTimer<uint64_t> timer( statisticsEnabled_ ? &statistics_.bytestreams[i].cpuNanoseconds : nullptr );
+
+         channels_[i].decoder->inputProcess( nullptr, 0 );
       }
 
       /// Loop until every dbuf is full or we have reached end of the binary
@@ -275,10 +354,562 @@ namespace e57
          }
       }
 
+      /// Convert and transform the new records while they are still fresh
+      if ( !sphericalDbufs_.empty() )
+      {
+         convertSphericalRecords( startIndex, outputCount );
+      }
+      if ( !transformDbufs_.empty() )
+      {
+         transformRecords( startIndex, outputCount );
+      }
+
       /// Return number of records transferred to each dbuf.
       return outputCount;
    }
 
+   void CompressedVectorReaderImpl::setFilter( const std::vector<ReadFilterCondition> &conditions )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      std::vector<FilterCondition> filter;
+
+      for ( const auto &condition : conditions )
+      {
+         /// Find the dbuf the condition tests
+         const unsigned dbufIndex = findDbuf( condition.pathName );
+
+         if ( dbufs_[dbufIndex].impl()->memoryRepresentation() == E57_USTRING )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "pathName=" + condition.pathName +
+                                                                 " imageFileName=" + cVector_->imageFileName() +
+                                                                 " cvPathName=" + cVector_->pathName() );
+         }
+
+         filter.push_back( { dbufIndex, condition.minimum, condition.maximum } );
+      }
+
+      filter_.swap( filter );
+   }
+
+   void CompressedVectorReaderImpl::setDecimation( uint64_t interval, uint64_t threshold, uint64_t seed )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      sampling_.interval = interval;
+      sampling_.threshold = threshold;
+      sampling_.seed = seed;
+
+      /// Every channel must select the same records, or the dbufs get out of step
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->setSampling( sampling_ );
+      }
+   }
+
+   void CompressedVectorReaderImpl::setRecordRanges( const std::vector<RecordRange> &ranges )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      /// Sort and merge ranges, so the decoders can find the next one with a binary search
+      std::vector<std::pair<uint64_t, uint64_t>> merged;
+
+      for ( const auto &range : ranges )
+      {
+         if ( range.count > 0 )
+         {
+            merged.emplace_back( range.start, range.start + range.count );
+         }
+      }
+
+      std::sort( merged.begin(), merged.end() );
+
+      size_t mergedCount = 0;
+      for ( const auto &range : merged )
+      {
+         if ( mergedCount > 0 && range.first <= merged[mergedCount - 1].second )
+         {
+            merged[mergedCount - 1].second = std::max( merged[mergedCount - 1].second, range.second );
+         }
+         else
+         {
+            merged[mergedCount++] = range;
+         }
+      }
+      merged.resize( mergedCount );
+
+      /// An empty list keeps all records, so a list of only empty ranges must keep none
+      if ( merged.empty() && !ranges.empty() )
+      {
+         merged.emplace_back( 0, 0 );
+      }
+
+      sampling_.ranges.swap( merged );
+
+      for ( auto &channel : channels_ )
+      {
+         channel.decoder->setSampling( sampling_ );
+      }
+   }
+
+   void CompressedVectorReaderImpl::setTransform( const ReadTransform &transform )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( transform.isIdentity() )
+      {
+         transformDbufs_.clear();
+         return;
+      }
+
+      std::vector<unsigned> transformDbufs =
+         findCoordinateDbufs( transform.xPathName, transform.yPathName, transform.zPathName );
+
+      checkTransformedSpherical( transformDbufs, sphericalDbufs_ );
+
+      transformDbufs_.swap( transformDbufs );
+      transform_ = transform;
+   }
+
+   void CompressedVectorReaderImpl::setSphericalConversion( const ReadSphericalConversion &conversion )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( conversion.rangePathName.empty() )
+      {
+         checkTransformedSpherical( transformDbufs_, {} );
+
+         sphericalDbufs_.clear();
+         return;
+      }
+
+      std::vector<unsigned> sphericalDbufs = findCoordinateDbufs(
+         conversion.rangePathName, conversion.azimuthPathName, conversion.elevationPathName );
+
+      if ( !conversion.invalidStatePathName.empty() )
+      {
+         /// Invalid states are read a byte at a time
+         const unsigned dbufIndex = findDbuf( conversion.invalidStatePathName );
+         const MemoryRepresentation representation = dbufs_[dbufIndex].impl()->memoryRepresentation();
+
+         if ( representation != E57_INT8 && representation != E57_UINT8 )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "pathName=" + conversion.invalidStatePathName +
+                                                                 " memoryRepresentation=" + toString( representation ) +
+                                                                 " imageFileName=" + cVector_->imageFileName() );
+         }
+
+         sphericalDbufs.push_back( dbufIndex );
+      }
+
+      checkTransformedSpherical( transformDbufs_, sphericalDbufs );
+
+      sphericalDbufs_.swap( sphericalDbufs );
+   }
+
+   void CompressedVectorReaderImpl::checkTransformedSpherical( const std::vector<unsigned> &transformDbufs,
+                                                               const std::vector<unsigned> &sphericalDbufs ) const
+   {
+      /// A transform of the spherical coordinate buffers is only valid if they are converted to cartesian first,
+      /// otherwise range, azimuth and elevation would be rotated and translated as if they were x, y and z.
+      static const ustring sphericalNames[] = { "sphericalRange", "sphericalAzimuth", "sphericalElevation" };
+
+      for ( unsigned dbufIndex : transformDbufs )
+      {
+         ustring pathName = dbufs_[dbufIndex].pathName();
+
+         if ( !pathName.empty() && pathName[0] == '/' )
+         {
+            pathName.erase( 0, 1 );
+         }
+
+         if ( std::find( std::begin( sphericalNames ), std::end( sphericalNames ), pathName ) ==
+              std::end( sphericalNames ) )
+         {
+            continue;
+         }
+
+         const auto coordinatesEnd = sphericalDbufs.begin() + std::min<size_t>( sphericalDbufs.size(), 3 );
+
+         if ( std::find( sphericalDbufs.begin(), coordinatesEnd, dbufIndex ) == coordinatesEnd )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT,
+                                  "pathName=" + pathName + " imageFileName=" + cVector_->imageFileName() );
+         }
+      }
+   }
+
+   unsigned CompressedVectorReaderImpl::findDbuf( const ustring &pathName ) const
+   {
+      unsigned dbufIndex = 0;
+      while ( dbufIndex < dbufs_.size() && dbufs_[dbufIndex].pathName() != pathName )
+      {
+         ++dbufIndex;
+      }
+
+      if ( dbufIndex == dbufs_.size() )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "pathName=" + pathName +
+                                                              " imageFileName=" + cVector_->imageFileName() +
+                                                              " cvPathName=" + cVector_->pathName() );
+      }
+
+      return dbufIndex;
+   }
+
+   std::vector<unsigned> CompressedVectorReaderImpl::findCoordinateDbufs( const ustring &pathName0,
+                                                                          const ustring &pathName1,
+                                                                          const ustring &pathName2 ) const
+   {
+      std::vector<unsigned> coordinateDbufs;
+
+      for ( const ustring &pathName : { pathName0, pathName1, pathName2 } )
+      {
+         const unsigned dbufIndex = findDbuf( pathName );
+
+         /// Computed coordinates must go in a floating point buffer, all of the same precision
+         const MemoryRepresentation representation = dbufs_[dbufIndex].impl()->memoryRepresentation();
+
+         if ( ( representation != E57_REAL32 && representation != E57_REAL64 ) ||
+              ( !coordinateDbufs.empty() &&
+                representation != dbufs_[coordinateDbufs.front()].impl()->memoryRepresentation() ) )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "pathName=" + pathName +
+                                                                 " memoryRepresentation=" + toString( representation ) +
+                                                                 " imageFileName=" + cVector_->imageFileName() );
+         }
+
+         coordinateDbufs.push_back( dbufIndex );
+      }
+
+      return coordinateDbufs;
+   }
+
+   namespace
+   {
+      /// Apply rotation and translation to count points stored in three strided buffers.  The matrix is copied to
+      /// locals so the compiler knows the stores can't change it, and can vectorize the loop.
+      template <typename T>
+      void transformPoints( const ReadTransform &transform, char *x, char *y, char *z, size_t xStride,
+                            size_t yStride, size_t zStride, size_t count )
+      {
+         const double r00 = transform.rotation[0][0], r01 = transform.rotation[0][1], r02 = transform.rotation[0][2];
+         const double r10 = transform.rotation[1][0], r11 = transform.rotation[1][1], r12 = transform.rotation[1][2];
+         const double r20 = transform.rotation[2][0], r21 = transform.rotation[2][1], r22 = transform.rotation[2][2];
+         const double tx = transform.translation[0], ty = transform.translation[1], tz = transform.translation[2];
+
+         for ( size_t i = 0; i < count; ++i )
+         {
+            T &px = *reinterpret_cast<T *>( x + i * xStride );
+            T &py = *reinterpret_cast<T *>( y + i * yStride );
+            T &pz = *reinterpret_cast<T *>( z + i * zStride );
+
+            const double inX = px;
+            const double inY = py;
+            const double inZ = pz;
+
+            px = static_cast<T>( r00 * inX + r01 * inY + r02 * inZ + tx );
+            py = static_cast<T>( r10 * inX + r11 * inY + r12 * inZ + ty );
+            pz = static_cast<T>( r20 * inX + r21 * inY + r22 * inZ + tz );
+         }
+      }
+   }
+
+   namespace
+   {
+      /// Sine and cosine of angle, without branches so loops calling it can be vectorized.  The angle is reduced to
+      /// [-pi/4, pi/4] with a three part (Cody-Waite) multiple of pi/2, then the Cephes minimax polynomials are used.
+      /// Absolute error of both results is below 2.5e-16 for |angle| <= 1e6, i.e. about one ulp for results near 1.
+      /// Larger angles lose accuracy in the reduction. Angles come from the file and may be anything, so NaN,
+      /// infinite and angles beyond 2^51 * pi/2, where the rounding below stops working, give NaN results.
+      inline void sinCos( double angle, double &sinValue, double &cosValue )
+      {
+         constexpr double TwoOverPi = 0.63661977236758134308;
+         constexpr double PiOver2A = 1.57079625129699707031;
+         constexpr double PiOver2B = 7.54978941586159635335E-8;
+         constexpr double PiOver2C = 5.39030285815811905290E-15;
+
+         /// Adding and subtracting 1.5 * 2^52 rounds to nearest integer without a library call
+         constexpr double RoundMagic = 6755399441055744.0;
+         constexpr double MaxAngle = 2251799813685248.0 * 1.57079632679489661923;
+
+         const double shifted = angle * TwoOverPi + RoundMagic;
+         const double k = shifted - RoundMagic;
+         const double z = ( ( angle - k * PiOver2A ) - k * PiOver2B ) - k * PiOver2C;
+         const double z2 = z * z;
+
+         const double s =
+            z + z * z2 *
+                   ( -1.66666666666666307295E-1 +
+                     z2 * ( 8.33333333332211858878E-3 +
+                            z2 * ( -1.98412698295895385996E-4 +
+                                   z2 * ( 2.75573136213857245213E-6 +
+                                          z2 * ( -2.50507477628578072866E-8 + z2 * 1.58962301576546568060E-10 ) ) ) ) );
+         const double c =
+            1.0 - 0.5 * z2 +
+            z2 * z2 *
+               ( 4.16666666666665929218E-2 +
+                 z2 * ( -1.38888888888730564116E-3 +
+                        z2 * ( 2.48015872888517045348E-5 +
+                               z2 * ( -2.75573141792967388112E-7 +
+                                      z2 * ( 2.08757008419747316778E-9 + z2 * -1.13585365213876817300E-11 ) ) ) ) );
+
+         /// Move results to the quadrant the angle was in. The low bits of the mantissa of shifted hold k as a two's
+         /// complement integer, which unlike converting k is defined for any angle.
+         uint64_t shiftedBits;
+         std::memcpy( &shiftedBits, &shifted, sizeof( shiftedBits ) );
+
+         const auto quadrant = static_cast<uint32_t>( shiftedBits );
+         const double sinQ = ( quadrant & 1 ) ? c : s;
+         const double cosQ = ( quadrant & 1 ) ? s : c;
+
+         /// False for NaN too
+         const bool inRange = std::fabs( angle ) < MaxAngle;
+         constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+         sinValue = inRange ? ( ( quadrant & 2 ) ? -sinQ : sinQ ) : NaN;
+         cosValue = inRange ? ( ( ( quadrant + 1 ) & 2 ) ? -cosQ : cosQ ) : NaN;
+      }
+
+      /// Replace count points of range, azimuth, elevation in three strided buffers with x, y, z.  Points with
+      /// invalid state 1 (only direction valid) get a unit vector, and state 2 (no data) gets the origin.
+      template <typename T>
+      void sphericalToCartesian( char *range, char *azimuth, char *elevation, const char *invalidState,
+                                 size_t rangeStride, size_t azimuthStride, size_t elevationStride,
+                                 size_t invalidStateStride, size_t count )
+      {
+         for ( size_t i = 0; i < count; ++i )
+         {
+            T &r = *reinterpret_cast<T *>( range + i * rangeStride );
+            T &az = *reinterpret_cast<T *>( azimuth + i * azimuthStride );
+            T &el = *reinterpret_cast<T *>( elevation + i * elevationStride );
+            const int8_t state = *reinterpret_cast<const int8_t *>( invalidState + i * invalidStateStride );
+
+            const double rangeValue = ( state == 0 ) ? static_cast<double>( r ) : ( ( state == 1 ) ? 1. : 0. );
+
+            double sinAzimuth, cosAzimuth, sinElevation, cosElevation;
+            sinCos( az, sinAzimuth, cosAzimuth );
+            sinCos( el, sinElevation, cosElevation );
+
+            const double horizontal = rangeValue * cosElevation;
+
+            r = static_cast<T>( horizontal * cosAzimuth );
+            az = static_cast<T>( horizontal * sinAzimuth );
+            el = static_cast<T>( rangeValue * sinElevation );
+         }
+      }
+   }
+
+   void CompressedVectorReaderImpl::convertSphericalRecords( unsigned beginIndex, unsigned endIndex )
+   {
+      SourceDestBufferImpl *rangeBuf = dbufs_[sphericalDbufs_[0]].impl().get();
+      SourceDestBufferImpl *azimuthBuf = dbufs_[sphericalDbufs_[1]].impl().get();
+      SourceDestBufferImpl *elevationBuf = dbufs_[sphericalDbufs_[2]].impl().get();
+
+      char *range = static_cast<char *>( rangeBuf->base() ) + beginIndex * rangeBuf->stride();
+      char *azimuth = static_cast<char *>( azimuthBuf->base() ) + beginIndex * azimuthBuf->stride();
+      char *elevation = static_cast<char *>( elevationBuf->base() ) + beginIndex * elevationBuf->stride();
+
+      /// Without an invalid state buffer, every point reads the same valid state
+      static const char allValid = 0;
+      const char *invalidState = &allValid;
+      size_t invalidStateStride = 0;
+
+      if ( sphericalDbufs_.size() > 3 )
+      {
+         SourceDestBufferImpl *invalidStateBuf = dbufs_[sphericalDbufs_[3]].impl().get();
+
+         invalidStateStride = invalidStateBuf->stride();
+         invalidState = static_cast<const char *>( invalidStateBuf->base() ) + beginIndex * invalidStateStride;
+      }
+
+      if ( rangeBuf->memoryRepresentation() == E57_REAL32 )
+      {
+         sphericalToCartesian<float>( range, azimuth, elevation, invalidState, rangeBuf->stride(),
+                                      azimuthBuf->stride(), elevationBuf->stride(), invalidStateStride,
+                                      endIndex - beginIndex );
+      }
+      else
+      {
+         sphericalToCartesian<double>( range, azimuth, elevation, invalidState, rangeBuf->stride(),
+                                       azimuthBuf->stride(), elevationBuf->stride(), invalidStateStride,
+                                       endIndex - beginIndex );
+      }
+   }
+
+   void CompressedVectorReaderImpl::transformRecords( unsigned beginIndex, unsigned endIndex )
+   {
+      SourceDestBufferImpl *xBuf = dbufs_[transformDbufs_[0]].impl().get();
+      SourceDestBufferImpl *yBuf = dbufs_[transformDbufs_[1]].impl().get();
+      SourceDestBufferImpl *zBuf = dbufs_[transformDbufs_[2]].impl().get();
+
+      char *x = static_cast<char *>( xBuf->base() ) + beginIndex * xBuf->stride();
+      char *y = static_cast<char *>( yBuf->base() ) + beginIndex * yBuf->stride();
+      char *z = static_cast<char *>( zBuf->base() ) + beginIndex * zBuf->stride();
+
+      if ( xBuf->memoryRepresentation() == E57_REAL32 )
+      {
+         transformPoints<float>( transform_, x, y, z, xBuf->stride(), yBuf->stride(), zBuf->stride(),
+                                 endIndex - beginIndex );
+      }
+      else
+      {
+         transformPoints<double>( transform_, x, y, z, xBuf->stride(), yBuf->stride(), zBuf->stride(),
+                                  endIndex - beginIndex );
+      }
+   }
+
+   namespace
+   {
+      /// Clear pass flag of records whose value is outside [minimum, maximum].  Branch free so compiler can vectorize
+      /// it for contiguous buffers.
+      template <typename T>
+      void filterRange( const char *base, size_t stride, unsigned beginIndex, unsigned endIndex, double minimum,
+                        double maximum, uint8_t *pass )
+      {
+         const char *p = base + beginIndex * stride;
+
+         for ( unsigned i = 0; i < endIndex - beginIndex; ++i, p += stride )
+         {
+            const auto value = static_cast<double>( *reinterpret_cast<const T *>( p ) );
+
+            pass[i] &= static_cast<uint8_t>( ( value >= minimum ) & ( value <= maximum ) );
+         }
+      }
+
+      /// Move elements of passing records down to fill the holes left by rejected ones.
+      template <size_t ElementSize>
+      void compactElements( char *base, size_t stride, unsigned beginIndex, unsigned endIndex, const uint8_t *pass )
+      {
+         unsigned outIndex = beginIndex;
+
+         for ( unsigned i = beginIndex; i < endIndex; ++i )
+         {
+            if ( pass[i - beginIndex] )
+            {
+               if ( outIndex != i )
+               {
+                  memcpy( base + outIndex * stride, base + i * stride, ElementSize );
+               }
+               ++outIndex;
+            }
+         }
+      }
+   }
+
+   unsigned CompressedVectorReaderImpl::filterRecords( unsigned beginIndex, unsigned endIndex )
+   {
+      filterPass_.assign( endIndex - beginIndex, 1 );
+      uint8_t *pass = filterPass_.data();
+
+      /// Evaluate all conditions over the whole block, one field at a time
+      for ( const auto &condition : filter_ )
+      {
+         const std::shared_ptr<SourceDestBufferImpl> dbuf = dbufs_.at( condition.dbufIndex ).impl();
+         const char *base = static_cast<const char *>( dbuf->base() );
+         const size_t stride = dbuf->stride();
+
+         switch ( dbuf->memoryRepresentation() )
+         {
+            case E57_INT8:
+               filterRange<int8_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_UINT8:
+               filterRange<uint8_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_INT16:
+               filterRange<int16_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_UINT16:
+               filterRange<uint16_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum,
+                                      pass );
+               break;
+            case E57_INT32:
+               filterRange<int32_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_UINT32:
+               filterRange<uint32_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum,
+                                      pass );
+               break;
+            case E57_INT64:
+               filterRange<int64_t>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_BOOL:
+               filterRange<bool>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_REAL32:
+               filterRange<float>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            case E57_REAL64:
+               filterRange<double>( base, stride, beginIndex, endIndex, condition.minimum, condition.maximum, pass );
+               break;
+            default:
+               throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
+                                     "memoryRepresentation=" + toString( dbuf->memoryRepresentation() ) );
+         }
+      }
+
+      /// Pack passing records at beginIndex in every dbuf
+      for ( auto &dbufHandle : dbufs_ )
+      {
+         const std::shared_ptr<SourceDestBufferImpl> dbuf = dbufHandle.impl();
+         char *base = static_cast<char *>( dbuf->base() );
+         const size_t stride = dbuf->stride();
+
+         switch ( dbuf->memoryRepresentation() )
+         {
+            case E57_INT8:
+            case E57_UINT8:
+               compactElements<1>( base, stride, beginIndex, endIndex, pass );
+               break;
+            case E57_INT16:
+            case E57_UINT16:
+               compactElements<2>( base, stride, beginIndex, endIndex, pass );
+               break;
+            case E57_INT32:
+            case E57_UINT32:
+            case E57_REAL32:
+               compactElements<4>( base, stride, beginIndex, endIndex, pass );
+               break;
+            case E57_INT64:
+            case E57_REAL64:
+               compactElements<8>( base, stride, beginIndex, endIndex, pass );
+               break;
+            case E57_BOOL:
+               compactElements<sizeof( bool )>( base, stride, beginIndex, endIndex, pass );
+               break;
+            case E57_USTRING:
+            {
+               StringList &strings = *dbuf->ustrings();
+               unsigned outIndex = beginIndex;
+
+               for ( unsigned i = beginIndex; i < endIndex; ++i )
+               {
+                  if ( pass[i - beginIndex] )
+                  {
+                     if ( outIndex != i )
+                     {
+                        strings[outIndex].swap( strings[i] );
+                     }
+                     ++outIndex;
+                  }
+               }
+            }
+            break;
+            default:
+               throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
+                                     "memoryRepresentation=" + toString( dbuf->memoryRepresentation() ) );
+         }
+      }
+
+      return beginIndex + static_cast<unsigned>( std::count( filterPass_.begin(), filterPass_.end(), 1 ) );
+   }
+
    uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
    {
       uint64_t earliestPacketLogicalOffset = E57_UINT64_MAX;
@@ -334,6 +965,8 @@ namespace e57
 
    void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLogicalOffset )
    {
+      E57_TRACE_SPAN_ARG( "feedPacketToDecoders", "offset", currentPacketLogicalOffset );
+
       // Get packet at currentPacketLogicalOffset into memory.
       auto dpkt = dataPacket( currentPacketLogicalOffset );
 
@@ -350,10 +983,17 @@ namespace e57
       bool anyChannelHasExhaustedPacket = false;
       uint64_t nextPacketLogicalOffset = E57_UINT64_MAX;
 
+      if ( statisticsEnabled_ )
+      {
+         ++statistics_.packetsDecoded;
+      }
+
       // Feed bytestreams to channels with unblocked output that are reading from
       // this packet
-      for ( DecodeChannel &channel : channels_ )
+      for ( unsigned channelIndex = 0; channelIndex < channels_.size(); ++channelIndex )
       {
+         DecodeChannel &channel = channels_[channelIndex];
+
          // Skip channels that have already read this packet.
          if ( _alreadyReadPacket( channel, currentPacketLogicalOffset ) )
          {
@@ -383,7 +1023,20 @@ namespace e57
          }
 
          // Feed into decoder
-         const size_t bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
+         size_t bytesProcessed = 0;
+
+         {
+            E57_TRACE_SPAN_ARG( "inputProcess", "bytestream", channel.bytestreamNumber );
+            ScopedTimer<uint64_t> timer( statisticsEnabled_ ? &statistics_.bytestreams[channelIndex].cpuNanoseconds
+                                                            : nullptr );
+
+            bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
+         }
+
+         if ( statisticsEnabled_ )
+         {
+            statistics_.bytestreams[channelIndex].bytes += bytesProcessed;
+         }
 
 #ifdef E57_MAX_VERBOSE
          std::cout << "  stream[" << channel.bytestreamNumber << "]: feeding decoder " << uneatenLength << " bytes"
@@ -534,6 +1187,11 @@ namespace e57
       return ( cVector_ );
    }
 
+   CompressedVectorReaderStatistics CompressedVectorReaderImpl::statistics() const
+   {
+      return statistics_;
+   }
+
    void CompressedVectorReaderImpl::close()
    {
       /// Before anything that can throw, decrement reader count
@@ -40,9 +40,15 @@ namespace e57
       ~CompressedVectorReaderImpl();
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
+      void setFilter( const std::vector<ReadFilterCondition> &conditions );
+      void setDecimation( uint64_t interval, uint64_t threshold, uint64_t seed );
+      void setRecordRanges( const std::vector<RecordRange> &ranges );
+      void setTransform( const ReadTransform &transform );
+      void setSphericalConversion( const ReadSphericalConversion &conversion );
       void seek( uint64_t recordNumber );
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
+      CompressedVectorReaderStatistics statistics() const;
       void close();
 
 #ifdef E57_DEBUG
@@ -54,6 +60,16 @@ namespace e57
       void checkReaderOpen( const char *srcFileName, int srcLineNumber, const char *srcFunctionName ) const;
       void setBuffers( std::vector<SourceDestBuffer> &dbufs ); //???needed?
       uint64_t earliestPacketNeededForInput() const;
+      unsigned readRecords();
+      unsigned decodeRecords( unsigned startIndex );
+      unsigned filterRecords( unsigned beginIndex, unsigned endIndex );
+      void transformRecords( unsigned beginIndex, unsigned endIndex );
+      void convertSphericalRecords( unsigned beginIndex, unsigned endIndex );
+      unsigned findDbuf( const ustring &pathName ) const;
+      std::vector<unsigned> findCoordinateDbufs( const ustring &pathName0, const ustring &pathName1,
+                                                 const ustring &pathName2 ) const;
+      void checkTransformedSpherical( const std::vector<unsigned> &transformDbufs,
+                                      const std::vector<unsigned> &sphericalDbufs ) const;
 
       DataPacket *dataPacket( uint64_t inLogicalOffset ) const;
       void feedPacketToDecoders( uint64_t currentPacketLogicalOffset );
@@ -68,6 +84,27 @@ namespace e57
       std::vector<DecodeChannel> channels_;
       PacketReadCache *cache_;
 
+      struct FilterCondition
+      {
+         unsigned dbufIndex;
+         double minimum;
+         double maximum;
+      };
+
+      std::vector<FilterCondition> filter_;
+      std::vector<uint8_t> filterPass_; /// pass flag for each record being filtered, reused between reads
+
+      RecordSampling sampling_; /// records kept by decimation and record ranges, shared by all decoders
+
+      ReadTransform transform_;
+      std::vector<unsigned> transformDbufs_; /// dbuf index of x, y, z, empty if no transform
+      std::vector<unsigned> sphericalDbufs_; /// dbuf index of range, azimuth, elevation and optional invalid
+                                             /// state, empty if no spherical conversion
+
+      /// Counters, only kept if the ImageFile had statistics enabled when the reader was created
+      bool statisticsEnabled_ = false;
+      CompressedVectorReaderStatistics statistics_; /// bytestreams has one entry per channel
+
       uint64_t recordCount_; /// number of records written so far
       uint64_t maxRecordCount_;
       uint64_t sectionEndLogicalOffset_;
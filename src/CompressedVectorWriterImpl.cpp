@@ -25,6 +25,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 
@@ -34,6 +35,8 @@
 #include "ImageFileImpl.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 namespace e57
 {
@@ -45,12 +48,23 @@ namespace e57
       }
    };
 
+   /// With PACKET_LAYOUT_COLUMNAR, a bytestream holding data is forced into a packet once this many packets have been
+   /// written without it. This keeps the bytestreams close enough together in the file that the reader's packet
+   /// cache (32 packets) doesn't thrash.
+   constexpr uint64_t COLUMNAR_MAX_SKEW_PACKETS = 8;
+
    CompressedVectorWriterImpl::CompressedVectorWriterImpl( std::shared_ptr<CompressedVectorNodeImpl> ni,
-                                                           std::vector<SourceDestBuffer> &sbufs ) :
+                                                           std::vector<SourceDestBuffer> &sbufs,
+                                                           PacketLayoutPolicy layout ) :
       cVector_( ni ),
-      isOpen_( false ) // set to true when succeed below
+      layout_( layout ), isOpen_( false ) // set to true when succeed below
    {
-      //???  check if cvector already been written (can't write twice)
+      if ( layout_ != PACKET_LAYOUT_INTERLEAVED && layout_ != PACKET_LAYOUT_COLUMNAR )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "layout=" + toString( layout_ ) + " imageFileName=" +
+                                                              cVector_->imageFileName() +
+                                                              " cvPathName=" + cVector_->pathName() );
+      }
 
       /// Empty sbufs is an error
       if ( sbufs.empty() )
@@ -66,6 +80,8 @@ namespace e57
       /// Check sbufs well formed (matches proto exactly)
       setBuffers( sbufs ); //??? copy code here?
 
+      statistics_.bytestreams.resize( sbufs_.size() );
+
       /// For each individual sbuf, create an appropriate Encoder based on the
       /// cVector_ attributes
       for ( unsigned i = 0; i < sbufs_.size(); i++ )
@@ -85,6 +101,8 @@ namespace e57
             throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "sbufIndex=" + toString( i ) );
          }
 
+         statistics_.bytestreams.at( bytestreamNumber ).pathName = codecPath;
+
          /// EncoderFactory picks the appropriate encoder to match type declared in
          /// prototype
          bytestreams_.push_back(
@@ -106,13 +124,11 @@ namespace e57
       }
 #endif
 
-      ImageFileImplSharedPtr imf( ni->destImageFile_ );
+      lastPacketWritten_.assign( bytestreams_.size(), 0 );
 
-      /// Reserve space for CompressedVector binary section header, record location
-      /// so can save to when writer closes. Request that file be extended with
-      /// zeros since we will write to it at a later time (when writer closes).
-      sectionHeaderLogicalStart_ = imf->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+      ImageFileImplSharedPtr imf( ni->destImageFile_ );
 
+      sectionHeaderLogicalStart_ = 0;
       sectionLogicalLength_ = 0;
       dataPhysicalOffset_ = 0;
       topIndexPhysicalOffset_ = 0;
@@ -120,6 +136,18 @@ namespace e57
       dataPacketsCount_ = 0;
       indexPacketsCount_ = 0;
 
+      statisticsEnabled_ = imf->statisticsEnabled();
+
+      /// Write straight to the end of the file if no other writer is, otherwise spool packets until it is free
+      {
+         std::lock_guard<std::mutex> lock( imf->writeMutex_ );
+
+         if ( imf->tailWriter_ == nullptr )
+         {
+            takeTail( *imf );
+         }
+      }
+
       /// Just before return (and can't throw) increment writer count  ??? safer
       /// way to assure don't miss close?
       imf->incrWriterCount();
@@ -145,6 +173,17 @@ namespace e57
       {
          //??? report?
       }
+
+      /// Packets left spooled by a failed close() no longer count against the memory budget
+      if ( !spool_.empty() )
+      {
+         if ( ImageFileImplSharedPtr imf = cVector_->destImageFile_.lock() )
+         {
+            std::lock_guard<std::mutex> lock( imf->writeMutex_ );
+
+            imf->spooledBytes_ -= spool_.size();
+         }
+      }
    }
 
    void CompressedVectorWriterImpl::close()
@@ -169,6 +208,9 @@ namespace e57
       /// try to close again.
       isOpen_ = false;
 
+      /// The node's section is taken even if writing it fails below
+      cVector_->setWriterClosed();
+
       /// If have any data, write packet
       /// Write all remaining ioBuffers and internal encoder register cache into
       /// file. Know we are done when totalOutputAvailable() returns 0 after a
@@ -180,35 +222,64 @@ namespace e57
          flush();
       }
 
-      /// Compute length of whole section we just wrote (from section start to
-      /// current start of free space).
-      sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
+      cVector_->setRecordCount( recordCount_ );
+
+      std::lock_guard<std::mutex> lock( imf->writeMutex_ );
+
+      if ( !direct_ )
+      {
+         /// The whole section is spooled, write it now if the end of the file is free, otherwise once it is
+         SpooledSection section{ cVector_, std::move( spool_ ) };
+
+         if ( imf->tailWriter_ == nullptr )
+         {
+            writeSpooledSection( *imf, section );
+         }
+         else
+         {
+            imf->spooledSections_.push_back( std::move( section ) );
+         }
+      }
+      else
+      {
+         /// Compute length of whole section we just wrote (from section start to
+         /// current start of free space).
+         sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
 #ifdef E57_MAX_VERBOSE
-      std::cout << "  sectionLogicalLength_=" << sectionLogicalLength_ << std::endl; //???
+         std::cout << "  sectionLogicalLength_=" << sectionLogicalLength_ << std::endl; //???
 #endif
 
-      /// Prepare CompressedVectorSectionHeader
-      CompressedVectorSectionHeader header;
-      header.sectionLogicalLength = sectionLogicalLength_;
-      header.dataPhysicalOffset = dataPhysicalOffset_;      ///??? can be zero, if no data written ???not set yet
-      header.indexPhysicalOffset = topIndexPhysicalOffset_; ///??? can be zero, if no data written ???not set
-                                                            /// yet
+         /// Prepare CompressedVectorSectionHeader
+         CompressedVectorSectionHeader header;
+         header.sectionLogicalLength = sectionLogicalLength_;
+         header.dataPhysicalOffset = dataPhysicalOffset_;      ///??? can be zero, if no data written ???not set yet
+         header.indexPhysicalOffset = topIndexPhysicalOffset_; ///??? can be zero, if no data written ???not set
+                                                               /// yet
 #ifdef E57_MAX_VERBOSE
-      std::cout << "  CompressedVectorSectionHeader:" << std::endl;
-      header.dump( 4 ); //???
+         std::cout << "  CompressedVectorSectionHeader:" << std::endl;
+         header.dump( 4 ); //???
 #endif
 #ifdef E57_DEBUG
-      /// Verify OK before write it.
-      header.verify( imf->file_->length( CheckedFile::Physical ) );
+         /// Verify OK before write it.
+         header.verify( imf->file_->length( CheckedFile::Physical ) );
 #endif
 
-      /// Write header at beginning of section, previously allocated
-      imf->file_->seek( sectionHeaderLogicalStart_ );
-      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+         /// Write header at beginning of section, previously allocated
+         imf->file_->seek( sectionHeaderLogicalStart_ );
+         imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
 
-      /// Set address and size of associated CompressedVector
-      cVector_->setRecordCount( recordCount_ );
-      cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+         /// Set address of associated CompressedVector
+         cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+
+         /// Sections finished by other writers meanwhile can go to the end of the file now
+         imf->tailWriter_ = nullptr;
+
+         for ( auto &section : imf->spooledSections_ )
+         {
+            writeSpooledSection( *imf, section );
+         }
+         imf->spooledSections_.clear();
+      }
 
       /// Free channels
       bytestreams_.clear();
@@ -219,6 +290,58 @@ namespace e57
 #endif
    }
 
+   void CompressedVectorWriterImpl::writeSpooledSection( ImageFileImpl &imf, SpooledSection &section )
+   {
+      CompressedVectorSectionHeader header;
+      header.sectionLogicalLength = sizeof( header ) + section.packets.size();
+
+      const uint64_t sectionLogicalStart = imf.allocateSpace( header.sectionLogicalLength, false );
+
+      if ( !section.packets.empty() )
+      {
+         header.dataPhysicalOffset = imf.file_->logicalToPhysical( sectionLogicalStart + sizeof( header ) );
+      }
+
+      imf.file_->seek( sectionLogicalStart );
+      imf.file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+      if ( !section.packets.empty() )
+      {
+         imf.file_->write( section.packets.data(), section.packets.size() );
+      }
+
+      imf.spooledBytes_ -= section.packets.size();
+
+      section.cVector->setBinarySectionLogicalStart( sectionLogicalStart );
+   }
+
+   void CompressedVectorWriterImpl::takeTail( ImageFileImpl &imf )
+   {
+      imf.tailWriter_ = this;
+      direct_ = true;
+
+      /// Reserve space for CompressedVector binary section header, record location
+      /// so can save to when writer closes. Request that file be extended with
+      /// zeros since we will write to it at a later time (when writer closes).
+      sectionHeaderLogicalStart_ = imf.allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+
+      /// Packets spooled so far go right after it
+      if ( !spool_.empty() )
+      {
+         const uint64_t spoolLogicalStart = imf.allocateSpace( spool_.size(), false );
+
+         dataPhysicalOffset_ = imf.file_->logicalToPhysical( spoolLogicalStart );
+
+         imf.file_->seek( spoolLogicalStart );
+         imf.file_->write( spool_.data(), spool_.size() );
+
+         imf.spooledBytes_ -= spool_.size();
+
+         spool_.clear();
+         spool_.shrink_to_fit();
+      }
+   }
+
    bool CompressedVectorWriterImpl::isOpen() const
    {
       /// don't checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__), or
@@ -231,6 +354,11 @@ namespace e57
       return cVector_;
    }
 
+   CompressedVectorWriterStatistics CompressedVectorWriterImpl::statistics() const
+   {
+      return statistics_;
+   }
+
    void CompressedVectorWriterImpl::setBuffers( std::vector<SourceDestBuffer> &sbufs )
    {
       /// don't checkImageFileOpen
@@ -334,8 +462,14 @@ namespace e57
 #else
          constexpr size_t E57_TARGET_PACKET_SIZE = ( DATA_PACKET_MAX * 3 / 4 );
 #endif
+         /// In columnar layout, wait until a single bytestream can fill most of a packet by itself.
+         const size_t readyPacketSize =
+            ( layout_ == PACKET_LAYOUT_COLUMNAR )
+               ? sizeof( DataPacketHeader ) + bytestreams_.size() * sizeof( uint16_t ) + largestOutputAvailable()
+               : currentPacketSize();
+
          /// If have more than target fraction of packet, send it now
-         if ( currentPacketSize() >= E57_TARGET_PACKET_SIZE )
+         if ( readyPacketSize >= E57_TARGET_PACKET_SIZE )
          { //???
             packetWrite();
             continue; /// restart loop so recalc statistics (packet size may not be
@@ -363,13 +497,19 @@ namespace e57
 
          ///!!!! For now just process one record per loop until packet is full
          /// enough, or completed request
-         for ( auto &bytestream : bytestreams_ )
+         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
          {
+            auto &bytestream = bytestreams_[i];
+
             if ( bytestream->currentRecordIndex() < endRecordIndex )
             {
                //!!! For now, process up to 50 records at a time
                uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
                recordCount = ( recordCount < 50ULL ) ? recordCount : 50ULL; // min(recordCount, 50ULL);
+
+               ScopedTimer<uint64_t> timer( statisticsEnabled_ ? &statistics_.bytestreams[i].cpuNanoseconds
+                                                               : nullptr );
+
                bytestream->processRecords( static_cast<unsigned>( recordCount ) );
             }
          }
@@ -377,6 +517,11 @@ namespace e57
 
       recordCount_ += requestedRecordCount;
 
+      if ( statisticsEnabled_ )
+      {
+         statistics_.recordsWritten += requestedRecordCount;
+      }
+
       /// When we leave this function, will likely still have data in channel
       /// ioBuffers as well as partial words in Encoder registers.
    }
@@ -399,8 +544,102 @@ namespace e57
       return ( sizeof( DataPacketHeader ) + bytestreams_.size() * sizeof( uint16_t ) + totalOutputAvailable() );
    }
 
+   size_t CompressedVectorWriterImpl::largestOutputAvailable() const
+   {
+      size_t largest = 0;
+
+      for ( const auto &bytestream : bytestreams_ )
+      {
+         largest = std::max( largest, bytestream->outputAvailable() );
+      }
+
+      return largest;
+   }
+
+   void CompressedVectorWriterImpl::calcInterleavedCounts( size_t packetMaxPayloadBytes,
+                                                           std::vector<size_t> &count ) const
+   {
+      const size_t totalOutput = totalOutputAvailable();
+
+      /// See if we can fit into a single data packet
+      if ( totalOutput < packetMaxPayloadBytes )
+      {
+         /// We can fit everything in one packet
+         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+         {
+            count.at( i ) = bytestreams_.at( i )->outputAvailable();
+         }
+      }
+      else
+      {
+         /// We have too much data for one packet.  Send proportional amounts from
+         /// each bytestream. Adjust packetMaxPayloadBytes down by one so have a
+         /// little slack for floating point weirdness.
+         float fractionToSend = ( packetMaxPayloadBytes - 1 ) / static_cast<float>( totalOutput );
+         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+         {
+            /// Round down here so sum <= packetMaxPayloadBytes
+            count.at( i ) =
+               static_cast<unsigned>( std::floor( fractionToSend * bytestreams_.at( i )->outputAvailable() ) );
+         }
+      }
+   }
+
+   void CompressedVectorWriterImpl::calcColumnarCounts( size_t packetMaxPayloadBytes, std::vector<size_t> &count ) const
+   {
+      /// Bytestreams that have been left out of too many packets go first, then the rest by most output available.
+      std::vector<unsigned> order( bytestreams_.size() );
+      std::iota( order.begin(), order.end(), 0 );
+
+      auto isOverdue = [this]( unsigned i ) {
+         return ( bytestreams_[i]->outputAvailable() > 0 ) &&
+                ( dataPacketsCount_ - lastPacketWritten_[i] >= COLUMNAR_MAX_SKEW_PACKETS );
+      };
+
+      std::stable_sort( order.begin(), order.end(), [this, &isOverdue]( unsigned lhs, unsigned rhs ) {
+         if ( isOverdue( lhs ) != isOverdue( rhs ) )
+         {
+            return isOverdue( lhs );
+         }
+         return bytestreams_[lhs]->outputAvailable() > bytestreams_[rhs]->outputAvailable();
+      } );
+
+      /// Fill packet with whole bytestream outputs.  Only the first (dominant) bytestream, or an overdue one, is split
+      /// to fill the remaining space; the others wait so the packet isn't diluted with small fragments.
+      size_t remaining = packetMaxPayloadBytes;
+      bool first = true;
+
+      for ( unsigned i : order )
+      {
+         const size_t available = bytestreams_[i]->outputAvailable();
+
+         if ( available == 0 || remaining == 0 )
+         {
+            continue;
+         }
+
+         if ( available <= remaining )
+         {
+            count.at( i ) = available;
+         }
+         else if ( first || isOverdue( i ) )
+         {
+            count.at( i ) = remaining;
+         }
+         else
+         {
+            continue;
+         }
+
+         remaining -= count.at( i );
+         first = false;
+      }
+   }
+
    uint64_t CompressedVectorWriterImpl::packetWrite()
    {
+      E57_TRACE_SPAN( "packetWrite" );
+
 #ifdef E57_MAX_VERBOSE
       std::cout << "CompressedVectorWriterImpl::packetWrite() called" << std::endl; //???
 #endif
@@ -426,27 +665,13 @@ namespace e57
       /// file.
       std::vector<size_t> count( bytestreams_.size() );
 
-      /// See if we can fit into a single data packet
-      if ( totalOutput < packetMaxPayloadBytes )
+      if ( layout_ == PACKET_LAYOUT_COLUMNAR )
       {
-         /// We can fit everything in one packet
-         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
-         {
-            count.at( i ) = bytestreams_.at( i )->outputAvailable();
-         }
+         calcColumnarCounts( packetMaxPayloadBytes, count );
       }
       else
       {
-         /// We have too much data for one packet.  Send proportional amounts from
-         /// each bytestream. Adjust packetMaxPayloadBytes down by one so have a
-         /// little slack for floating point weirdness.
-         float fractionToSend = ( packetMaxPayloadBytes - 1 ) / static_cast<float>( totalOutput );
-         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
-         {
-            /// Round down here so sum <= packetMaxPayloadBytes
-            count.at( i ) =
-               static_cast<unsigned>( std::floor( fractionToSend * bytestreams_.at( i )->outputAvailable() ) );
-         }
+         calcInterleavedCounts( packetMaxPayloadBytes, count );
       }
 #ifdef E57_MAX_VERBOSE
       for ( unsigned i = 0; i < bytestreams_.size(); i++ )
@@ -559,12 +784,44 @@ namespace e57
       /// Double check that data packet is well formed
       dataPacket_.verify( packetLength );
 
-      /// Write whole data packet at beginning of free space in file
-      uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
-      uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
-      imf->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
-                                               // more explicit
-      imf->file_->write( packet, packetLength );
+      uint64_t packetPhysicalOffset = 0;
+
+      {
+         ScopedTimer<uint64_t> timer( statisticsEnabled_ ? &statistics_.ioNanoseconds : nullptr );
+
+         std::lock_guard<std::mutex> lock( imf->writeMutex_ );
+
+         if ( !direct_ && ( imf->tailWriter_ == nullptr ) )
+         {
+            takeTail( *imf );
+         }
+
+         if ( direct_ )
+         {
+            /// Write whole data packet at beginning of free space in file
+            uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
+            packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
+            imf->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
+                                                     // more explicit
+            imf->file_->write( packet, packetLength );
+         }
+         else
+         {
+            /// Spooled packets of all writers together must fit in the memory budget
+            const uint64_t budget = imf->executionContext_.memoryBudget;
+
+            if ( ( budget != 0 ) && ( imf->spooledBytes_ + packetLength > budget ) )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
+                                     "fileName=" + imf->fileName() + " spooledBytes=" +
+                                        toString( imf->spooledBytes_ ) + " memoryBudget=" + toString( budget ) );
+            }
+
+            /// Physical offset isn't known until the spool is written to the file
+            spool_.insert( spool_.end(), packet, packet + packetLength );
+            imf->spooledBytes_ += packetLength;
+         }
+      }
 
 #ifdef E57_MAX_VERBOSE
 //  std::cout << "data packet:" << std::endl;
@@ -577,12 +834,30 @@ namespace e57
       ///??? what if have exceptions while write, what is state of file?  will
       /// close report file
       /// good/bad?
-      if ( dataPacketsCount_ == 0 )
+      if ( ( dataPacketsCount_ == 0 ) && direct_ )
       {
          dataPhysicalOffset_ = packetPhysicalOffset;
       }
       dataPacketsCount_++;
 
+      for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+      {
+         if ( count.at( i ) > 0 )
+         {
+            lastPacketWritten_.at( i ) = dataPacketsCount_;
+         }
+      }
+
+      if ( statisticsEnabled_ )
+      {
+         ++statistics_.packetsWritten;
+
+         for ( unsigned i = 0; i < bytestreams_.size(); i++ )
+         {
+            statistics_.bytestreams[i].bytes += count[i];
+         }
+      }
+
       ///!!! update seekIndex here? if started new chunk?
 
       /// Return physical offset of data packet for potential use in seekIndex
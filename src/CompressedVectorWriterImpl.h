@@ -27,6 +27,7 @@
  */
 
 #include "Encoder.h"
+#include "ImageFileImpl.h"
 #include "Packet.h"
 
 namespace e57
@@ -34,14 +35,19 @@ namespace e57
    class CompressedVectorWriterImpl
    {
    public:
-      CompressedVectorWriterImpl( std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer> &sbufs );
+      CompressedVectorWriterImpl( std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer> &sbufs,
+                                  PacketLayoutPolicy layout = PACKET_LAYOUT_INTERLEAVED );
       ~CompressedVectorWriterImpl();
       void write( const size_t requestedRecordCount );
       void write( std::vector<SourceDestBuffer> &sbufs, const size_t requestedRecordCount );
       bool isOpen() const;
       std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
+      CompressedVectorWriterStatistics statistics() const;
       void close();
 
+      /// Write a section at the end of the file.  Caller holds the ImageFileImpl's writeMutex_.
+      static void writeSpooledSection( ImageFileImpl &imf, SpooledSection &section );
+
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout );
 #endif
@@ -52,7 +58,11 @@ namespace e57
       void setBuffers( std::vector<SourceDestBuffer> &sbufs ); //???needed?
       size_t totalOutputAvailable() const;
       size_t currentPacketSize() const;
+      size_t largestOutputAvailable() const;
       uint64_t packetWrite();
+      void takeTail( ImageFileImpl &imf );
+      void calcInterleavedCounts( size_t packetMaxPayloadBytes, std::vector<size_t> &count ) const;
+      void calcColumnarCounts( size_t packetMaxPayloadBytes, std::vector<size_t> &count ) const;
       void flush();
 
       //??? no default ctor, copy, assignment?
@@ -64,7 +74,12 @@ namespace e57
       std::vector<std::shared_ptr<Encoder>> bytestreams_;
       DataPacket dataPacket_;
 
+      PacketLayoutPolicy layout_;
+      std::vector<uint64_t> lastPacketWritten_; /// for each bytestream, dataPacketsCount_ when it last had data written
+
       bool isOpen_;
+      bool direct_ = false;     /// packets go straight to the end of the file, otherwise to spool_
+      std::vector<char> spool_; /// packets written while another writer has the end of the file
       uint64_t sectionHeaderLogicalStart_; /// start of CompressedVector binary section
       uint64_t sectionLogicalLength_;      /// total length of CompressedVector binary section
       uint64_t dataPhysicalOffset_;        /// start of first data packet
@@ -72,5 +87,9 @@ namespace e57
       uint64_t recordCount_;               /// number of records written so far
       uint64_t dataPacketsCount_;          /// number of data packets written so far
       uint64_t indexPacketsCount_;         /// number of index packets written so far
+
+      /// Counters, only kept if the ImageFile had statistics enabled when the writer was created
+      bool statisticsEnabled_ = false;
+      CompressedVectorWriterStatistics statistics_; /// bytestreams is ordered like bytestreams_
    };
 }
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include "Data3DPointsAsyncReaderImpl.h"
+#include "Common.h"
+
+namespace e57
+{
+
+   template <typename COORDTYPE>
+   Data3DPointsAsyncReaderImpl<COORDTYPE>::Data3DPointsAsyncReaderImpl( const std::shared_ptr<ReaderImpl> &reader,
+                                                                        int64_t dataIndex, size_t pointCount,
+                                                                        const PointStandardizedFieldsAvailable &fields,
+                                                                        size_t bufferCount ) :
+      reader_( reader ), sets_( allocateSets( pointCount, fields, bufferCount ) ),
+      cvReader_( reader->SetUpData3DPointsData( dataIndex, pointCount, sets_[0].buffers ) ),
+      prefetch_( reader->GetRawIMF().executionContext().prefetch )
+   {
+      /// Every set gets dbufs in the same order as the reader's, so the reader can switch between them
+      for ( size_t i = 0; i < sets_.size(); ++i )
+      {
+         sets_[i].dbufs = reader_->SetUpData3DPointsBuffers( dataIndex, pointCount, sets_[i].buffers );
+         free_.push_back( i );
+      }
+   }
+
+   template <typename COORDTYPE> Data3DPointsAsyncReaderImpl<COORDTYPE>::~Data3DPointsAsyncReaderImpl()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         stopping_ = true;
+      }
+      changed_.notify_all();
+
+      if ( thread_.joinable() )
+      {
+         thread_.join();
+      }
+
+      try
+      {
+         cvReader_.close();
+      }
+      catch ( ... )
+      {
+         //??? report?
+      }
+   }
+
+   template <typename COORDTYPE>
+   std::vector<typename Data3DPointsAsyncReaderImpl<COORDTYPE>::BufferSet>
+      Data3DPointsAsyncReaderImpl<COORDTYPE>::allocateSets( size_t pointCount,
+                                                            const PointStandardizedFieldsAvailable &fields,
+                                                            size_t bufferCount )
+   {
+      if ( pointCount == 0 || bufferCount < 2 )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT,
+                               "pointCount=" + toString( pointCount ) + " bufferCount=" + toString( bufferCount ) );
+      }
+
+      std::vector<BufferSet> sets( bufferCount );
+
+      for ( auto &set : sets )
+      {
+         const size_t size = ReaderImpl::PlaceData3DPointsBuffers( set.buffers, fields, pointCount, nullptr );
+
+         set.storage.resize( size / sizeof( double ) );
+         ReaderImpl::PlaceData3DPointsBuffers( set.buffers, fields, pointCount,
+                                               reinterpret_cast<char *>( set.storage.data() ) );
+      }
+
+      return sets;
+   }
+
+   template <typename COORDTYPE>
+   CompressedVectorReader Data3DPointsAsyncReaderImpl<COORDTYPE>::compressedVectorReader() const
+   {
+      return cvReader_;
+   }
+
+   template <typename COORDTYPE>
+   size_t Data3DPointsAsyncReaderImpl<COORDTYPE>::acquire( Data3DPointsData_t<COORDTYPE> &buffers )
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      /// With every set acquired, nothing can be decoded, so waiting would never end
+      if ( acquired_.size() == sets_.size() )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "acquiredCount=" + toString( acquired_.size() ) );
+      }
+
+      if ( !prefetch_ )
+      {
+         /// Decode on the caller's thread, only when nothing decoded is waiting. A set is free, since not all are
+         /// acquired and none are ready.
+         if ( ready_.empty() )
+         {
+            BufferSet &set = sets_[free_.front()];
+            set.count = cvReader_.read( set.dbufs );
+
+            ready_.push_back( free_.front() );
+            free_.pop_front();
+         }
+      }
+      else
+      {
+         /// Decoding starts with the first acquire(), so the reader can be set up until then
+         if ( !thread_.joinable() )
+         {
+            thread_ = std::thread( &Data3DPointsAsyncReaderImpl::decodeLoop, this );
+         }
+
+         changed_.wait( lock, [this] { return !ready_.empty() || error_; } );
+      }
+
+      /// Batches decoded before an error are still returned
+      if ( ready_.empty() )
+      {
+         std::rethrow_exception( error_ );
+      }
+
+      const BufferSet &set = sets_[ready_.front()];
+
+      if ( set.count == 0 )
+      {
+         /// Leave the end marker, so later calls return 0 too
+         buffers = Data3DPointsData_t<COORDTYPE>();
+         return 0;
+      }
+
+      acquired_.push_back( ready_.front() );
+      ready_.pop_front();
+
+      buffers = set.buffers;
+      return set.count;
+   }
+
+   template <typename COORDTYPE> void Data3DPointsAsyncReaderImpl<COORDTYPE>::release()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( acquired_.empty() )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "acquiredCount=0" );
+         }
+
+         free_.push_back( acquired_.front() );
+         acquired_.pop_front();
+      }
+      changed_.notify_all();
+   }
+
+   template <typename COORDTYPE> void Data3DPointsAsyncReaderImpl<COORDTYPE>::decodeLoop()
+   {
+      try
+      {
+         while ( true )
+         {
+            size_t index;
+
+            {
+               std::unique_lock<std::mutex> lock( mutex_ );
+               changed_.wait( lock, [this] { return stopping_ || !free_.empty(); } );
+
+               if ( stopping_ )
+               {
+                  return;
+               }
+
+               index = free_.front();
+               free_.pop_front();
+            }
+
+            /// Only this thread touches the reader and a set being decoded into, so decode without the lock
+            BufferSet &set = sets_[index];
+            set.count = cvReader_.read( set.dbufs );
+
+            {
+               std::lock_guard<std::mutex> lock( mutex_ );
+               ready_.push_back( index );
+            }
+            changed_.notify_all();
+
+            if ( set.count == 0 )
+            {
+               return;
+            }
+         }
+      }
+      catch ( ... )
+      {
+         {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            error_ = std::current_exception();
+         }
+         changed_.notify_all();
+      }
+   }
+
+   // Explicit template instantiation
+   template class Data3DPointsAsyncReaderImpl<float>;
+   template class Data3DPointsAsyncReaderImpl<double>;
+
+} // end namespace e57
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "ReaderImpl.h"
+
+namespace e57
+{
+
+   //! Decodes batches of points on a background thread into a fixed number of buffer sets, or in acquire() if the
+   //! file's ExecutionContext disables prefetch
+   template <typename COORDTYPE> class Data3DPointsAsyncReaderImpl
+   {
+   public:
+      Data3DPointsAsyncReaderImpl( const std::shared_ptr<ReaderImpl> &reader, int64_t dataIndex, size_t pointCount,
+                                   const PointStandardizedFieldsAvailable &fields, size_t bufferCount );
+      ~Data3DPointsAsyncReaderImpl();
+
+      Data3DPointsAsyncReaderImpl( const Data3DPointsAsyncReaderImpl & ) = delete;
+      Data3DPointsAsyncReaderImpl &operator=( const Data3DPointsAsyncReaderImpl & ) = delete;
+
+      CompressedVectorReader compressedVectorReader() const;
+
+      size_t acquire( Data3DPointsData_t<COORDTYPE> &buffers );
+      void release();
+
+   private:
+      /// One set of buffers.  It is free, being decoded into, ready or acquired.
+      struct BufferSet
+      {
+         std::vector<double> storage; /// holds the buffers of all fields, aligned for any of them
+         Data3DPointsData_t<COORDTYPE> buffers;
+         std::vector<SourceDestBuffer> dbufs;
+         size_t count = 0; /// number of points decoded, 0 marks the end of the data
+      };
+
+      static std::vector<BufferSet> allocateSets( size_t pointCount, const PointStandardizedFieldsAvailable &fields,
+                                                  size_t bufferCount );
+
+      void decodeLoop();
+
+      std::shared_ptr<ReaderImpl> reader_; /// keeps the file open
+      std::vector<BufferSet> sets_;
+      CompressedVectorReader cvReader_;
+      bool prefetch_; /// decode on a background thread, otherwise in acquire()
+
+      std::mutex mutex_; /// guards everything below
+      std::condition_variable changed_;
+      std::deque<size_t> free_;     /// indices of sets that can be decoded into, in order
+      std::deque<size_t> ready_;    /// indices of decoded sets, in order
+      std::deque<size_t> acquired_; /// indices of sets held by the caller, in order
+      bool stopping_ = false;
+      std::exception_ptr error_;
+      std::thread thread_;
+   };
+
+} // end namespace e57
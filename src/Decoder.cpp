@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
 
 #include "CompressedVectorNodeImpl.h"
 #include "Decoder.h"
@@ -184,6 +185,99 @@ std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!
    }
 }
 
+//================================================================
+
+bool RecordSampling::isKept( uint64_t recordIndex ) const
+{
+   return ( distanceToRange( recordIndex ) == 0 ) && passesDecimation( recordIndex );
+}
+
+uint64_t RecordSampling::skipCount( uint64_t recordIndex, uint64_t limit ) const
+{
+   /// Return number of records from recordIndex up to next kept one, but no more than limit
+   uint64_t skip = 0;
+
+   while ( skip < limit )
+   {
+      const uint64_t index = recordIndex + skip;
+
+      /// Step over a gap between ranges at once
+      const uint64_t gap = distanceToRange( index );
+      if ( gap != 0 )
+      {
+         skip += std::min( gap, limit - skip );
+         continue;
+      }
+
+      if ( threshold == E57_UINT64_MAX )
+      {
+         /// Step to next multiple of interval at once.  If that is past the end of the range, the next pass steps
+         /// over the gap.
+         const uint64_t remainder = index % interval;
+         if ( remainder == 0 )
+         {
+            break;
+         }
+         skip += std::min( interval - remainder, limit - skip );
+      }
+      else
+      {
+         if ( passesDecimation( index ) )
+         {
+            break;
+         }
+         ++skip;
+      }
+   }
+
+   return skip;
+}
+
+uint64_t RecordSampling::distanceToRange( uint64_t recordIndex ) const
+{
+   /// Return number of records from recordIndex to start of next range, or 0 if recordIndex is in a range
+   if ( ranges.empty() )
+   {
+      return 0;
+   }
+
+   /// Find first range that begins after recordIndex.  recordIndex can only be in the one before it.
+   auto next = std::upper_bound( ranges.begin(), ranges.end(), recordIndex,
+                                 []( uint64_t index, const std::pair<uint64_t, uint64_t> &range ) {
+                                    return index < range.first;
+                                 } );
+
+   if ( next != ranges.begin() && recordIndex < std::prev( next )->second )
+   {
+      return 0;
+   }
+
+   return ( next == ranges.end() ) ? E57_UINT64_MAX - recordIndex : next->first - recordIndex;
+}
+
+bool RecordSampling::passesDecimation( uint64_t recordIndex ) const
+{
+   if ( recordIndex % interval != 0 )
+   {
+      return false;
+   }
+
+   if ( threshold == E57_UINT64_MAX )
+   {
+      return true;
+   }
+
+   /// Scramble index with the splitmix64 finalizer, so kept records are spread evenly but reproducibly
+   uint64_t z = recordIndex + seed + 0x9E3779B97F4A7C15ULL;
+   z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+   z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+   z = z ^ ( z >> 31 );
+
+   return ( z <= threshold );
+}
+
+//================================================================
+
 Decoder::Decoder( unsigned bytestreamNumber ) : bytestreamNumber_( bytestreamNumber )
 {
 }
@@ -391,6 +485,11 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    /// Calc how many whole records worth of data we have in inbuf
    size_t maxInputRecords = ( endBit - firstBit ) / ( 8 * typeSize );
 
+   if ( !sampling_.keepsAll() )
+   {
+      return inputProcessSampled( inbuf, maxInputRecords, typeSize );
+   }
+
    /// Can't process more records than we have input data for.
    if ( n > maxInputRecords )
    {
@@ -412,34 +511,30 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
       /// Form the starting address for first data location in inBuffer
       auto inp = reinterpret_cast<const float *>( inbuf );
 
-      /// Copy floats from inbuf to destBuffer_
+#ifdef E57_MAX_VERBOSE
       for ( unsigned i = 0; i < n; i++ )
       {
-         float value = *inp;
-
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  got float value=" << value << std::endl;
-#endif
-         destBuffer_->setNextFloat( value );
-         inp++;
+         std::cout << "  got float value=" << inp[i] << std::endl;
       }
+#endif
+
+      /// Copy floats from inbuf to destBuffer_
+      destBuffer_->setNextFloats( inp, n );
    }
    else
    { /// E57_DOUBLE precision
       /// Form the starting address for first data location in inBuffer
       auto inp = reinterpret_cast<const double *>( inbuf );
 
-      /// Copy doubles from inbuf to destBuffer_
+#ifdef E57_MAX_VERBOSE
       for ( unsigned i = 0; i < n; i++ )
       {
-         double value = *inp;
-
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  got double value=" << value << std::endl;
-#endif
-         destBuffer_->setNextDouble( value );
-         inp++;
+         std::cout << "  got double value=" << inp[i] << std::endl;
       }
+#endif
+
+      /// Copy doubles from inbuf to destBuffer_
+      destBuffer_->setNextDoubles( inp, n );
    }
 
    /// Update counts of records processed
@@ -449,6 +544,40 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    return ( n * 8 * typeSize );
 }
 
+size_t BitpackFloatDecoder::inputProcessSampled( const char *inbuf, size_t recordCount, size_t typeSize )
+{
+   /// Can't process more than defined in input file
+   recordCount = static_cast<size_t>( std::min<uint64_t>( recordCount, maxRecordCount_ - currentRecordIndex_ ) );
+
+   size_t i = 0;
+   while ( i < recordCount )
+   {
+      /// Skipped records are just stepped over
+      i += static_cast<size_t>( sampling_.skipCount( currentRecordIndex_ + i, recordCount - i ) );
+
+      if ( i == recordCount || destBuffer_->nextIndex() == destBuffer_->capacity() )
+      {
+         break;
+      }
+
+      if ( precision_ == E57_SINGLE )
+      {
+         destBuffer_->setNextFloat( reinterpret_cast<const float *>( inbuf )[i] );
+      }
+      else
+      {
+         destBuffer_->setNextDouble( reinterpret_cast<const double *>( inbuf )[i] );
+      }
+
+      ++i;
+   }
+
+   /// Update counts of records processed
+   currentRecordIndex_ += i;
+
+   return ( i * 8 * typeSize );
+}
+
 #ifdef E57_DEBUG
 void BitpackFloatDecoder::dump( int indent, std::ostream &os )
 {
@@ -497,6 +626,15 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
    /// available
    while ( currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable )
    {
+      const bool isKept = sampling_.isKept( currentRecordIndex_ );
+
+      /// Don't start a string that has nowhere to go
+      if ( isKept && readingPrefix_ && nBytesPrefixRead_ == 0 &&
+           destBuffer_->nextIndex() == destBuffer_->capacity() )
+      {
+         break;
+      }
+
 #ifdef E57_MAX_VERBOSE
       std::cout << "read string loop1: readingPrefix=" << readingPrefix_ << " prefixLength=" << prefixLength_
                 << " nBytesPrefixRead=" << nBytesPrefixRead_ << " nBytesStringRead=" << nBytesStringRead_ << std::endl;
@@ -585,8 +723,11 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
             nBytesProcess = static_cast<unsigned>( nBytesNeeded );
          }
 
-         /// Append to current string and update counts
-         currentString_ += ustring( inbuf, nBytesProcess );
+         /// Append to current string (unless it is being skipped) and update counts
+         if ( isKept )
+         {
+            currentString_ += ustring( inbuf, nBytesProcess );
+         }
          inbuf += nBytesProcess;
          nBytesRead += nBytesProcess;
          nBytesStringRead_ += nBytesProcess;
@@ -595,7 +736,10 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
          if ( nBytesStringRead_ == stringLength_ )
          {
             /// Save accumulated string to dest buffer
-            destBuffer_->setNextString( currentString_ );
+            if ( isKept )
+            {
+               destBuffer_->setNextString( currentString_ );
+            }
             currentRecordIndex_++;
 
             /// Get ready to read next prefix
@@ -689,6 +833,11 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    size_t bitCount = endBit - firstBit;
    size_t maxInputRecords = bitCount / bitsPerRecord_;
 
+   if ( !sampling_.keepsAll() )
+   {
+      return inputProcessSampled( reinterpret_cast<const RegisterT *>( inbuf ), firstBit, maxInputRecords );
+   }
+
    /// Number of transfers is the smaller of what was requested and what is
    /// available in input.
    size_t recordCount = std::min( destRecords, maxInputRecords );
@@ -720,71 +869,32 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
 
    size_t bitOffset = firstBit;
 
+   /// Values are collected in small batches, so the dest buffer can store each batch in one tight loop
+   int64_t values[SourceDestBufferImpl::BatchSize];
+   size_t valueCount = 0;
+
    for ( size_t i = 0; i < recordCount; i++ )
    {
-      /// Get lower word (contains at least the LSbit of the value),
-      RegisterT low = inp[wordPosition];
-
 #ifdef E57_MAX_VERBOSE
       std::cout << "  bitOffset: " << bitOffset << std::endl;
-      std::cout << "  low: " << binaryString( low ) << std::endl;
-#endif
-
-      RegisterT w;
-      if ( bitOffset == 0 )
-      {
-         /// The left shift (used below) is not defined if shift is >= size of
-         /// word
-         w = low;
-      }
-      // Avoid reading the next word, unless it is needed
-      // If the last record finishes on the last bit of input, avoid UMR
-      else if ( bitOffset + bitsPerRecord_ <= RegisterBits )
-      {
-         w = low >> bitOffset;
-      }
-      else
-      {
-         /// Get upper word (may or may not contain interesting bits),
-         RegisterT high = inp[wordPosition + 1];
-
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  high:" << binaryString( high ) << std::endl;
 #endif
 
-         /// Shift high to just above the lower bits, shift low LSBit to bit0,
-         /// OR together. Note shifts are logical (not arithmetic) because using
-         /// unsigned variables.
-         w = ( high << ( RegisterBits - bitOffset ) ) | ( low >> bitOffset );
-      }
+      RegisterT w = extractValue( inp, wordPosition, bitOffset );
 
 #ifdef E57_MAX_VERBOSE
       std::cout << "  w:   " << binaryString( w ) << std::endl;
 #endif
 
-      /// Mask off uninteresting bits
-      w &= destBitMask_;
-
       /// Add minimum_ to value to get back what writer originally sent
-      int64_t value = minimum_ + static_cast<uint64_t>( w );
-
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  Storing value=" << value << std::endl;
-#endif
+      values[valueCount++] = minimum_ + static_cast<uint64_t>( w );
 
-      /// The parameter isScaledInteger_ determines which version of
-      /// setNextInt64 gets called
-      if ( isScaledInteger_ )
-      {
-         destBuffer_->setNextInt64( value, scale_, offset_ );
-      }
-      else
+      /// Store the batch in next available positions in the user's dest buffer
+      if ( valueCount == SourceDestBufferImpl::BatchSize )
       {
-         destBuffer_->setNextInt64( value );
+         storeValues( values, valueCount );
+         valueCount = 0;
       }
 
-      /// Store the result in next available position in the user's dest buffer
-
       /// Calc next bit alignment and which word it starts in
       bitOffset += bitsPerRecord_;
       if ( bitOffset >= 8 * sizeof( RegisterT ) )
@@ -798,6 +908,8 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
 #endif
    }
 
+   storeValues( values, valueCount );
+
    /// Update counts of records processed
    currentRecordIndex_ += recordCount;
 
@@ -805,6 +917,119 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    return ( recordCount * bitsPerRecord_ );
 }
 
+template <typename RegisterT>
+size_t BitpackIntegerDecoder<RegisterT>::inputProcessSampled( const RegisterT *inp, const size_t firstBit,
+                                                              size_t recordCount )
+{
+   /// Can't process more than defined in input file
+   recordCount = static_cast<size_t>( std::min<uint64_t>( recordCount, maxRecordCount_ - currentRecordIndex_ ) );
+
+   /// Position of current record, counted in bits from start of inp
+   size_t bitPosition = firstBit;
+   size_t i = 0;
+
+   while ( i < recordCount )
+   {
+      /// Step over skipped records arithmetically, without extracting them
+      const auto skip = static_cast<size_t>( sampling_.skipCount( currentRecordIndex_ + i, recordCount - i ) );
+
+      i += skip;
+      bitPosition += skip * bitsPerRecord_;
+
+      if ( i == recordCount || destBuffer_->nextIndex() == destBuffer_->capacity() )
+      {
+         break;
+      }
+
+      storeValue( extractValue( inp, bitPosition / RegisterBits, bitPosition % RegisterBits ) );
+
+      ++i;
+      bitPosition += bitsPerRecord_;
+   }
+
+   /// Update counts of records processed
+   currentRecordIndex_ += i;
+
+   /// Return number of bits processed.
+   return ( i * bitsPerRecord_ );
+}
+
+template <typename RegisterT>
+inline RegisterT BitpackIntegerDecoder<RegisterT>::extractValue( const RegisterT *inp, size_t wordPosition,
+                                                                 size_t bitOffset ) const
+{
+   /// Get lower word (contains at least the LSbit of the value),
+   RegisterT low = inp[wordPosition];
+
+   RegisterT w;
+   if ( bitOffset == 0 )
+   {
+      /// The left shift (used below) is not defined if shift is >= size of
+      /// word
+      w = low;
+   }
+   // Avoid reading the next word, unless it is needed
+   // If the last record finishes on the last bit of input, avoid UMR
+   else if ( bitOffset + bitsPerRecord_ <= RegisterBits )
+   {
+      w = low >> bitOffset;
+   }
+   else
+   {
+      /// Get upper word (may or may not contain interesting bits),
+      RegisterT high = inp[wordPosition + 1];
+
+      /// Shift high to just above the lower bits, shift low LSBit to bit0,
+      /// OR together. Note shifts are logical (not arithmetic) because using
+      /// unsigned variables.
+      w = ( high << ( RegisterBits - bitOffset ) ) | ( low >> bitOffset );
+   }
+
+   /// Mask off uninteresting bits
+   return ( w & destBitMask_ );
+}
+
+template <typename RegisterT>
+inline void BitpackIntegerDecoder<RegisterT>::storeValues( const int64_t *values, size_t count )
+{
+   if ( count == 0 )
+   {
+      return;
+   }
+
+   /// The parameter isScaledInteger_ determines which version of
+   /// setNextInt64s gets called
+   if ( isScaledInteger_ )
+   {
+      destBuffer_->setNextInt64s( values, count, scale_, offset_ );
+   }
+   else
+   {
+      destBuffer_->setNextInt64s( values, count );
+   }
+}
+
+template <typename RegisterT> inline void BitpackIntegerDecoder<RegisterT>::storeValue( RegisterT w )
+{
+   /// Add minimum_ to value to get back what writer originally sent
+   int64_t value = minimum_ + static_cast<uint64_t>( w );
+
+#ifdef E57_MAX_VERBOSE
+   std::cout << "  Storing value=" << value << std::endl;
+#endif
+
+   /// The parameter isScaledInteger_ determines which version of
+   /// setNextInt64 gets called
+   if ( isScaledInteger_ )
+   {
+      destBuffer_->setNextInt64( value, scale_, offset_ );
+   }
+   else
+   {
+      destBuffer_->setNextInt64( value );
+   }
+}
+
 #ifdef E57_DEBUG
 template <typename RegisterT> void BitpackIntegerDecoder<RegisterT>::dump( int indent, std::ostream &os )
 {
@@ -851,6 +1076,34 @@ size_t ConstantIntegerDecoder::inputProcess( const char *source, const size_t av
    /// We don't need any input bytes to produce output, so ignore source and
    /// availableByteCount.
 
+   if ( !sampling_.keepsAll() )
+   {
+      const uint64_t startRecordIndex = currentRecordIndex_;
+
+      /// Fill dest buffer with kept records, unless get to maxRecordCount
+      while ( currentRecordIndex_ < maxRecordCount_ )
+      {
+         currentRecordIndex_ += sampling_.skipCount( currentRecordIndex_, maxRecordCount_ - currentRecordIndex_ );
+
+         if ( currentRecordIndex_ == maxRecordCount_ || destBuffer_->nextIndex() == destBuffer_->capacity() )
+         {
+            break;
+         }
+
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextInt64( minimum_, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextInt64( minimum_ );
+         }
+         ++currentRecordIndex_;
+      }
+
+      return static_cast<size_t>( currentRecordIndex_ - startRecordIndex );
+   }
+
    /// Fill dest buffer unless get to maxRecordCount
    size_t count = destBuffer_->capacity() - destBuffer_->nextIndex();
    uint64_t remainingRecordCount = maxRecordCount_ - currentRecordIndex_;
@@ -31,6 +31,30 @@
 
 namespace e57
 {
+   /// Selects the records a decoder stores in its dest buffer.  The others are skipped without being converted.  The
+   /// choice only depends on the record index, so all channels of a reader keep the same records.
+   struct RecordSampling
+   {
+      uint64_t interval = 1;               /// keep records whose index is a multiple of interval
+      uint64_t threshold = E57_UINT64_MAX; /// keep records whose hashed index is <= threshold
+      uint64_t seed = 0;                   /// perturbs the hash, so different seeds select different records
+
+      /// Sorted, disjoint [begin, end) index ranges of records to keep, empty to keep records anywhere
+      std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+      bool keepsAll() const
+      {
+         return ( interval == 1 ) && ( threshold == E57_UINT64_MAX ) && ranges.empty();
+      }
+
+      bool isKept( uint64_t recordIndex ) const;
+      uint64_t skipCount( uint64_t recordIndex, uint64_t limit ) const;
+
+   private:
+      bool passesDecimation( uint64_t recordIndex ) const;
+      uint64_t distanceToRange( uint64_t recordIndex ) const;
+   };
+
    class Decoder
    {
    public:
@@ -48,6 +72,10 @@ namespace e57
       {
          return bytestreamNumber_;
       }
+      void setSampling( const RecordSampling &sampling )
+      {
+         sampling_ = sampling;
+      }
 #ifdef E57_DEBUG
       virtual void dump( int indent = 0, std::ostream &os = std::cout ) = 0;
 #endif
@@ -56,6 +84,7 @@ namespace e57
       Decoder( unsigned bytestreamNumber );
 
       unsigned int bytestreamNumber_;
+      RecordSampling sampling_;
    };
 
    class BitpackDecoder : public Decoder
@@ -107,6 +136,8 @@ namespace e57
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
    protected:
+      size_t inputProcessSampled( const char *inbuf, size_t recordCount, size_t typeSize );
+
       FloatPrecision precision_ = E57_SINGLE;
    };
 
@@ -142,6 +173,11 @@ namespace e57
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
    protected:
+      size_t inputProcessSampled( const RegisterT *inp, const size_t firstBit, const size_t recordCount );
+      RegisterT extractValue( const RegisterT *inp, size_t wordPosition, size_t bitOffset ) const;
+      void storeValue( RegisterT w );
+      void storeValues( const int64_t *values, size_t count );
+
       bool isScaledInteger_;
       int64_t minimum_;
       int64_t maximum_;
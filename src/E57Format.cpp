@@ -30,6 +30,8 @@
 
 //! @file E57Format.cpp
 
+#include <cmath>
+
 #include "BlobNodeImpl.h"
 #include "CompressedVectorNodeImpl.h"
 #include "CompressedVectorReaderImpl.h"
@@ -740,8 +742,8 @@ void CompressedVectorWriter::checkInvariant( bool /*doRecurse*/ )
       throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
    }
 
-   // Dest ImageFile must have exactly 1 writer (this one)
-   if ( imf.writerCount() != 1 )
+   // Dest ImageFile must have at least 1 writer (this one)
+   if ( imf.writerCount() < 1 )
    {
       throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
    }
@@ -1155,6 +1157,60 @@ Node::Node( NodeImplSharedPtr ni ) : impl_( ni )
 }
 //! @endcond
 
+//=====================================================================================
+/*!
+@brief   Split and check a path name once, for lookups with StructureNode::get(const PathName&) const and
+VectorNode::get(const PathName&) const.
+@param   [in] imf        The ImageFile whose extensions the prefixes of extended element names must be declared in.
+@param   [in] pathName   The absolute pathname, or relative pathname.
+@details
+Looking up a node parses its path name on every call. A PathName holds the element names of a path that is looked up
+often, such as the fields of every scan in a file, so they are only parsed here. Prefixes can't be removed from an
+ImageFile, so the PathName stays valid for its nodes.
+@pre     The ImageFile must be open (i.e. imf.isOpen()).
+@throw   ::E57_ERROR_BAD_PATH_NAME
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@see     StructureNode::isDefined(const PathName&) const, VectorNode::isDefined(const PathName&) const
+*/
+PathName::PathName( const ImageFile &imf, const ustring &pathName ) : pathName_( pathName )
+{
+   ImageFileImplSharedPtr imfi( imf.impl() );
+
+   if ( !imfi->isOpen() )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_IMAGEFILE_NOT_OPEN, "fileName=" + imfi->fileName() );
+   }
+
+   imfi->pathNameParse( pathName, isRelative_, elementNames_ );
+}
+
+/*!
+@brief   Get the path name the PathName was created with.
+@return  The path name.
+*/
+const ustring &PathName::str() const
+{
+   return pathName_;
+}
+
+/*!
+@brief   Is the path relative to the node it is looked up in.
+@return  false if the path name starts with a "/".
+*/
+bool PathName::isRelative() const
+{
+   return isRelative_;
+}
+
+/*!
+@brief   Get the element names of the path, outermost first.
+@return  The element names between the "/" of the path name.
+*/
+const std::vector<ustring> &PathName::elementNames() const
+{
+   return elementNames_;
+}
+
 //=====================================================================================
 /*!
 @class StructureNode
@@ -1287,6 +1343,23 @@ bool StructureNode::isDefined( const ustring &pathName ) const
    return impl_->isDefined( pathName );
 }
 
+/*!
+@brief   Is the given pathName defined relative to this node.
+@param   [in] pathName   The path name, parsed once for several lookups.
+@details
+Same as isDefined(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@post    No visible state is modified.
+@return  true if pathName is currently defined.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PathName
+*/
+bool StructureNode::isDefined( const PathName &pathName ) const
+{
+   return impl_->isDefined( pathName );
+}
+
 /*!
 @brief   Get a child element by positional index.
 @param   [in] index   The index of child element to get, starting at 0.
@@ -1332,6 +1405,25 @@ Node StructureNode::get( const ustring &pathName ) const
    return Node( impl_->get( pathName ) );
 }
 
+/*!
+@brief   Get a child by path name.
+@param   [in] pathName   The path name, parsed once for several lookups.
+@details
+Same as get(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a pathName must be defined (i.e. isDefined(pathName)).
+@post    No visible state is modified.
+@return  A smart Node handle referencing the child node.
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PathName
+*/
+Node StructureNode::get( const PathName &pathName ) const
+{
+   return Node( impl_->get( pathName ) );
+}
+
 /*!
 @brief   Add a new child at a given path
     @param   [in] pathName  The absolute pathname, or pathname relative to this
@@ -1614,6 +1706,23 @@ bool VectorNode::isDefined( const ustring &pathName ) const
    return impl_->isDefined( pathName );
 }
 
+/*!
+@brief   Is the given pathName defined relative to this node.
+@param   [in] pathName   The path name, parsed once for several lookups.
+@details
+Same as isDefined(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@post    No visible state is modified.
+@return  true if pathName is currently defined.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PathName, StructureNode::isDefined(const PathName&) const
+*/
+bool VectorNode::isDefined( const PathName &pathName ) const
+{
+   return impl_->isDefined( pathName );
+}
+
 /*!
 @brief   Get a child element by positional index.
 @param   [in] index   The index of child element to get, starting at 0.
@@ -1658,6 +1767,25 @@ Node VectorNode::get( const ustring &pathName ) const
    return Node( impl_->get( pathName ) );
 }
 
+/*!
+@brief   Get a child element by path name.
+@param   [in] pathName   The path name, parsed once for several lookups.
+@details
+Same as get(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a pathName must be defined (i.e. isDefined(pathName)).
+@post    No visible state is modified.
+@return  A smart Node handle referencing the child node.
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     PathName, StructureNode::get(const PathName&) const
+*/
+Node VectorNode::get( const PathName &pathName ) const
+{
+   return Node( impl_->get( pathName ) );
+}
+
 /*!
 @brief   Append a child element to end of VectorNode.
 @param   [in] n   The node to be added as a child at end of the VectorNode.
@@ -2162,6 +2290,57 @@ void SourceDestBuffer::dump( int indent, std::ostream &os ) const
 }
 #endif
 
+//=====================================================================================
+/*!
+@brief   Create a range condition on one field.
+@param   [in] pathName  Path name of the field, relative to the CompressedVectorNode prototype.
+@param   [in] minimum   Smallest value accepted.
+@param   [in] maximum   Largest value accepted.
+@see     CompressedVectorReader::setFilter
+*/
+ReadFilterCondition::ReadFilterCondition( const ustring &pathName, double minimum, double maximum ) :
+   pathName( pathName ), minimum( minimum ), maximum( maximum )
+{
+}
+
+//=====================================================================================
+/*!
+@brief   Create a run of records.
+@param   [in] start     Index of the first record of the run in the CompressedVectorNode.
+@param   [in] count     Number of records in the run.
+@see     CompressedVectorReader::setRecordRanges
+*/
+RecordRange::RecordRange( uint64_t start, uint64_t count ) : start( start ), count( count )
+{
+}
+
+//=====================================================================================
+/*!
+@brief   Test whether the transform leaves every point where it is.
+@return  true if rotation is the identity matrix and translation is zero.
+@see     CompressedVectorReader::setTransform
+*/
+bool ReadTransform::isIdentity() const
+{
+   for ( int row = 0; row < 3; ++row )
+   {
+      for ( int col = 0; col < 3; ++col )
+      {
+         if ( rotation[row][col] != ( ( row == col ) ? 1. : 0. ) )
+         {
+            return false;
+         }
+      }
+
+      if ( translation[row] != 0. )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
 //=====================================================================================
 /*!
 @class CompressedVectorReader
@@ -2345,6 +2524,217 @@ unsigned CompressedVectorReader::read( std::vector<SourceDestBuffer> &dbufs )
    return impl_->read( dbufs );
 }
 
+/*!
+@brief   Only return records whose field values satisfy all of the given conditions.
+@param   [in] conditions    Range conditions that a record must all pass to be
+returned. An empty vector removes the filter.
+@details
+Each condition refers to one of the SourceDestBuffers given to this
+CompressedVectorReader by its path name, and is tested against the value as
+stored in that buffer (i.e. after any scaling and conversion). Records that fail
+are dropped right after they are decoded, and the records that pass are packed
+at the beginning of the buffers.
+
+While a filter is set, read() keeps decoding until the SourceDestBuffers are full
+of passing records or the end of the CompressedVectorNode is reached, so a
+return value of 0 still means there are no more records.
+
+The filter applies to all following reads. It is not an error to call this
+function between reads.
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_BAD_API_ARGUMENT     A pathName doesn't match a SourceDestBuffer, or the buffer isn't numeric
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ReadFilterCondition, CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setFilter( const std::vector<ReadFilterCondition> &conditions )
+{
+   impl_->setFilter( conditions );
+}
+
+/*!
+@brief   Only return every Nth record of the CompressedVectorNode.
+@param   [in] interval  Distance between returned records. 1 returns every record.
+@details
+A record is returned if its index in the CompressedVectorNode is a multiple of
+interval. The records in between are stepped over by the decoders without being
+converted or stored, which is much cheaper than reading everything and throwing
+most of it away. The bytes of each packet still have to be read from the file.
+
+Decimation applies to the records that have not been decoded yet, so it may be
+changed between reads. It replaces any earlier setDecimation() or
+setRandomDecimation(). Decimation is done before any filter set with setFilter().
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_BAD_API_ARGUMENT     interval is 0
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorReader::setRandomDecimation(), CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setDecimation( uint64_t interval )
+{
+   if ( interval == 0 )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "interval=" + toString( interval ) );
+   }
+
+   impl_->setDecimation( interval, E57_UINT64_MAX, 0 );
+}
+
+/*!
+@brief   Only return a deterministic random subset of the records of the CompressedVectorNode.
+@param   [in] rate  Fraction of the records to return, in (0, 1].
+@param   [in] seed  Selects a different subset for the same rate.
+@details
+Whether a record is returned depends only on its index in the
+CompressedVectorNode, the rate, and the seed, so reading the same
+CompressedVectorNode again with the same arguments returns the same records. The
+number of records returned is close to, but not exactly, rate times
+childCount(). As with setDecimation(), the records that are not returned are
+stepped over without being converted or stored.
+
+Decimation applies to the records that have not been decoded yet, so it may be
+changed between reads. It replaces any earlier setDecimation() or
+setRandomDecimation(). Decimation is done before any filter set with setFilter().
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_BAD_API_ARGUMENT     rate is not in (0, 1]
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorReader::setDecimation(), CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setRandomDecimation( double rate, uint64_t seed )
+{
+   if ( !( rate > 0.0 && rate <= 1.0 ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "rate=" + toString( rate ) );
+   }
+
+   /// Keep records whose hash falls in the lowest rate fraction of the 64 bit range
+   const double threshold = std::ldexp( rate, 64 );
+
+   if ( threshold < std::ldexp( 1.0, 64 ) )
+   {
+      impl_->setDecimation( 1, static_cast<uint64_t>( threshold ), seed );
+   }
+   else
+   {
+      impl_->setDecimation( 1, E57_UINT64_MAX, seed );
+   }
+}
+
+/*!
+@brief   Only return the records in the given index ranges of the CompressedVectorNode.
+@param   [in] ranges    The runs of records to return. An empty vector returns all records.
+@details
+The records outside the ranges are stepped over by the decoders without being
+converted or stored, like with setDecimation(). This is useful to read only some
+lines of a gridded scan, using the start indices and counts of its groupingByLine
+groups. Ranges may be given in any order, and may overlap.
+
+The ranges apply to the records that have not been decoded yet, so they may be
+changed between reads. They combine with setDecimation() or
+setRandomDecimation(): a record is returned if it is in a range and is selected
+by the decimation.
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     RecordRange, CompressedVectorReader::setDecimation(), CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setRecordRanges( const std::vector<RecordRange> &ranges )
+{
+   impl_->setRecordRanges( ranges );
+}
+
+/*!
+@brief   Transform coordinates while they are read.
+@param   [in] transform     The transform to apply, and the fields it applies to.
+An identity transform removes any earlier transform.
+@details
+The transform is applied by read() to each block of records right after it is
+decoded, so points arrive in the target coordinate system without the caller
+making a separate pass over the buffers. It is applied before any filter
+set with setFilter(), so filter ranges on the coordinate fields are in the
+transformed coordinate system.
+
+The three SourceDestBuffers must be all float or all double. The arithmetic is
+done in double precision, so double buffers should be used when the translation
+is large (e.g. georeferenced coordinates), as float buffers can't hold the
+result at full resolution.
+
+The transform applies to all following reads. It is not an error to call this
+function between reads.
+
+A transform may name the sphericalRange, sphericalAzimuth and sphericalElevation
+buffers only if setSphericalConversion() converts them to cartesian coordinates
+first. Otherwise the spherical values would be transformed as if they were x, y
+and z, so the call is rejected. For the same reason, the conversion can't be
+removed while such a transform is set.
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_BAD_API_ARGUMENT     A pathName doesn't match a SourceDestBuffer, the buffers aren't all
+float or all double, or spherical coordinates are transformed without being converted
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ReadTransform, CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setTransform( const ReadTransform &transform )
+{
+   impl_->setTransform( transform );
+}
+
+/*!
+@brief   Convert spherical coordinates to cartesian coordinates while they are read.
+@param   [in] conversion    The fields holding the spherical coordinates.
+An empty rangePathName turns conversion off.
+@details
+After each block of records is decoded, read() replaces the range, azimuth, and
+elevation in the three SourceDestBuffers with X, Y, and Z, as defined by the
+E57 standard:
+x = range * cos(elevation) * cos(azimuth),
+y = range * cos(elevation) * sin(azimuth),
+z = range * sin(elevation).
+Conversion is done before any transform set with setTransform() and before any
+filter set with setFilter(), so those work on the cartesian coordinates.
+
+If the invalid state field is named, points with state 1 (only direction is
+valid) are converted as if their range were 1, giving a unit direction vector,
+and points with state 2 (no data) are set to the origin. The states mean the
+same for cartesianInvalidState, so the buffer can be used as one.
+
+The trigonometry is done in double precision without branches, so the compiler
+can vectorize it. The sine and cosine have an absolute error below 2.5e-16 for
+angles up to 1e6 radians, so each coordinate is within a few ulps of range.
+
+The three coordinate SourceDestBuffers must be all float or all double. The
+invalid state buffer must be 8 bit integers.
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@throw   ::E57_ERROR_BAD_API_ARGUMENT     A pathName doesn't match a SourceDestBuffer, a buffer has the wrong type,
+or the conversion is removed while setTransform() transforms the spherical buffers
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ReadSphericalConversion, CompressedVectorReader::read()
+*/
+void CompressedVectorReader::setSphericalConversion( const ReadSphericalConversion &conversion )
+{
+   impl_->setSphericalConversion( conversion );
+}
+
 /*!
 @brief   Set record number of CompressedVectorNode where next read will start.
 @param   [in] recordNumber   The index of record in ComressedVectorNode where
@@ -2418,6 +2808,22 @@ CompressedVectorNode CompressedVectorReader::compressedVectorNode() const
    return impl_->compressedVectorNode();
 }
 
+/*!
+@brief   Get the performance counters of this CompressedVectorReader.
+@details
+Counters are kept only if the ImageFile had statistics enabled when the reader
+was created, and are otherwise zero. It is not an error if this
+CompressedVectorReader is closed.
+@post    No visible state is modified.
+@return  A snapshot of the counters, with one BytestreamStatistics per buffer
+given to the reader.
+@see     CompressedVectorReaderStatistics, ImageFile::setStatisticsEnabled
+*/
+CompressedVectorReaderStatistics CompressedVectorReader::statistics() const
+{
+   return impl_->statistics();
+}
+
 //! @brief   Diagnostic function to print internal state of object to output
 //! stream in an indented format.
 //! @copydetails Node::dump()
@@ -2535,6 +2941,9 @@ associated ImageFile modified but consistent.
 @throw   ::E57_ERROR_EXPECTING_USTRING  This CompressedVectorWriter in
 undocumented state, associated CompressedVectorNode modified but consistent,
 associated ImageFile modified but consistent.
+@throw   ::E57_ERROR_TOO_MANY_WRITERS   The packets kept in memory by the
+writers of the ImageFile would exceed its memoryBudget. This
+CompressedVectorWriter in undocumented state.
 @throw   ::E57_ERROR_LSEEK_FAILED       This CompressedVectorWriter, associated
 ImageFile in undocumented state
 @throw   ::E57_ERROR_READ_FAILED        This CompressedVectorWriter, associated
@@ -2606,6 +3015,9 @@ undocumented state, associated ImageFile modified but consistent.
 undocumented state, associated ImageFile modified but consistent.
 @throw   ::E57_ERROR_EXPECTING_USTRING  This CompressedVectorWriter in
 undocumented state, associated ImageFile modified but consistent.
+@throw   ::E57_ERROR_TOO_MANY_WRITERS   The packets kept in memory by the
+writers of the ImageFile would exceed its memoryBudget. This
+CompressedVectorWriter in undocumented state.
 @throw   ::E57_ERROR_LSEEK_FAILED       This CompressedVectorWriter, associated
 ImageFile in undocumented state
 @throw   ::E57_ERROR_READ_FAILED        This CompressedVectorWriter, associated
@@ -2640,6 +3052,9 @@ will have zero children).
 @pre     The associated ImageFile must be open.
 @post    This CompressedVectorWriter is closed (i.e !isOpen())
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_TOO_MANY_WRITERS   The packets kept in memory by the
+writers of the ImageFile would exceed its memoryBudget. This
+CompressedVectorWriter in undocumented state.
 @throw   ::E57_ERROR_LSEEK_FAILED       This CompressedVectorWriter, associated
 ImageFile in undocumented state
 @throw   ::E57_ERROR_READ_FAILED        This CompressedVectorWriter, associated
@@ -2682,6 +3097,23 @@ CompressedVectorNode CompressedVectorWriter::compressedVectorNode() const
    return impl_->compressedVectorNode();
 }
 
+/*!
+@brief   Get the performance counters of this CompressedVectorWriter.
+@details
+Counters are kept only if the ImageFile had statistics enabled when the writer
+was created, and are otherwise zero. It is not an error if this
+CompressedVectorWriter is closed; the counters then include the packets written
+by close().
+@post    No visible state is modified.
+@return  A snapshot of the counters, with one BytestreamStatistics per field of
+the prototype.
+@see     CompressedVectorWriterStatistics, ImageFile::setStatisticsEnabled
+*/
+CompressedVectorWriterStatistics CompressedVectorWriter::statistics() const
+{
+   return impl_->statistics();
+}
+
 //! @brief   Diagnostic function to print internal state of object to output
 //! stream in an indented format.
 //! @copydetails Node::dump()
@@ -2979,6 +3411,8 @@ CompressedVectorNode::CompressedVectorNode( std::shared_ptr<CompressedVectorNode
 CompressedVectorNode.
 @param   [in] sbufs         Vector of memory buffers that will hold data to be
 written to a CompressedVectorNode.
+@param   [in] layout        How bytestreams are arranged in the data packets.
+See ::PACKET_LAYOUT_INTERLEAVED and ::PACKET_LAYOUT_COLUMNAR.
 @details
 See CompressedVectorWriter::write(std::vector<SourceDestBuffer>&, unsigned) for
 discussion about restrictions on @a sbufs.
@@ -2991,17 +3425,29 @@ prototype.
 
 
 It is an error to call this function if the CompressedVectorNode already has any
-records (i.e. a CompressedVectorNode cannot be set twice).
+records (i.e. a CompressedVectorNode cannot be set twice), or while another
+writer of it is open.
+
+Writers of different CompressedVectorNodes in the same ImageFile may be open at
+the same time, and each may be used on its own thread. One of them writes its
+data packets straight to the end of the file. The others keep their packets in
+memory until the end of the file is free, so each binary section stays
+contiguous. If the ExecutionContext of the ImageFile has a memoryBudget, the
+packets kept in memory by all writers together must fit in it, otherwise
+CompressedVectorWriter::write throws ::E57_ERROR_TOO_MANY_WRITERS. The metadata
+tree must still be changed by one thread at a time, and BlobNodes can't be
+created while writers are open.
 
 @pre     @a sbufs can't be empty (i.e. sbufs.length() > 0).
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre     The @a destImageFile must have been opened in write mode (i.e.
 destImageFile.isWritable()).
-@pre     The destination ImageFile can't have any readers or writers open
-(destImageFile().readerCount()==0 && destImageFile().writerCount()==0)
+@pre     The destination ImageFile can't have any readers open
+(destImageFile().readerCount()==0)
 @pre     This CompressedVectorNode must be attached (i.e. isAttached()).
 @pre     This CompressedVectorNode must have no records (i.e. childCount() ==
 0).
+@pre     This CompressedVectorNode can't have a writer open.
 @return  A smart CompressedVectorWriter handle referencing the underlying
 iterator object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
@@ -3019,9 +3465,9 @@ iterator object.
 @see     CompressedVectorWriter, SourceDestBuffer, CompressedVectorNode::CompressedVectorNode,
 CompressedVectorNode::prototype
 */
-CompressedVectorWriter CompressedVectorNode::writer( std::vector<SourceDestBuffer> &sbufs )
+CompressedVectorWriter CompressedVectorNode::writer( std::vector<SourceDestBuffer> &sbufs, PacketLayoutPolicy layout )
 {
-   return CompressedVectorWriter( impl_->writer( sbufs ) );
+   return CompressedVectorWriter( impl_->writer( sbufs, layout ) );
 }
 
 /*!
@@ -3036,16 +3482,23 @@ CompressedVectorNode's prototype. It is an error for two SourceDestBuffers in @a
 dbufs to identify the same terminal node in the prototype. It is not an error to
 create a CompressedVectorReader for an empty CompressedVectorNode.
 
+Several readers of an ImageFile opened for reading may be open at the same
+time, and each may be used on its own thread. An ImageFile opened for writing
+can only have one reader open at a time.
+
 @pre     @a dbufs can't be empty
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre     The destination ImageFile can't have any writers open
 (destImageFile().writerCount()==0)
+@pre     If the destination ImageFile was opened in write mode, it can't have
+any readers open (destImageFile().readerCount()==0)
 @pre     This CompressedVectorNode must be attached (i.e. isAttached()).
 @return  A smart CompressedVectorReader handle referencing the underlying
 iterator object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
 @throw   ::E57_ERROR_TOO_MANY_WRITERS
+@throw   ::E57_ERROR_TOO_MANY_READERS
 @throw   ::E57_ERROR_NODE_UNATTACHED
 @throw   ::E57_ERROR_PATH_UNDEFINED
 @throw   ::E57_ERROR_BUFFER_SIZE_MISMATCH
@@ -4149,10 +4602,13 @@ true).
 @pre     The @a destImageFile must have been opened in write mode (i.e.
 destImageFile.isWritable() must be true).
 @pre     byteCount >= 0
+@pre     The @a destImageFile can't have any writers open
+(destImageFile.writerCount()==0)
 @return  A smart BlobNode handle referencing the underlying object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
 @throw   ::E57_ERROR_FILE_IS_READ_ONLY
+@throw   ::E57_ERROR_TOO_MANY_WRITERS
 @throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
 @see     Node, BlobNode::read, BlobNode::write
 */
@@ -4474,6 +4930,15 @@ Write API operations are not legal for an ImageFile opened in read mode (i.e.
 the ImageFile is read-only). There is no API support for appending data onto an
 existing E57 data file.
 
+@par Threads
+In read mode, CompressedVectorReader objects of the same ImageFile may be
+created, used and closed on different threads at the same time, e.g. to read
+several scans in parallel. File data is read with positional reads, so readers
+don't share a file position, and the node tree may be navigated from several
+threads since reading doesn't modify it. A single CompressedVectorReader must
+still only be used by one thread at a time. In write mode, the ImageFile must
+only be used by one thread at a time.
+
 @post    Resulting ImageFile is in @c open state if constructor succeeds (no
 exception thrown).
 @return  A smart ImageFile handle referencing the underlying object.
@@ -4508,6 +4973,51 @@ ImageFile::ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy
    impl_->construct2( input, size );
 }
 
+/*!
+@brief   Open an ImageFile with an ExecutionContext.
+@details Same as the constructors without @a context, but the file uses @a context from the start, so it also
+selects the parser of the XML section of a file opened for reading (see ExecutionContext::xmlParser).
+@see     ExecutionContext, ImageFile::setExecutionContext
+*/
+ImageFile::ImageFile( const ustring &fname, const ustring &mode, const ExecutionContext &context,
+                      ReadChecksumPolicy checksumPolicy ) :
+   impl_( new ImageFileImpl( checksumPolicy, context ) )
+{
+   impl_->construct2( fname, mode );
+}
+
+ImageFile::ImageFile( const char *input, const uint64_t size, const ExecutionContext &context,
+                      ReadChecksumPolicy checksumPolicy ) :
+   impl_( new ImageFileImpl( checksumPolicy, context ) )
+{
+   impl_->construct2( input, size );
+}
+
+/*!
+@brief   Create an ImageFile written to memory instead of a file.
+@param   [in] output The vector the file is written to. It is emptied first, and
+must outlive the ImageFile.
+@details Same as opening a file in "w" mode, but the pages, with their
+checksums, are written to @a output, which grows as needed. After close(),
+@a output holds the complete E57 file, which may be sent on or read back with
+the constructor taking a buffer. If the ImageFile is cancelled, @a output is
+emptied. The fileName() of the ImageFile is "<MemoryBuffer>".
+@post    Resulting ImageFile is in @c open state if constructor succeeds (no
+exception thrown).
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::close, ImageFile::cancel
+*/
+ImageFile::ImageFile( std::vector<char> &output ) : impl_( new ImageFileImpl( CHECKSUM_POLICY_ALL ) )
+{
+   impl_->construct2( output );
+}
+
+ImageFile::ImageFile( std::vector<char> &output, const ExecutionContext &context ) :
+   impl_( new ImageFileImpl( CHECKSUM_POLICY_ALL, context ) )
+{
+   impl_->construct2( output );
+}
+
 /*!
 @brief   Get the pre-established root StructureNode of the E57 ImageFile.
 @details The root node of an ImageFile always exists and is always type
@@ -4652,6 +5162,89 @@ int ImageFile::readerCount() const
    return impl_->readerCount();
 }
 
+/*!
+@brief   Set the threads and memory the library uses for work on this ImageFile.
+@param   [in] context   The thread count, executor, memory budget and prefetch
+setting to use.
+@details
+The context applies to calls started after it is set, so it should be set
+before any parallel work on the ImageFile begins, e.g. right after opening it.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    executionContext() returns a copy of @a context.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@see     ExecutionContext, ImageFile::executionContext
+*/
+void ImageFile::setExecutionContext( const ExecutionContext &context )
+{
+   impl_->setExecutionContext( context );
+}
+
+/*!
+@brief   Get the threads and memory the library uses for work on this ImageFile.
+@details
+An ImageFile that hasn't been given a context uses a default constructed
+ExecutionContext: one thread per hardware thread, no memory limit, and prefetch
+enabled.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  A copy of the ImageFile's ExecutionContext.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@see     ExecutionContext, ImageFile::setExecutionContext
+*/
+ExecutionContext ImageFile::executionContext() const
+{
+   return impl_->executionContext();
+}
+
+/*!
+@brief   Turn the performance counters of this ImageFile on or off.
+@param   [in] enabled   If true, count file I/O and keep counters in readers and
+writers created afterwards.
+@details
+Counters are off by default, and cost only a test of a flag while off. File I/O
+is counted from the moment they are turned on. A CompressedVectorReader or
+CompressedVectorWriter keeps counters only if they were on when it was created,
+so turn them on before creating it, and before reading or writing on several
+threads.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    statisticsEnabled() returns @a enabled.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@see     ImageFile::statistics, CompressedVectorReader::statistics,
+CompressedVectorWriter::statistics
+*/
+void ImageFile::setStatisticsEnabled( bool enabled )
+{
+   impl_->setStatisticsEnabled( enabled );
+}
+
+/*!
+@brief   Test whether the performance counters of this ImageFile are on.
+@post    No visible state is modified.
+@return  true if counters are kept.
+@see     ImageFile::setStatisticsEnabled
+*/
+bool ImageFile::statisticsEnabled() const
+{
+   return impl_->statisticsEnabled();
+}
+
+/*!
+@brief   Get the file I/O counters of this ImageFile.
+@details
+The counters cover all readers and writers of the ImageFile, on all threads,
+since statistics were enabled. Time is summed over threads, so it can be more
+than the wall clock time.
+@pre     This ImageFile must be open (i.e. isOpen()).
+@post    No visible state is modified.
+@return  A snapshot of the counters, all zero if statistics were never enabled.
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@see     ImageFileStatistics, ImageFile::setStatisticsEnabled
+*/
+ImageFileStatistics ImageFile::statistics() const
+{
+   return impl_->statistics();
+}
+
 /*!
 @brief   Declare the use of an E57 extension in an ImageFile being written.
 @param   [in] prefix    The shorthand name of the extension to use in element
@@ -6,6 +6,7 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#include "Common.h"
 #include "E57SimpleData.h"
 
 namespace e57
@@ -22,4 +23,54 @@ namespace e57
       elevationMaximum = M_PI / 2.;
    }
 
+   Data3DPointsField::Data3DPointsField( const ustring &name, MemoryRepresentation type, size_t offset ) :
+      name( name ), type( type ), offset( offset )
+   {
+   }
+
+   SourceDestBuffer Data3DPointsLayout::sourceDestBuffer( ImageFile imf, const Data3DPointsField &field,
+                                                          size_t count, bool doScaling ) const
+   {
+      char *base = static_cast<char *>( records ) + field.offset;
+
+      switch ( field.type )
+      {
+         case E57_INT8:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<int8_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_UINT8:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<uint8_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_INT16:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<int16_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_UINT16:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<uint16_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_INT32:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<int32_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_UINT32:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<uint32_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_INT64:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<int64_t *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_BOOL:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<bool *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_REAL32:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<float *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_REAL64:
+            return SourceDestBuffer( imf, field.name, reinterpret_cast<double *>( base ), count, true, doScaling,
+                                     stride );
+         case E57_USTRING:
+            break;
+      }
+
+      throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT,
+                            "name=" + field.name + " type=" + toString( static_cast<int>( field.type ) ) );
+   }
+
 } // end namespace e57
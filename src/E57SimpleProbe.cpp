@@ -0,0 +1,569 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include <cstdlib>
+#include <vector>
+
+#include "CheckedFile.h"
+#include "E57SimpleReader.h"
+#include "ImageFileImpl.h"
+#include "Trace.h"
+#include "XmlPullParser.h"
+
+namespace e57
+{
+   namespace
+   {
+      /// An element on the path to the one being parsed, with the attributes the summary uses
+      struct Element
+      {
+         ustring name;
+         ustring type;
+         ustring text;
+         int64_t minimum = E57_INT64_MIN;
+         int64_t maximum = E57_INT64_MAX;
+         double scale = 1.;
+         double offset = 0.;
+         bool singlePrecision = false;
+         int64_t count = 0; /// recordCount of a CompressedVector, length of a Blob
+      };
+
+      using ElementPath = std::vector<Element>;
+
+      Element startElement( const XmlPullParser &parser )
+      {
+         Element e;
+         e.name = parser.qName();
+
+         for ( const auto &attribute : parser.attributes() )
+         {
+            const ustring &name = attribute.qName;
+            const char *value = attribute.value.c_str();
+
+            if ( name == "type" )
+            {
+               e.type = attribute.value;
+            }
+            else if ( name == "minimum" )
+            {
+               e.minimum = std::strtoll( value, nullptr, 10 );
+            }
+            else if ( name == "maximum" )
+            {
+               e.maximum = std::strtoll( value, nullptr, 10 );
+            }
+            else if ( name == "scale" )
+            {
+               e.scale = std::strtod( value, nullptr );
+            }
+            else if ( name == "offset" )
+            {
+               e.offset = std::strtod( value, nullptr );
+            }
+            else if ( name == "precision" )
+            {
+               e.singlePrecision = ( attribute.value == "single" );
+            }
+            else if ( ( name == "recordCount" ) || ( name == "length" ) )
+            {
+               e.count = std::strtoll( value, nullptr, 10 );
+            }
+         }
+
+         return e;
+      }
+
+      bool isLeaf( const Element &e )
+      {
+         return ( e.type == "Integer" ) || ( e.type == "ScaledInteger" ) || ( e.type == "Float" ) ||
+                ( e.type == "String" ) || ( e.type == "Blob" );
+      }
+
+      /// Value of a numeric element, scaled if it is a ScaledInteger
+      double numberValue( const Element &e )
+      {
+         if ( e.type == "Integer" )
+         {
+            return static_cast<double>( std::strtoll( e.text.c_str(), nullptr, 10 ) );
+         }
+
+         if ( e.type == "ScaledInteger" )
+         {
+            return static_cast<double>( std::strtoll( e.text.c_str(), nullptr, 10 ) ) * e.scale + e.offset;
+         }
+
+         return std::strtod( e.text.c_str(), nullptr );
+      }
+
+      int64_t integerValue( const Element &e )
+      {
+         return std::strtoll( e.text.c_str(), nullptr, 10 );
+      }
+
+      /// Element names of path from index first on, separated by "/"
+      ustring relativePath( const ElementPath &path, size_t first )
+      {
+         ustring result;
+
+         for ( size_t i = first; i < path.size(); ++i )
+         {
+            if ( i != first )
+            {
+               result += '/';
+            }
+            result += path[i].name;
+         }
+
+         return result;
+      }
+
+      Data3DProbeField probeField( const ustring &name, const Element &e )
+      {
+         Data3DProbeField field;
+         field.name = name;
+
+         if ( e.type == "Integer" )
+         {
+            field.type = E57_INTEGER;
+         }
+         else if ( e.type == "ScaledInteger" )
+         {
+            field.type = E57_SCALED_INTEGER;
+            field.scale = e.scale;
+            field.offset = e.offset;
+         }
+         else if ( e.type == "Float" )
+         {
+            field.type = E57_FLOAT;
+            field.bitWidth = e.singlePrecision ? 32 : 64;
+         }
+         else
+         {
+            field.type = E57_STRING;
+         }
+
+         if ( ( field.type == E57_INTEGER ) || ( field.type == E57_SCALED_INTEGER ) )
+         {
+            field.minimum = e.minimum;
+            field.maximum = e.maximum;
+            field.bitWidth = ImageFileImpl::bitsNeeded( e.minimum, e.maximum );
+         }
+
+         return field;
+      }
+
+      bool setPose( RigidBodyTransform &pose, const ustring &path, const Element &e )
+      {
+         if ( path == "pose/rotation/w" )
+         {
+            pose.rotation.w = numberValue( e );
+         }
+         else if ( path == "pose/rotation/x" )
+         {
+            pose.rotation.x = numberValue( e );
+         }
+         else if ( path == "pose/rotation/y" )
+         {
+            pose.rotation.y = numberValue( e );
+         }
+         else if ( path == "pose/rotation/z" )
+         {
+            pose.rotation.z = numberValue( e );
+         }
+         else if ( path == "pose/translation/x" )
+         {
+            pose.translation.x = numberValue( e );
+         }
+         else if ( path == "pose/translation/y" )
+         {
+            pose.translation.y = numberValue( e );
+         }
+         else if ( path == "pose/translation/z" )
+         {
+            pose.translation.z = numberValue( e );
+         }
+         else
+         {
+            return false;
+         }
+
+         return true;
+      }
+
+      void setRootValue( E57Root &root, const ustring &path, const Element &e )
+      {
+         if ( path == "formatName" )
+         {
+            root.formatName = e.text;
+         }
+         else if ( path == "guid" )
+         {
+            root.guid = e.text;
+         }
+         else if ( path == "versionMajor" )
+         {
+            root.versionMajor = static_cast<uint32_t>( integerValue( e ) );
+         }
+         else if ( path == "versionMinor" )
+         {
+            root.versionMinor = static_cast<uint32_t>( integerValue( e ) );
+         }
+         else if ( path == "e57LibraryVersion" )
+         {
+            root.e57LibraryVersion = e.text;
+         }
+         else if ( path == "coordinateMetadata" )
+         {
+            root.coordinateMetadata = e.text;
+         }
+         else if ( path == "creationDateTime/dateTimeValue" )
+         {
+            root.creationDateTime.dateTimeValue = numberValue( e );
+         }
+         else if ( path == "creationDateTime/isAtomicClockReferenced" )
+         {
+            root.creationDateTime.isAtomicClockReferenced = static_cast<int32_t>( integerValue( e ) );
+         }
+      }
+
+      void setData3DValue( Data3DProbe &data3D, const ustring &path, const Element &e )
+      {
+         if ( path == "name" )
+         {
+            data3D.name = e.text;
+         }
+         else if ( path == "guid" )
+         {
+            data3D.guid = e.text;
+         }
+         else if ( setPose( data3D.pose, path, e ) )
+         {
+         }
+         else if ( path == "indexBounds/rowMinimum" )
+         {
+            data3D.indexBounds.rowMinimum = integerValue( e );
+         }
+         else if ( path == "indexBounds/rowMaximum" )
+         {
+            data3D.indexBounds.rowMaximum = integerValue( e );
+         }
+         else if ( path == "indexBounds/columnMinimum" )
+         {
+            data3D.indexBounds.columnMinimum = integerValue( e );
+         }
+         else if ( path == "indexBounds/columnMaximum" )
+         {
+            data3D.indexBounds.columnMaximum = integerValue( e );
+         }
+         else if ( path == "indexBounds/returnMinimum" )
+         {
+            data3D.indexBounds.returnMinimum = integerValue( e );
+         }
+         else if ( path == "indexBounds/returnMaximum" )
+         {
+            data3D.indexBounds.returnMaximum = integerValue( e );
+         }
+         else if ( path == "cartesianBounds/xMinimum" )
+         {
+            data3D.cartesianBounds.xMinimum = numberValue( e );
+         }
+         else if ( path == "cartesianBounds/xMaximum" )
+         {
+            data3D.cartesianBounds.xMaximum = numberValue( e );
+         }
+         else if ( path == "cartesianBounds/yMinimum" )
+         {
+            data3D.cartesianBounds.yMinimum = numberValue( e );
+         }
+         else if ( path == "cartesianBounds/yMaximum" )
+         {
+            data3D.cartesianBounds.yMaximum = numberValue( e );
+         }
+         else if ( path == "cartesianBounds/zMinimum" )
+         {
+            data3D.cartesianBounds.zMinimum = numberValue( e );
+         }
+         else if ( path == "cartesianBounds/zMaximum" )
+         {
+            data3D.cartesianBounds.zMaximum = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/rangeMinimum" )
+         {
+            data3D.sphericalBounds.rangeMinimum = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/rangeMaximum" )
+         {
+            data3D.sphericalBounds.rangeMaximum = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/elevationMinimum" )
+         {
+            data3D.sphericalBounds.elevationMinimum = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/elevationMaximum" )
+         {
+            data3D.sphericalBounds.elevationMaximum = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/azimuthStart" )
+         {
+            data3D.sphericalBounds.azimuthStart = numberValue( e );
+         }
+         else if ( path == "sphericalBounds/azimuthEnd" )
+         {
+            data3D.sphericalBounds.azimuthEnd = numberValue( e );
+         }
+      }
+
+      /// Fields every representation has
+      template <typename REPRESENTATION>
+      bool setImageValue( REPRESENTATION &representation, const ustring &field, const Element &e )
+      {
+         if ( field == "jpegImage" )
+         {
+            representation.jpegImageSize = e.count;
+         }
+         else if ( field == "pngImage" )
+         {
+            representation.pngImageSize = e.count;
+         }
+         else if ( field == "imageMask" )
+         {
+            representation.imageMaskSize = e.count;
+         }
+         else if ( field == "imageWidth" )
+         {
+            representation.imageWidth = static_cast<int32_t>( integerValue( e ) );
+         }
+         else if ( field == "imageHeight" )
+         {
+            representation.imageHeight = static_cast<int32_t>( integerValue( e ) );
+         }
+         else
+         {
+            return false;
+         }
+
+         return true;
+      }
+
+      void setImage2DValue( Image2DProbe &image, const ustring &path, const Element &e )
+      {
+         if ( path == "name" )
+         {
+            image.name = e.text;
+            return;
+         }
+         if ( path == "guid" )
+         {
+            image.guid = e.text;
+            return;
+         }
+         if ( path == "associatedData3DGuid" )
+         {
+            image.associatedData3DGuid = e.text;
+            return;
+         }
+         if ( setPose( image.pose, path, e ) )
+         {
+            return;
+         }
+
+         const size_t slash = path.find( '/' );
+
+         if ( slash == ustring::npos )
+         {
+            return;
+         }
+
+         const ustring representation = path.substr( 0, slash );
+         const ustring field = path.substr( slash + 1 );
+
+         if ( representation == "visualReferenceRepresentation" )
+         {
+            setImageValue( image.visualReferenceRepresentation, field, e );
+         }
+         else if ( representation == "pinholeRepresentation" )
+         {
+            PinholeRepresentation &pinhole = image.pinholeRepresentation;
+
+            if ( setImageValue( pinhole, field, e ) )
+            {
+            }
+            else if ( field == "focalLength" )
+            {
+               pinhole.focalLength = numberValue( e );
+            }
+            else if ( field == "pixelWidth" )
+            {
+               pinhole.pixelWidth = numberValue( e );
+            }
+            else if ( field == "pixelHeight" )
+            {
+               pinhole.pixelHeight = numberValue( e );
+            }
+            else if ( field == "principalPointX" )
+            {
+               pinhole.principalPointX = numberValue( e );
+            }
+            else if ( field == "principalPointY" )
+            {
+               pinhole.principalPointY = numberValue( e );
+            }
+         }
+         else if ( representation == "sphericalRepresentation" )
+         {
+            SphericalRepresentation &spherical = image.sphericalRepresentation;
+
+            if ( setImageValue( spherical, field, e ) )
+            {
+            }
+            else if ( field == "pixelWidth" )
+            {
+               spherical.pixelWidth = numberValue( e );
+            }
+            else if ( field == "pixelHeight" )
+            {
+               spherical.pixelHeight = numberValue( e );
+            }
+         }
+         else if ( representation == "cylindricalRepresentation" )
+         {
+            CylindricalRepresentation &cylindrical = image.cylindricalRepresentation;
+
+            if ( setImageValue( cylindrical, field, e ) )
+            {
+            }
+            else if ( field == "pixelWidth" )
+            {
+               cylindrical.pixelWidth = numberValue( e );
+            }
+            else if ( field == "pixelHeight" )
+            {
+               cylindrical.pixelHeight = numberValue( e );
+            }
+            else if ( field == "radius" )
+            {
+               cylindrical.radius = numberValue( e );
+            }
+            else if ( field == "principalPointY" )
+            {
+               cylindrical.principalPointY = numberValue( e );
+            }
+         }
+      }
+
+      /// Runs through the XML section, keeping only the path to the current element
+      void probeXml( const char *data, size_t size, FileProbe &probe )
+      {
+         XmlPullParser parser( data, size );
+         ElementPath path; /// path[0] is e57Root, path[1] data3D or images2D, path[2] one of their children
+
+         auto inData3D = [&path]() { return ( path.size() > 2 ) && ( path[1].name == "data3D" ); };
+         auto inImages2D = [&path]() { return ( path.size() > 2 ) && ( path[1].name == "images2D" ); };
+
+         bool done = false;
+
+         while ( !done )
+         {
+            switch ( parser.next() )
+            {
+               case XmlPullParser::StartElement:
+               {
+                  path.push_back( startElement( parser ) );
+
+                  if ( path.size() == 3 )
+                  {
+                     if ( inData3D() )
+                     {
+                        probe.data3D.emplace_back();
+                     }
+                     else if ( inImages2D() )
+                     {
+                        probe.images2D.emplace_back();
+                     }
+                  }
+                  else if ( inData3D() && ( path.size() >= 4 ) && ( path[3].name == "points" ) )
+                  {
+                     const Element &e = path.back();
+
+                     if ( path.size() == 4 )
+                     {
+                        probe.data3D.back().pointsSize = e.count;
+                     }
+                     else if ( path[4].name != "prototype" )
+                     {
+                        /// Only the prototype describes the fields, the codecs can be long
+                        parser.skipContent();
+                     }
+                     else if ( ( path.size() > 5 ) && isLeaf( e ) )
+                     {
+                        probe.data3D.back().fields.push_back( probeField( relativePath( path, 5 ), e ) );
+                     }
+                  }
+               }
+               break;
+
+               case XmlPullParser::EndElement:
+               {
+                  const Element &e = path.back();
+
+                  if ( isLeaf( e ) )
+                  {
+                     if ( inData3D() && ( path.size() > 3 ) )
+                     {
+                        setData3DValue( probe.data3D.back(), relativePath( path, 3 ), e );
+                     }
+                     else if ( inImages2D() && ( path.size() > 3 ) )
+                     {
+                        setImage2DValue( probe.images2D.back(), relativePath( path, 3 ), e );
+                     }
+                     else if ( ( path.size() > 1 ) && ( path[1].name != "data3D" ) &&
+                               ( path[1].name != "images2D" ) )
+                     {
+                        setRootValue( probe.root, relativePath( path, 1 ), e );
+                     }
+                  }
+
+                  path.pop_back();
+               }
+               break;
+
+               case XmlPullParser::Characters:
+                  if ( !path.empty() )
+                  {
+                     path.back().text += parser.text();
+                  }
+                  break;
+
+               case XmlPullParser::EndDocument:
+                  done = true;
+                  break;
+            }
+         }
+
+         probe.root.data3DSize = static_cast<int64_t>( probe.data3D.size() );
+         probe.root.images2DSize = static_cast<int64_t>( probe.images2D.size() );
+      }
+   }
+
+   FileProbe Probe( const ustring &filePath, ReadChecksumPolicy checksumPolicy )
+   {
+      E57_TRACE_SPAN( "probe" );
+
+      CheckedFile file( filePath, CheckedFile::ReadOnly, checksumPolicy );
+
+      uint64_t xmlLogicalStart = 0;
+      uint64_t xmlLogicalLength = 0;
+
+      ImageFileImpl::readXmlSectionRange( &file, xmlLogicalStart, xmlLogicalLength );
+
+      /// Reads only the pages of the XML section, so only their checksums are verified
+      std::vector<char> xml( static_cast<size_t>( xmlLogicalLength ) );
+
+      file.readAt( xmlLogicalStart, xml.data(), xml.size() );
+
+      FileProbe probe;
+
+      probeXml( xml.data(), xml.size(), probe );
+
+      return probe;
+   }
+} // end namespace e57
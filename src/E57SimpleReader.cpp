@@ -26,6 +26,7 @@
  */
 
 #include "E57SimpleReader.h"
+#include "Data3DPointsAsyncReaderImpl.h"
 #include "ReaderImpl.h"
 
 namespace e57
@@ -35,6 +36,11 @@ namespace e57
    {
    }
 
+   Reader::Reader( const ustring &filePath, const ExecutionContext &context ) :
+      impl_( new ReaderImpl( filePath, context ) )
+   {
+   }
+
    bool Reader::IsOpen() const
    {
       return impl_->IsOpen();
@@ -128,4 +134,108 @@ namespace e57
       return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
    }
 
+   bool Reader::ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                  Data3DPointsArrays &points ) const
+   {
+      return impl_->ReadData3DPoints( dataIndex, fields, points );
+   }
+
+   bool Reader::ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                  Data3DPointsArrays_d &points ) const
+   {
+      return impl_->ReadData3DPoints( dataIndex, fields, points );
+   }
+
+   bool Reader::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                    const Data3DPointsCallback &callback ) const
+   {
+      return impl_->ImportData3DPoints( options, callback );
+   }
+
+   bool Reader::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                    const Data3DPointsCallback_d &callback ) const
+   {
+      return impl_->ImportData3DPoints( options, callback );
+   }
+
+   bool Reader::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                    std::vector<Data3DPointsArrays> &scans ) const
+   {
+      return impl_->ImportData3DPoints( options, scans );
+   }
+
+   bool Reader::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                    std::vector<Data3DPointsArrays_d> &scans ) const
+   {
+      return impl_->ImportData3DPoints( options, scans );
+   }
+
+   CompressedVectorReader Reader::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                         const Data3DPointsData &buffers,
+                                                         const Data3DPointsFilter &filter ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers, filter );
+   }
+
+   CompressedVectorReader Reader::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                         const Data3DPointsData_d &buffers,
+                                                         const Data3DPointsFilter &filter ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers, filter );
+   }
+
+   CompressedVectorReader Reader::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                         const Data3DPointsLayout &layout ) const
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, layout );
+   }
+
+   bool Reader::SetUpData3DPointsPose( int64_t dataIndex, CompressedVectorReader &reader,
+                                       const RigidBodyTransform &extraTransform ) const
+   {
+      return impl_->SetUpData3DPointsPose( dataIndex, reader, extraTransform );
+   }
+
+   bool Reader::ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData &rasters,
+                                        const Data3DPointsRasterWindow &window ) const
+   {
+      return impl_->ReadData3DPointsRaster( dataIndex, rasters, window );
+   }
+
+   bool Reader::ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_d &rasters,
+                                        const Data3DPointsRasterWindow &window ) const
+   {
+      return impl_->ReadData3DPointsRaster( dataIndex, rasters, window );
+   }
+
+   template <typename COORDTYPE>
+   Data3DPointsAsyncReader_t<COORDTYPE>::Data3DPointsAsyncReader_t( const Reader &reader, int64_t dataIndex,
+                                                                    size_t pointCount,
+                                                                    const PointStandardizedFieldsAvailable &fields,
+                                                                    size_t bufferCount ) :
+      impl_( new Data3DPointsAsyncReaderImpl<COORDTYPE>( reader.impl_, dataIndex, pointCount, fields, bufferCount ) )
+   {
+   }
+
+   template <typename COORDTYPE>
+   CompressedVectorReader Data3DPointsAsyncReader_t<COORDTYPE>::compressedVectorReader() const
+   {
+      return impl_->compressedVectorReader();
+   }
+
+   template <typename COORDTYPE>
+   size_t Data3DPointsAsyncReader_t<COORDTYPE>::acquire( Data3DPointsData_t<COORDTYPE> &buffers )
+   {
+      return impl_->acquire( buffers );
+   }
+
+   template <typename COORDTYPE> void Data3DPointsAsyncReader_t<COORDTYPE>::release()
+   {
+      impl_->release();
+   }
+
+   // Explicit template instantiation
+   template class Data3DPointsAsyncReader_t<float>;
+   template class Data3DPointsAsyncReader_t<double>;
+
 } // end namespace e57
@@ -36,6 +36,23 @@ namespace e57
    {
    }
 
+   Writer::Writer( const ustring &filePath, const ustring &coordinateMetaData, const ExecutionContext &context ) :
+      impl_( new WriterImpl( filePath, coordinateMetaData ) )
+   {
+      impl_->GetRawIMF().setExecutionContext( context );
+   }
+
+   Writer::Writer( std::vector<char> &output, const ustring &coordinateMetaData ) :
+      impl_( new WriterImpl( output, coordinateMetaData ) )
+   {
+   }
+
+   Writer::Writer( std::vector<char> &output, const ustring &coordinateMetaData, const ExecutionContext &context ) :
+      impl_( new WriterImpl( output, coordinateMetaData ) )
+   {
+      impl_->GetRawIMF().setExecutionContext( context );
+   }
+
    bool Writer::IsOpen() const
    {
       return impl_->IsOpen();
@@ -94,6 +111,12 @@ namespace e57
       return impl_->SetUpData3DPointsData( dataIndex, pointCount, buffers );
    }
 
+   CompressedVectorWriter Writer::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                         const Data3DPointsLayout &layout )
+   {
+      return impl_->SetUpData3DPointsData( dataIndex, pointCount, layout );
+   }
+
    bool Writer::WriteData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
                                        int64_t *startPointIndex, int64_t *pointCount )
    {
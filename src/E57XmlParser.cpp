@@ -40,37 +40,16 @@
 #include "FloatNodeImpl.h"
 #include "ImageFileImpl.h"
 #include "IntegerNodeImpl.h"
+#include "NodeArena.h"
 #include "ScaledIntegerNodeImpl.h"
 #include "StringNodeImpl.h"
+#include "StructureNodeImpl.h"
 #include "VectorNodeImpl.h"
+#include "XmlPullParser.h"
 
 using namespace e57;
 using namespace XERCES_CPP_NAMESPACE;
 
-// define convenient constants for the attribute names
-static const XMLCh att_minimum[] = {
-   chLatin_m, chLatin_i, chLatin_n, chLatin_i, chLatin_m, chLatin_u, chLatin_m, chNull
-};
-static const XMLCh att_maximum[] = {
-   chLatin_m, chLatin_a, chLatin_x, chLatin_i, chLatin_m, chLatin_u, chLatin_m, chNull
-};
-static const XMLCh att_scale[] = { chLatin_s, chLatin_c, chLatin_a, chLatin_l, chLatin_e, chNull };
-static const XMLCh att_offset[] = { chLatin_o, chLatin_f, chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull };
-static const XMLCh att_precision[] = { chLatin_p, chLatin_r, chLatin_e, chLatin_c, chLatin_i,
-                                       chLatin_s, chLatin_i, chLatin_o, chLatin_n, chNull };
-static const XMLCh att_allowHeterogeneousChildren[] = {
-   chLatin_a, chLatin_l, chLatin_l, chLatin_o, chLatin_w, chLatin_H, chLatin_e, chLatin_t, chLatin_e,
-   chLatin_r, chLatin_o, chLatin_g, chLatin_e, chLatin_n, chLatin_e, chLatin_o, chLatin_u, chLatin_s,
-   chLatin_C, chLatin_h, chLatin_i, chLatin_l, chLatin_d, chLatin_r, chLatin_e, chLatin_n, chNull
-};
-static const XMLCh att_fileOffset[] = { chLatin_f, chLatin_i, chLatin_l, chLatin_e, chLatin_O, chLatin_f,
-                                        chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull };
-
-static const XMLCh att_type[] = { chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull };
-static const XMLCh att_length[] = { chLatin_l, chLatin_e, chLatin_n, chLatin_g, chLatin_t, chLatin_h, chNull };
-static const XMLCh att_recordCount[] = { chLatin_r, chLatin_e, chLatin_c, chLatin_o, chLatin_r, chLatin_d,
-                                         chLatin_C, chLatin_o, chLatin_u, chLatin_n, chLatin_t, chNull };
-
 inline int64_t convertStrToLL( const std::string &inStr )
 {
 #if defined( _MSC_VER )
@@ -189,7 +168,7 @@ BinInputStream *E57XmlFileInputSource::makeStream() const
 E57XmlParser::ParseInfo::ParseInfo() :
    nodeType( static_cast<NodeType>( 0 ) ), minimum( 0 ), maximum( 0 ), scale( 0 ), offset( 0 ),
    precision( static_cast<FloatPrecision>( 0 ) ), floatMinimum( 0 ), floatMaximum( 0 ), fileOffset( 0 ), length( 0 ),
-   allowHeterogeneousChildren( false ), recordCount( 0 )
+   allowHeterogeneousChildren( false ), recordCount( 0 ), deferChildren( false )
 {
 }
 
@@ -207,6 +186,7 @@ void E57XmlParser::ParseInfo::dump( int indent, std::ostream &os ) const
    os << space( indent ) << "length:         " << length << std::endl;
    os << space( indent ) << "allowHeterogeneousChildren: " << allowHeterogeneousChildren << std::endl;
    os << space( indent ) << "recordCount:    " << recordCount << std::endl;
+   os << space( indent ) << "deferChildren:  " << deferChildren << std::endl;
    if ( container_ni )
    {
       os << space( indent ) << "container_ni:   <defined>" << std::endl;
@@ -219,79 +199,275 @@ void E57XmlParser::ParseInfo::dump( int indent, std::ostream &os ) const
 }
 
 //=============================================================================
-// E57XmlParser
+// XmlParserContext
 
-E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf ) : imf_( imf ), xmlReader( nullptr )
+namespace
 {
+   /// Buffers grown larger than this by a file aren't kept for the next one
+   constexpr size_t MAX_RETAINED_XML_BUFFER = 16 * 1024 * 1024;
 }
 
-E57XmlParser::~E57XmlParser()
+XmlParserContext &XmlParserContext::threadContext()
 {
-   delete xmlReader;
+   thread_local XmlParserContext context;
 
-   xmlReader = nullptr;
+   return context;
+}
 
-   XMLPlatformUtils::Terminate();
+XmlParserContext::XmlParserContext() : xercesReader_( nullptr ), pullParser_( nullptr, 0 )
+{
 }
 
-void E57XmlParser::init()
+XmlParserContext::~XmlParserContext()
 {
-   // Initialize the XML4C2 system
-   try
-   {
-      XMLPlatformUtils::Initialize();
-   }
-   catch ( const XMLException &ex )
+   delete xercesReader_;
+
+   xercesReader_ = nullptr;
+}
+
+SAX2XMLReader *XmlParserContext::xercesReader()
+{
+   if ( xercesReader_ != nullptr )
    {
-      /// Turn parser exception into E57Exception
-      throw E57_EXCEPTION2( E57_ERROR_XML_PARSER_INIT,
-                            "parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
+      return xercesReader_;
    }
 
-   xmlReader = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
+   initializeXerces();
 
-   if ( xmlReader == nullptr )
+   xercesReader_ = XMLReaderFactory::createXMLReader(); //??? auto_ptr?
+
+   if ( xercesReader_ == nullptr )
    {
       throw E57_EXCEPTION2( E57_ERROR_XML_PARSER_INIT, "could not create the xml reader" );
    }
 
    //??? check these are right
-   xmlReader->setFeature( XMLUni::fgSAX2CoreValidation, true );
-   xmlReader->setFeature( XMLUni::fgXercesDynamic, true );
-   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpaces, true );
-   xmlReader->setFeature( XMLUni::fgXercesSchema, true );
-   xmlReader->setFeature( XMLUni::fgXercesSchemaFullChecking, true );
-   xmlReader->setFeature( XMLUni::fgSAX2CoreNameSpacePrefixes, true );
+   xercesReader_->setFeature( XMLUni::fgSAX2CoreValidation, true );
+   xercesReader_->setFeature( XMLUni::fgXercesDynamic, true );
+   xercesReader_->setFeature( XMLUni::fgSAX2CoreNameSpaces, true );
+   xercesReader_->setFeature( XMLUni::fgXercesSchema, true );
+   xercesReader_->setFeature( XMLUni::fgXercesSchemaFullChecking, true );
+   xercesReader_->setFeature( XMLUni::fgSAX2CoreNameSpacePrefixes, true );
+
+   return xercesReader_;
+}
+
+void XmlParserContext::trimBuffer()
+{
+   if ( xml_.capacity() > MAX_RETAINED_XML_BUFFER )
+   {
+      std::vector<char>().swap( xml_ );
+   }
+}
 
+void XmlParserContext::initializeXerces()
+{
+   /// Xerces-C stays initialized until the process exits. Terminating it from a context's destructor would run at
+   /// thread exit, which isn't ordered against the other threads or static destruction. If Initialize() throws, the
+   /// next call tries again.
+   static const bool initialized = [] {
+      try
+      {
+         XMLPlatformUtils::Initialize();
+      }
+      catch ( const XMLException &ex )
+      {
+         /// Turn parser exception into E57Exception
+         throw E57_EXCEPTION2( E57_ERROR_XML_PARSER_INIT,
+                               "parserMessage=" + ustring( XMLString::transcode( ex.getMessage() ) ) );
+      }
+
+      return true;
+   }();
+
+   (void)initialized;
+}
+
+//=============================================================================
+// E57XmlParser
+
+E57XmlParser::E57XmlParser( ImageFileImplSharedPtr imf ) :
+   imf_( imf ), context_( XmlParserContext::threadContext() ), lazy_( false )
+{
+}
+
+void E57XmlParser::parseXerces( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength )
+{
+   SAX2XMLReader *xmlReader = context_.xercesReader();
+
+   /// Create input source (XML section of E57 file turned into a stream).
+   E57XmlFileInputSource xmlSection( cf, logicalStart, logicalLength );
+
+   /// The reader is shared by the files opened on this thread, so it only refers to this parser while parsing
    xmlReader->setContentHandler( this );
    xmlReader->setErrorHandler( this );
+
+   try
+   {
+      xmlReader->parse( xmlSection );
+   }
+   catch ( ... )
+   {
+      /// Don't reuse a reader left in the middle of a document
+      delete context_.xercesReader_;
+      context_.xercesReader_ = nullptr;
+
+      throw;
+   }
+
+   xmlReader->setContentHandler( nullptr );
+   xmlReader->setErrorHandler( nullptr );
 }
 
-void E57XmlParser::parse( InputSource &inputSource )
+void E57XmlParser::parseBuiltin( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength, bool lazy )
 {
-   xmlReader->parse( inputSource );
+   if ( logicalLength > std::numeric_limits<size_t>::max() )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_FILE_LENGTH,
+                            "fileName=" + imf_->fileName() + " xmlLogicalLength=" + toString( logicalLength ) );
+   }
+
+   /// Read the XML section in one piece, the parser works on it in memory
+   std::vector<char> &xml = context_.xml_;
+
+   xml.resize( static_cast<size_t>( logicalLength ) );
+   cf->readAt( logicalStart, xml.data(), xml.size() );
+
+   XmlPullParser &parser = context_.pullParser_;
+
+   parser.reset( xml.data(), xml.size() );
+   lazy_ = lazy;
+
+   try
+   {
+      parseEvents( parser, logicalStart );
+   }
+   catch ( ... )
+   {
+      context_.trimBuffer();
+      throw;
+   }
+
+   context_.trimBuffer();
+}
+
+void E57XmlParser::parseDeferred( const std::shared_ptr<StructureNodeImpl> &node, CheckedFile *cf,
+                                  uint64_t logicalStart, uint64_t logicalLength )
+{
+   /// Ranges are small, and may be loaded while the thread's buffer is in use, so they get their own
+   std::vector<char> xml( static_cast<size_t>( logicalLength ) );
+
+   cf->readAt( logicalStart, xml.data(), xml.size() );
+
+   XmlPullParser parser( xml.data(), xml.size(), true );
+
+   /// The structure is open, so the elements in the range become its children
+   ParseInfo pi;
+   pi.nodeType = E57_STRUCTURE;
+   pi.container_ni = node;
+   stack_.push( pi );
+
+   parseEvents( parser, logicalStart );
+}
+
+void E57XmlParser::parseEvents( XmlPullParser &parser, uint64_t logicalStart )
+{
+   bool done = false;
+
+   while ( !done )
+   {
+      switch ( parser.next() )
+      {
+         case XmlPullParser::StartElement:
+         {
+            const bool deferred = !stack_.empty() && stack_.top().deferChildren;
+
+            handleStartElement( ustring(), parser.localName(), parser.qName(), parser.attributes() );
+
+            /// Only note where the children of a deferred structure are, they are parsed on first access
+            if ( deferred && ( stack_.top().nodeType == E57_STRUCTURE ) )
+            {
+               const size_t contentStart = parser.offset();
+
+               parser.skipContent();
+
+               if ( parser.offset() > contentStart )
+               {
+                  std::static_pointer_cast<StructureNodeImpl>( stack_.top().container_ni )
+                     ->setDeferredChildren( logicalStart + contentStart, parser.offset() - contentStart );
+               }
+            }
+         }
+         break;
+         case XmlPullParser::EndElement:
+            handleEndElement( ustring(), parser.localName(), parser.qName() );
+            break;
+         case XmlPullParser::Characters:
+            handleCharacters( parser.text() );
+            break;
+         case XmlPullParser::EndDocument:
+            done = true;
+            break;
+      }
+   }
 }
 
 void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const localName, const XMLCh *const qName,
                                  const Attributes &attributes )
+{
+   /// Attributes are copied into a list reused for every element, so its strings keep their capacity
+   XmlAttributeList &list = context_.attributes_;
+   const XMLSize_t count = attributes.getLength();
+
+   list.resize( count );
+
+   for ( XMLSize_t i = 0; i < count; i++ )
+   {
+      list[i].uri = toUString( attributes.getURI( i ) );
+      list[i].localName = toUString( attributes.getLocalName( i ) );
+      list[i].qName = toUString( attributes.getQName( i ) );
+      list[i].value = toUString( attributes.getValue( i ) );
+   }
+
+   handleStartElement( toUString( uri ), toUString( localName ), toUString( qName ), list );
+}
+
+void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localName, const XMLCh *const qName )
+{
+   handleEndElement( toUString( uri ), toUString( localName ), toUString( qName ) );
+}
+
+void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length )
+{
+   //??? use length to make ustring
+   handleCharacters( toUString( chars ) );
+}
+
+template <typename T, typename... Args> std::shared_ptr<T> E57XmlParser::makeNode( Args &&... args )
+{
+   return std::allocate_shared<T>( NodeAllocator<T>( imf_->nodeArena() ), imf_, std::forward<Args>( args )... );
+}
+
+void E57XmlParser::handleStartElement( const ustring &uri, const ustring &localName, const ustring &qName,
+                                       const XmlAttributeList &attributes )
 {
 #ifdef E57_MAX_VERBOSE
    std::cout << "startElement" << std::endl;
-   std::cout << space( 2 ) << "URI:       " << toUString( uri ) << std::endl;
-   std::cout << space( 2 ) << "localName: " << toUString( localName ) << std::endl;
-   std::cout << space( 2 ) << "qName:     " << toUString( qName ) << std::endl;
+   std::cout << space( 2 ) << "URI:       " << uri << std::endl;
+   std::cout << space( 2 ) << "localName: " << localName << std::endl;
+   std::cout << space( 2 ) << "qName:     " << qName << std::endl;
 
-   for ( size_t i = 0; i < attributes.getLength(); i++ )
+   for ( size_t i = 0; i < attributes.size(); i++ )
    {
       std::cout << space( 2 ) << "Attribute[" << i << "]" << std::endl;
-      std::cout << space( 4 ) << "URI:       " << toUString( attributes.getURI( i ) ) << std::endl;
-      std::cout << space( 4 ) << "localName: " << toUString( attributes.getLocalName( i ) ) << std::endl;
-      std::cout << space( 4 ) << "qName:     " << toUString( attributes.getQName( i ) ) << std::endl;
-      std::cout << space( 4 ) << "value:     " << toUString( attributes.getValue( i ) ) << std::endl;
+      std::cout << space( 4 ) << "URI:       " << attributes[i].uri << std::endl;
+      std::cout << space( 4 ) << "localName: " << attributes[i].localName << std::endl;
+      std::cout << space( 4 ) << "qName:     " << attributes[i].qName << std::endl;
+      std::cout << space( 4 ) << "value:     " << attributes[i].value << std::endl;
    }
 #endif
    /// Get Type attribute
-   ustring node_type = lookupAttribute( attributes, att_type );
+   ustring node_type = lookupAttribute( attributes, "type" );
 
    //??? check to make sure not in primitive type (can only nest inside compound
    // types).
@@ -306,9 +482,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       //??? check validity of numeric strings
       pi.nodeType = E57_INTEGER;
 
-      if ( isAttributeDefined( attributes, att_minimum ) )
+      if ( isAttributeDefined( attributes, "minimum" ) )
       {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
+         ustring minimum_str = lookupAttribute( attributes, "minimum" );
 
          pi.minimum = convertStrToLL( minimum_str );
       }
@@ -318,9 +494,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          pi.minimum = E57_INT64_MIN;
       }
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
+      if ( isAttributeDefined( attributes, "maximum" ) )
       {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
+         ustring maximum_str = lookupAttribute( attributes, "maximum" );
 
          pi.maximum = convertStrToLL( maximum_str );
       }
@@ -341,9 +517,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       pi.nodeType = E57_SCALED_INTEGER;
 
       //??? check validity of numeric strings
-      if ( isAttributeDefined( attributes, att_minimum ) )
+      if ( isAttributeDefined( attributes, "minimum" ) )
       {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
+         ustring minimum_str = lookupAttribute( attributes, "minimum" );
 
          pi.minimum = convertStrToLL( minimum_str );
       }
@@ -353,9 +529,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          pi.minimum = E57_INT64_MIN;
       }
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
+      if ( isAttributeDefined( attributes, "maximum" ) )
       {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
+         ustring maximum_str = lookupAttribute( attributes, "maximum" );
 
          pi.maximum = convertStrToLL( maximum_str );
       }
@@ -365,9 +541,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          pi.maximum = E57_INT64_MAX;
       }
 
-      if ( isAttributeDefined( attributes, att_scale ) )
+      if ( isAttributeDefined( attributes, "scale" ) )
       {
-         ustring scale_str = lookupAttribute( attributes, att_scale );
+         ustring scale_str = lookupAttribute( attributes, "scale" );
          pi.scale = atof( scale_str.c_str() ); //??? use exact rounding library
       }
       else
@@ -376,9 +552,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          pi.scale = 1.0;
       }
 
-      if ( isAttributeDefined( attributes, att_offset ) )
+      if ( isAttributeDefined( attributes, "offset" ) )
       {
-         ustring offset_str = lookupAttribute( attributes, att_offset );
+         ustring offset_str = lookupAttribute( attributes, "offset" );
          pi.offset = atof( offset_str.c_str() ); //??? use exact rounding library
       }
       else
@@ -397,9 +573,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
 #endif
       pi.nodeType = E57_FLOAT;
 
-      if ( isAttributeDefined( attributes, att_precision ) )
+      if ( isAttributeDefined( attributes, "precision" ) )
       {
-         ustring precision_str = lookupAttribute( attributes, att_precision );
+         ustring precision_str = lookupAttribute( attributes, "precision" );
          if ( precision_str == "single" )
          {
             pi.precision = E57_SINGLE;
@@ -412,8 +588,8 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          {
             throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                   "precisionString=" + precision_str + " fileName=" + imf_->fileName() +
-                                     " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                     " qName=" + toUString( qName ) );
+                                     " uri=" + uri + " localName=" + localName +
+                                     " qName=" + qName );
          }
       }
       else
@@ -422,9 +598,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          pi.precision = E57_DOUBLE;
       }
 
-      if ( isAttributeDefined( attributes, att_minimum ) )
+      if ( isAttributeDefined( attributes, "minimum" ) )
       {
-         ustring minimum_str = lookupAttribute( attributes, att_minimum );
+         ustring minimum_str = lookupAttribute( attributes, "minimum" );
          pi.floatMinimum = atof( minimum_str.c_str() ); //??? use exact rounding library
       }
       else
@@ -441,9 +617,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          }
       }
 
-      if ( isAttributeDefined( attributes, att_maximum ) )
+      if ( isAttributeDefined( attributes, "maximum" ) )
       {
-         ustring maximum_str = lookupAttribute( attributes, att_maximum );
+         ustring maximum_str = lookupAttribute( attributes, "maximum" );
          pi.floatMaximum = atof( maximum_str.c_str() ); //??? use exact rounding library
       }
       else
@@ -482,12 +658,12 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       //??? check validity of numeric strings
 
       /// fileOffset is required to be defined
-      ustring fileOffset_str = lookupAttribute( attributes, att_fileOffset );
+      ustring fileOffset_str = lookupAttribute( attributes, "fileOffset" );
 
       pi.fileOffset = convertStrToLL( fileOffset_str );
 
       /// length is required to be defined
-      ustring length_str = lookupAttribute( attributes, att_length );
+      ustring length_str = lookupAttribute( attributes, "length" );
 
       pi.length = convertStrToLL( length_str );
 
@@ -502,31 +678,31 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       pi.nodeType = E57_STRUCTURE;
 
       /// Read name space decls, if e57Root element
-      if ( toUString( localName ) == "e57Root" )
+      if ( localName == "e57Root" )
       {
          /// Search attributes for namespace declarations (only allowed in
          /// E57Root structure)
          bool gotDefault = false;
-         for ( size_t i = 0; i < attributes.getLength(); i++ )
+         for ( const XmlAttribute &attribute : attributes )
          {
             /// Check if declaring the default namespace
-            if ( toUString( attributes.getQName( i ) ) == "xmlns" )
+            if ( attribute.qName == "xmlns" )
             {
 #ifdef E57_VERBOSE
-               std::cout << "declared default namespace, URI=" << toUString( attributes.getValue( i ) ) << std::endl;
+               std::cout << "declared default namespace, URI=" << attribute.value << std::endl;
 #endif
-               imf_->extensionsAdd( "", toUString( attributes.getValue( i ) ) );
+               imf_->extensionsAdd( "", attribute.value );
                gotDefault = true;
             }
 
             /// Check if declaring a namespace
-            if ( toUString( attributes.getURI( i ) ) == "http://www.w3.org/2000/xmlns/" )
+            if ( attribute.uri == "http://www.w3.org/2000/xmlns/" )
             {
 #ifdef E57_VERBOSE
-               std::cout << "declared extension, prefix=" << toUString( attributes.getLocalName( i ) )
-                         << " URI=" << toUString( attributes.getValue( i ) ) << std::endl;
+               std::cout << "declared extension, prefix=" << attribute.localName << " URI=" << attribute.value
+                         << std::endl;
 #endif
-               imf_->extensionsAdd( toUString( attributes.getLocalName( i ) ), toUString( attributes.getValue( i ) ) );
+               imf_->extensionsAdd( attribute.localName, attribute.value );
             }
          }
 
@@ -534,18 +710,18 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          if ( !gotDefault )
          {
             throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
-                                  "fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+                                  "fileName=" + imf_->fileName() + " uri=" + uri +
+                                     " localName=" + localName + " qName=" + qName );
          }
       }
 
       /// Create container now, so can hold children
-      std::shared_ptr<StructureNodeImpl> s_ni( new StructureNodeImpl( imf_ ) );
+      std::shared_ptr<StructureNodeImpl> s_ni( makeNode<StructureNodeImpl>() );
       pi.container_ni = s_ni;
 
       /// After have Structure, check again if E57Root, if so mark attached so
       /// all children will be attached when added
-      if ( toUString( localName ) == "e57Root" )
+      if ( localName == "e57Root" )
       {
          s_ni->setAttachedRecursive();
       }
@@ -560,9 +736,9 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
 #endif
       pi.nodeType = E57_VECTOR;
 
-      if ( isAttributeDefined( attributes, att_allowHeterogeneousChildren ) )
+      if ( isAttributeDefined( attributes, "allowHeterogeneousChildren" ) )
       {
-         ustring allowHetero_str = lookupAttribute( attributes, att_allowHeterogeneousChildren );
+         ustring allowHetero_str = lookupAttribute( attributes, "allowHeterogeneousChildren" );
 
          int64_t i64 = convertStrToLL( allowHetero_str );
 
@@ -578,8 +754,8 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
          {
             throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                   "allowHeterogeneousChildren=" + toString( i64 ) + "fileName=" + imf_->fileName() +
-                                     " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                     " qName=" + toUString( qName ) );
+                                     " uri=" + uri + " localName=" + localName +
+                                     " qName=" + qName );
          }
       }
       else
@@ -589,9 +765,12 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       }
 
       /// Create container now, so can hold children
-      std::shared_ptr<VectorNodeImpl> v_ni( new VectorNodeImpl( imf_, pi.allowHeterogeneousChildren ) );
+      std::shared_ptr<VectorNodeImpl> v_ni( makeNode<VectorNodeImpl>( pi.allowHeterogeneousChildren ) );
       pi.container_ni = v_ni;
 
+      /// When opened lazily, the scans and images in /data3D and /images2D are parsed on first access
+      pi.deferChildren = lazy_ && ( stack_.size() == 1 ) && ( ( qName == "data3D" ) || ( qName == "images2D" ) );
+
       /// Push info so far onto stack
       stack_.push( pi );
    }
@@ -603,17 +782,17 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
       pi.nodeType = E57_COMPRESSED_VECTOR;
 
       /// fileOffset is required to be defined
-      ustring fileOffset_str = lookupAttribute( attributes, att_fileOffset );
+      ustring fileOffset_str = lookupAttribute( attributes, "fileOffset" );
 
       pi.fileOffset = convertStrToLL( fileOffset_str );
 
       /// recordCount is required to be defined
-      ustring recordCount_str = lookupAttribute( attributes, att_recordCount );
+      ustring recordCount_str = lookupAttribute( attributes, "recordCount" );
 
       pi.recordCount = convertStrToLL( recordCount_str );
 
       /// Create container now, so can hold children
-      std::shared_ptr<CompressedVectorNodeImpl> cv_ni( new CompressedVectorNodeImpl( imf_ ) );
+      std::shared_ptr<CompressedVectorNodeImpl> cv_ni( makeNode<CompressedVectorNodeImpl>() );
       cv_ni->setRecordCount( pi.recordCount );
       cv_ni->setBinarySectionLogicalStart(
          imf_->file_->physicalToLogical( pi.fileOffset ) ); //??? what if file_ is NULL?
@@ -625,15 +804,15 @@ void E57XmlParser::startElement( const XMLCh *const uri, const XMLCh *const loca
    else
    {
       throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
-                            "nodeType=" + node_type + " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                               " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+                            "nodeType=" + node_type + " fileName=" + imf_->fileName() + " uri=" + uri +
+                               " localName=" + localName + " qName=" + qName );
    }
 #ifdef E57_MAX_VERBOSE
    pi.dump( 4 );
 #endif
 }
 
-void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localName, const XMLCh *const qName )
+void E57XmlParser::handleEndElement( const ustring &uri, const ustring &localName, const ustring &qName )
 {
 #ifdef E57_MAX_VERBOSE
    std::cout << "endElement" << std::endl;
@@ -674,7 +853,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          {
             intValue = 0;
          }
-         std::shared_ptr<IntegerNodeImpl> i_ni( new IntegerNodeImpl( imf_, intValue, pi.minimum, pi.maximum ) );
+         std::shared_ptr<IntegerNodeImpl> i_ni( makeNode<IntegerNodeImpl>( intValue, pi.minimum, pi.maximum ) );
          current_ni = i_ni;
       }
       break;
@@ -691,7 +870,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
             intValue = 0;
          }
          std::shared_ptr<ScaledIntegerNodeImpl> si_ni(
-            new ScaledIntegerNodeImpl( imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset ) );
+            makeNode<ScaledIntegerNodeImpl>( intValue, pi.minimum, pi.maximum, pi.scale, pi.offset ) );
          current_ni = si_ni;
       }
       break;
@@ -708,27 +887,27 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
             floatValue = 0.0;
          }
          std::shared_ptr<FloatNodeImpl> f_ni(
-            new FloatNodeImpl( imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum ) );
+            makeNode<FloatNodeImpl>( floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum ) );
          current_ni = f_ni;
       }
       break;
       case E57_STRING:
       {
-         std::shared_ptr<StringNodeImpl> s_ni( new StringNodeImpl( imf_, pi.childText ) );
+         std::shared_ptr<StringNodeImpl> s_ni( makeNode<StringNodeImpl>( pi.childText ) );
          current_ni = s_ni;
       }
       break;
       case E57_BLOB:
       {
-         std::shared_ptr<BlobNodeImpl> b_ni( new BlobNodeImpl( imf_, pi.fileOffset, pi.length ) );
+         std::shared_ptr<BlobNodeImpl> b_ni( makeNode<BlobNodeImpl>( pi.fileOffset, pi.length ) );
          current_ni = b_ni;
       }
       break;
       default:
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "nodeType=" + toString( pi.nodeType ) +
-                                                      " fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                                      " localName=" + toUString( localName ) +
-                                                      " qName=" + toUString( qName ) );
+                                                      " fileName=" + imf_->fileName() + " uri=" + uri +
+                                                      " localName=" + localName +
+                                                      " qName=" + qName );
    }
 #ifdef E57_MAX_VERBOSE
    current_ni->dump( 4 );
@@ -742,8 +921,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
       {
          throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                "currentType=" + toString( current_ni->type() ) + " fileName=" + imf_->fileName() +
-                                  " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                  " qName=" + toUString( qName ) );
+                                  " uri=" + uri + " localName=" + localName +
+                                  " qName=" + qName );
       }
       imf_->root_ = std::static_pointer_cast<StructureNodeImpl>( current_ni );
       return;
@@ -755,9 +934,9 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
 
    if ( !parent_ni )
    {
-      throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                                         " localName=" + toUString( localName ) +
-                                                         " qName=" + toUString( qName ) );
+      throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "fileName=" + imf_->fileName() + " uri=" + uri +
+                                                         " localName=" + localName +
+                                                         " qName=" + qName );
    }
 
    /// Add current node into parent at top of stack
@@ -768,7 +947,7 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          std::shared_ptr<StructureNodeImpl> struct_ni = std::static_pointer_cast<StructureNodeImpl>( parent_ni );
 
          /// Add named child to structure
-         struct_ni->set( toUString( qName ), current_ni );
+         struct_ni->set( qName, current_ni );
       }
       break;
       case E57_VECTOR:
@@ -783,21 +962,19 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
       {
          std::shared_ptr<CompressedVectorNodeImpl> cv_ni =
             std::static_pointer_cast<CompressedVectorNodeImpl>( parent_ni );
-         ustring uQName = toUString( qName );
-
          /// n can be either prototype or codecs
-         if ( uQName == "prototype" )
+         if ( qName == "prototype" )
          {
             cv_ni->setPrototype( current_ni );
          }
-         else if ( uQName == "codecs" )
+         else if ( qName == "codecs" )
          {
             if ( current_ni->type() != E57_VECTOR )
             {
                throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                      "currentType=" + toString( current_ni->type() ) + " fileName=" + imf_->fileName() +
-                                        " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                        " qName=" + toUString( qName ) );
+                                        " uri=" + uri + " localName=" + localName +
+                                        " qName=" + qName );
             }
             std::shared_ptr<VectorNodeImpl> vi = std::static_pointer_cast<VectorNodeImpl>( current_ni );
 
@@ -806,8 +983,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
             {
                throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                      "currentType=" + toString( current_ni->type() ) + " fileName=" + imf_->fileName() +
-                                        " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                        " qName=" + toUString( qName ) );
+                                        " uri=" + uri + " localName=" + localName +
+                                        " qName=" + qName );
             }
 
             cv_ni->setCodecs( vi );
@@ -817,8 +994,8 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
             /// Found unknown XML child element of CompressedVector, not
             /// prototype or codecs
             throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
-                                  +"fileName=" + imf_->fileName() + " uri=" + toUString( uri ) +
-                                     " localName=" + toUString( localName ) + " qName=" + toUString( qName ) );
+                                  +"fileName=" + imf_->fileName() + " uri=" + uri +
+                                     " localName=" + localName + " qName=" + qName );
          }
       }
       break;
@@ -826,16 +1003,15 @@ void E57XmlParser::endElement( const XMLCh *const uri, const XMLCh *const localN
          /// Have bad XML nesting, parent should have been a container.
          throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT,
                                "parentType=" + toString( parent_ni->type() ) + " fileName=" + imf_->fileName() +
-                                  " uri=" + toUString( uri ) + " localName=" + toUString( localName ) +
-                                  " qName=" + toUString( qName ) );
+                                  " uri=" + uri + " localName=" + localName +
+                                  " qName=" + qName );
    }
 }
 
-void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length )
+void E57XmlParser::handleCharacters( const ustring &chars )
 {
-//??? use length to make ustring
 #ifdef E57_MAX_VERBOSE
-   std::cout << "characters, chars=\"" << toUString( chars ) << "\" length=" << length << std::endl;
+   std::cout << "characters, chars=\"" << chars << "\" length=" << chars.length() << std::endl;
 #endif
    /// Get active element
    ParseInfo &pi = stack_.top();
@@ -849,16 +1025,15 @@ void E57XmlParser::characters( const XMLCh *const chars, const XMLSize_t length
       case E57_BLOB:
       {
          /// If characters aren't whitespace, have an error, else ignore
-         ustring s = toUString( chars );
-         if ( s.find_first_not_of( " \t\n\r" ) != std::string::npos )
+         if ( chars.find_first_not_of( " \t\n\r" ) != std::string::npos )
          {
-            throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "chars=" + toUString( chars ) );
+            throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "chars=" + chars );
          }
       }
       break;
       default:
          /// Append to any previous characters
-         pi.childText += toUString( chars );
+         pi.childText += chars;
    }
 }
 
@@ -899,18 +1074,28 @@ ustring E57XmlParser::toUString( const XMLCh *const xml_str )
    return ( u_str );
 }
 
-ustring E57XmlParser::lookupAttribute( const Attributes &attributes, const XMLCh *attribute_name )
+ustring E57XmlParser::lookupAttribute( const XmlAttributeList &attributes, const char *attribute_name )
 {
-   XMLSize_t attr_index;
-   if ( !attributes.getIndex( attribute_name, attr_index ) )
+   for ( const XmlAttribute &attribute : attributes )
    {
-      throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "attributeName=" + toUString( attribute_name ) );
+      if ( attribute.qName == attribute_name )
+      {
+         return attribute.value;
+      }
    }
-   return ( toUString( attributes.getValue( attr_index ) ) );
+
+   throw E57_EXCEPTION2( E57_ERROR_BAD_XML_FORMAT, "attributeName=" + ustring( attribute_name ) );
 }
 
-bool E57XmlParser::isAttributeDefined( const Attributes &attributes, const XMLCh *attribute_name )
+bool E57XmlParser::isAttributeDefined( const XmlAttributeList &attributes, const char *attribute_name )
 {
-   XMLSize_t attr_index;
-   return ( attributes.getIndex( attribute_name, attr_index ) );
+   for ( const XmlAttribute &attribute : attributes )
+   {
+      if ( attribute.qName == attribute_name )
+      {
+         return true;
+      }
+   }
+
+   return false;
 }
@@ -28,11 +28,13 @@
 #pragma once
 
 #include <stack>
+#include <vector>
 
 #include <xercesc/sax/InputSource.hpp>
 #include <xercesc/sax2/DefaultHandler.hpp>
 
 #include "Common.h"
+#include "XmlPullParser.h"
 
 using namespace XERCES_CPP_NAMESPACE;
 
@@ -44,19 +46,56 @@ namespace XERCES_CPP_NAMESPACE
 namespace e57
 {
    class CheckedFile;
+   class StructureNodeImpl;
+
+   /// Parser state kept by each thread and reused by every file opened on it: Xerces-C stays initialized with one
+   /// configured SAX2 reader, and the built-in parser keeps its buffers
+   class XmlParserContext
+   {
+   public:
+      static XmlParserContext &threadContext();
+
+      XmlParserContext();
+      ~XmlParserContext();
+
+      XmlParserContext( const XmlParserContext & ) = delete;
+      XmlParserContext &operator=( const XmlParserContext & ) = delete;
+
+   private:
+      friend class E57XmlParser;
+
+      /// Initializes Xerces-C once per process
+      static void initializeXerces();
+
+      /// Initializes Xerces-C and creates the reader on first use
+      SAX2XMLReader *xercesReader();
+
+      /// Drops the XML buffer if an unusually large section grew it
+      void trimBuffer();
+
+      SAX2XMLReader *xercesReader_;
+      XmlAttributeList attributes_; /// attributes of the current Xerces-C element
+
+      std::vector<char> xml_; /// XML section read for the built-in parser
+      XmlPullParser pullParser_;
+   };
 
    class E57XmlParser : public DefaultHandler
    {
    public:
       E57XmlParser( ImageFileImplSharedPtr imf );
-      ~E57XmlParser() override;
+      ~E57XmlParser() override = default;
 
-      void init();
+      /// Parse the XML section of a file, building its node tree
+      void parseXerces( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength );
+      void parseBuiltin( CheckedFile *cf, uint64_t logicalStart, uint64_t logicalLength, bool lazy = false );
 
-      void parse( InputSource &inputSource );
+      /// Parse the children of a structure whose XML was skipped by a lazy parseBuiltin()
+      void parseDeferred( const std::shared_ptr<StructureNodeImpl> &node, CheckedFile *cf, uint64_t logicalStart,
+                          uint64_t logicalLength );
 
    private:
-      /// SAX interface
+      /// SAX interface, translated to the handlers below
       void startElement( const XMLCh *const uri, const XMLCh *const localName, const XMLCh *const qName,
                          const Attributes &attributes ) override;
       void endElement( const XMLCh *const uri, const XMLCh *const localName, const XMLCh *const qName ) override;
@@ -67,9 +106,21 @@ namespace e57
       void error( const SAXParseException &ex ) override;
       void fatalError( const SAXParseException &ex ) override;
 
+      /// Handlers of both parsers, all strings UTF-8
+      void handleStartElement( const ustring &uri, const ustring &localName, const ustring &qName,
+                               const XmlAttributeList &attributes );
+      void handleEndElement( const ustring &uri, const ustring &localName, const ustring &qName );
+      void handleCharacters( const ustring &chars );
+
+      /// Creates a node of the file in its arena
+      template <typename T, typename... Args> std::shared_ptr<T> makeNode( Args &&... args );
+
+      /// Runs the handlers on the events of the built-in parser. logicalStart is where its data is in the file.
+      void parseEvents( XmlPullParser &parser, uint64_t logicalStart );
+
       ustring toUString( const XMLCh *const xml_str );
-      ustring lookupAttribute( const Attributes &attributes, const XMLCh *attribute_name );
-      bool isAttributeDefined( const Attributes &attributes, const XMLCh *attribute_name );
+      ustring lookupAttribute( const XmlAttributeList &attributes, const char *attribute_name );
+      bool isAttributeDefined( const XmlAttributeList &attributes, const char *attribute_name );
 
       ImageFileImplSharedPtr imf_; /// Image file we are reading
 
@@ -91,6 +142,7 @@ namespace e57
          int64_t length;                  // used in E57_BLOB
          bool allowHeterogeneousChildren; // used in E57_VECTOR
          int64_t recordCount;             // used in E57_COMPRESSED_VECTOR
+         bool deferChildren;              // used in E57_VECTOR, skip the children of its structures
          ustring childText;               // used by all types, accumlates all child text between tags
 
          /// Holds node for Structure, Vector, and CompressedVector so can append
@@ -102,7 +154,8 @@ namespace e57
       };
       std::stack<ParseInfo> stack_; /// Stores the current path in tree we are reading
 
-      SAX2XMLReader *xmlReader;
+      XmlParserContext &context_; /// of the calling thread
+      bool lazy_;                 /// defer the children of the scans and images
    };
 
    class E57XmlFileInputSource : public InputSource
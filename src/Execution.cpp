@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Execution.h"
+
+namespace e57
+{
+   namespace
+   {
+      /// Shared with the workers, which may outlive runWorkers() if the executor starts them late
+      struct WorkerState
+      {
+         std::mutex mutex; /// guards everything below
+         std::condition_variable finished;
+         bool closed = false; /// workers starting after this do nothing
+         size_t running = 0;
+         std::exception_ptr error;
+      };
+
+      /// Runs work unless the caller has stopped waiting for workers
+      void runWorker( const std::shared_ptr<WorkerState> &state, const std::function<void()> &work )
+      {
+         {
+            std::lock_guard<std::mutex> lock( state->mutex );
+            if ( state->closed )
+            {
+               return;
+            }
+            ++state->running;
+         }
+
+         std::exception_ptr error;
+
+         try
+         {
+            work();
+         }
+         catch ( ... )
+         {
+            error = std::current_exception();
+         }
+
+         {
+            std::lock_guard<std::mutex> lock( state->mutex );
+            if ( error && !state->error )
+            {
+               state->error = error;
+            }
+            --state->running;
+         }
+         state->finished.notify_all();
+      }
+   }
+
+   size_t threadCount( const ExecutionContext &context )
+   {
+      const size_t count = ( context.threadCount != 0 ) ? context.threadCount : std::thread::hardware_concurrency();
+
+      return std::max<size_t>( count, 1 );
+   }
+
+   void runWorkers( const ExecutionContext &context, size_t workerCount, const std::function<void()> &work )
+   {
+      auto state = std::make_shared<WorkerState>();
+
+      std::vector<std::thread> threads;
+
+      /// If a worker can't be started, the ones that were do the work
+      try
+      {
+         for ( size_t i = 1; i < workerCount; ++i )
+         {
+            if ( context.executor )
+            {
+               /// The task only holds the state, work is only called while this function waits
+               context.executor( [state, &work]() { runWorker( state, work ); } );
+            }
+            else
+            {
+               threads.emplace_back( runWorker, state, std::cref( work ) );
+            }
+         }
+      }
+      catch ( ... )
+      {
+      }
+
+      runWorker( state, work );
+
+      for ( auto &thread : threads )
+      {
+         thread.join();
+      }
+
+      /// Workers not started by now would only find the work done, so don't wait for them
+      std::unique_lock<std::mutex> lock( state->mutex );
+      state->closed = true;
+      state->finished.wait( lock, [&state] { return state->running == 0; } );
+
+      if ( state->error )
+      {
+         std::rethrow_exception( state->error );
+      }
+   }
+} // end namespace e57
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include "E57Format.h"
+
+namespace e57
+{
+   //! Number of threads the context allows for one call, at least 1
+   size_t threadCount( const ExecutionContext &context );
+
+   //! Runs work on workerCount threads, one of them the calling thread, and waits for them to finish. Each worker
+   //! takes work items until there are none left, so a worker that starts late may find nothing to do. The first
+   //! exception thrown by a worker is rethrown once all of them have finished.
+   void runWorkers( const ExecutionContext &context, size_t workerCount, const std::function<void()> &work );
+} // end namespace e57
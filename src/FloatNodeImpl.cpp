@@ -26,7 +26,7 @@
  */
 
 #include "FloatNodeImpl.h"
-#include "CheckedFile.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -143,7 +143,7 @@ namespace e57
       }
    }
 
-   void FloatNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, CheckedFile &cf, int indent,
+   void FloatNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, XmlWriter &xml, int indent,
                                  const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -155,32 +155,32 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      cf << space( indent ) << "<" << fieldName << " type=\"Float\"";
+      xml << space( indent ) << "<" << fieldName << " type=\"Float\"";
       if ( precision_ == E57_SINGLE )
       {
-         cf << " precision=\"single\"";
+         xml << " precision=\"single\"";
 
          /// Don't need to write if are default values
          if ( minimum_ > E57_FLOAT_MIN )
          {
-            cf << " minimum=\"" << static_cast<float>( minimum_ ) << "\"";
+            xml << " minimum=\"" << static_cast<float>( minimum_ ) << "\"";
          }
          if ( maximum_ < E57_FLOAT_MAX )
          {
-            cf << " maximum=\"" << static_cast<float>( maximum_ ) << "\"";
+            xml << " maximum=\"" << static_cast<float>( maximum_ ) << "\"";
          }
 
          /// Write value as child text, unless it is the default value
          if ( value_ != 0.0 )
          {
-            cf << ">" << static_cast<float>( value_ ) << "</" << fieldName << ">\n";
+            xml << ">" << static_cast<float>( value_ ) << "</" << fieldName << ">\n";
          }
          else
          {
-            cf << "/>\n";
+            xml << "/>\n";
          }
       }
       else
@@ -190,21 +190,21 @@ namespace e57
          /// Don't need to write if are default values
          if ( minimum_ > E57_DOUBLE_MIN )
          {
-            cf << " minimum=\"" << minimum_ << "\"";
+            xml << " minimum=\"" << minimum_ << "\"";
          }
          if ( maximum_ < E57_DOUBLE_MAX )
          {
-            cf << " maximum=\"" << maximum_ << "\"";
+            xml << " maximum=\"" << maximum_ << "\"";
          }
 
          /// Write value as child text, unless it is the default value
          if ( value_ != 0.0 )
          {
-            cf << ">" << value_ << "</" << fieldName << ">\n";
+            xml << ">" << value_ << "</" << fieldName << ">\n";
          }
          else
          {
-            cf << "/>\n";
+            xml << "/>\n";
          }
       }
    }
@@ -27,12 +27,22 @@
 
 #include "ImageFileImpl.h"
 #include "CheckedFile.h"
+#include "CompressedVectorWriterImpl.h"
 #include "E57Version.h"
 #include "E57XmlParser.h"
+#include "NodeArena.h"
 #include "StructureNodeImpl.h"
+#include "Trace.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
+#ifdef E57_BUILTIN_XML_PARSER
+   constexpr XmlParserPolicy DEFAULT_XML_PARSER = XML_PARSER_BUILTIN;
+#else
+   constexpr XmlParserPolicy DEFAULT_XML_PARSER = XML_PARSER_XERCES;
+#endif
+
    struct NameSpace
    {
       ustring prefix;
@@ -74,10 +84,11 @@ namespace e57
    }
 #endif
 
-   ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy ) :
+   ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy, const ExecutionContext &context ) :
       isWriter_( false ), writerCount_( 0 ), readerCount_( 0 ),
-      checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ), file_( nullptr ), xmlLogicalOffset_( 0 ),
-      xmlLogicalLength_( 0 ), unusedLogicalStart_( 0 )
+      checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ), executionContext_( context ), file_( nullptr ),
+      xmlLogicalOffset_( 0 ), xmlLogicalLength_( 0 ), unusedLogicalStart_( 0 ),
+      nodeArena_( std::make_shared<NodeArena>() )
    {
       /// First phase of construction, can't do much until have the ImageFile
       /// object. See ImageFileImpl::construct2() for second phase.
@@ -139,15 +150,8 @@ namespace e57
          /// Open file for reading.
          file_ = new CheckedFile( fileName_, CheckedFile::ReadOnly, checksumPolicy );
 
-         std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
-         root_ = root;
-         root_->setAttachedRecursive();
-
-         E57FileHeader header;
-         readFileHeader( file_, header );
-
-         xmlLogicalOffset_ = file_->physicalToLogical( header.xmlPhysicalOffset );
-         xmlLogicalLength_ = header.xmlLogicalLength;
+         /// The root is created by the parser
+         readXmlSectionRange( file_, xmlLogicalOffset_, xmlLogicalLength_ );
       }
       catch ( ... )
       {
@@ -159,18 +163,10 @@ namespace e57
 
       try
       {
-         /// Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
-
-         parser.init();
-
-         /// Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
-
          unusedLogicalStart_ = sizeof( E57FileHeader );
 
          /// Do the parse, building up the node tree
-         parser.parse( xmlSection );
+         parseXml();
       }
       catch ( ... )
       {
@@ -191,9 +187,6 @@ namespace e57
       unusedLogicalStart_ = sizeof( E57FileHeader );
       fileName_ = "<StreamBuffer>";
 
-      /// Get shared_ptr to this object
-      ImageFileImplSharedPtr imf = shared_from_this();
-
       isWriter_ = false;
       file_ = nullptr;
 
@@ -202,15 +195,8 @@ namespace e57
          /// Open file for reading.
          file_ = new CheckedFile( input, size, checksumPolicy );
 
-         std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
-         root_ = root;
-         root_->setAttachedRecursive();
-
-         E57FileHeader header;
-         readFileHeader( file_, header );
-
-         xmlLogicalOffset_ = file_->physicalToLogical( header.xmlPhysicalOffset );
-         xmlLogicalLength_ = header.xmlLogicalLength;
+         /// The root is created by the parser
+         readXmlSectionRange( file_, xmlLogicalOffset_, xmlLogicalLength_ );
       }
       catch ( ... )
       {
@@ -222,18 +208,44 @@ namespace e57
 
       try
       {
-         /// Create parser state, attach its event handers to the SAX2 reader
-         E57XmlParser parser( imf );
+         unusedLogicalStart_ = sizeof( E57FileHeader );
 
-         parser.init();
+         /// Do the parse, building up the node tree
+         parseXml();
+      }
+      catch ( ... )
+      {
+         delete file_;
+         file_ = nullptr;
 
-         /// Create input source (XML section of E57 file turned into a stream).
-         E57XmlFileInputSource xmlSection( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+         throw;
+      }
+   }
 
-         unusedLogicalStart_ = sizeof( E57FileHeader );
+   void ImageFileImpl::construct2( std::vector<char> &output )
+   {
+      /// Second phase of construction, now we have a well-formed ImageFile object.
 
-         /// Do the parse, building up the node tree
-         parser.parse( xmlSection );
+#ifdef E57_MAX_VERBOSE
+      std::cout << "ImageFileImpl() called, fileName=<MemoryBuffer> mode=w" << std::endl;
+#endif
+      unusedLogicalStart_ = sizeof( E57FileHeader );
+      fileName_ = "<MemoryBuffer>";
+
+      isWriter_ = true;
+      file_ = nullptr;
+
+      try
+      {
+         /// Write to the vector, emptying it first
+         file_ = new CheckedFile( output );
+
+         std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( shared_from_this() ) );
+         root_ = root;
+         root_->setAttachedRecursive();
+
+         xmlLogicalOffset_ = 0;
+         xmlLogicalLength_ = 0;
       }
       catch ( ... )
       {
@@ -256,8 +268,8 @@ namespace e57
       if ( writerCount_ < 0 )
       {
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "fileName=" + fileName_ +
-                                                      " writerCount=" + toString( writerCount_ ) +
-                                                      " readerCount=" + toString( readerCount_ ) );
+                                                      " writerCount=" + toString( writerCount_.load() ) +
+                                                      " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
@@ -274,8 +286,8 @@ namespace e57
       if ( readerCount_ < 0 )
       {
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "fileName=" + fileName_ +
-                                                      " writerCount=" + toString( writerCount_ ) +
-                                                      " readerCount=" + toString( readerCount_ ) );
+                                                      " writerCount=" + toString( writerCount_.load() ) +
+                                                      " readerCount=" + toString( readerCount_.load() ) );
       }
 #endif
    }
@@ -295,30 +307,51 @@ namespace e57
          return;
       }
 
+      E57_TRACE_SPAN( "close" );
+
       if ( isWriter_ )
       {
-         /// Go to end of file, note physical position
-         xmlLogicalOffset_ = unusedLogicalStart_;
-         file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
-         uint64_t xmlPhysicalOffset = file_->position( CheckedFile::Physical );
-         *file_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+         /// Sections can only still be waiting if the writer at the end of the file was left open
+         {
+            std::lock_guard<std::mutex> lock( writeMutex_ );
+
+            for ( auto &section : spooledSections_ )
+            {
+               CompressedVectorWriterImpl::writeSpooledSection( *this, section );
+            }
+            spooledSections_.clear();
+         }
+
+         E57_TRACE_SPAN( "writeXml" );
+
+         /// Format the whole XML section in memory first, so it goes to the file in one write
+         XmlWriter xml;
+
+         xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 #ifdef E57_OXYGEN_SUPPORT //???                                                             \
-                          //???        *file_ << "<?oxygen                                  \
+                          //???        xml << "<?oxygen                                     \
                           // RNGSchema=\"file:/C:/kevin/astm/DataFormat/xif/las_v0_05.rnc\" \
                           // type=\"compact\"?>\n";
 #endif
 
          //??? need to add name space attributes to e57Root
-         root_->writeXml( shared_from_this(), *file_, 0, "e57Root" );
+         root_->writeXml( shared_from_this(), xml, 0, "e57Root" );
 
          /// Pad XML section so length is multiple of 4
-         while ( ( file_->position( CheckedFile::Logical ) - xmlLogicalOffset_ ) % 4 != 0 )
+         while ( xml.size() % 4 != 0 )
          {
-            *file_ << " ";
+            xml << " ";
          }
 
+         /// Go to end of file, note physical position
+         xmlLogicalOffset_ = unusedLogicalStart_;
+         file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
+         uint64_t xmlPhysicalOffset = file_->position( CheckedFile::Physical );
+
+         file_->write( xml.data(), xml.size() );
+
          /// Note logical length
-         xmlLogicalLength_ = file_->position( CheckedFile::Logical ) - xmlLogicalOffset_;
+         xmlLogicalLength_ = xml.size();
 
          /// Init header contents
          E57FileHeader header;
@@ -389,6 +422,40 @@ namespace e57
       return readerCount_;
    }
 
+   void ImageFileImpl::setExecutionContext( const ExecutionContext &context )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      executionContext_ = context;
+   }
+
+   ExecutionContext ImageFileImpl::executionContext() const
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      return executionContext_;
+   }
+
+   void ImageFileImpl::setStatisticsEnabled( bool enabled )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      statisticsEnabled_ = enabled;
+      file_->setStatisticsEnabled( enabled );
+   }
+
+   bool ImageFileImpl::statisticsEnabled() const
+   {
+      return statisticsEnabled_;
+   }
+
+   ImageFileStatistics ImageFileImpl::statistics() const
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      return file_->statistics();
+   }
+
    ImageFileImpl::~ImageFileImpl()
    {
       /// Try to cancel if not already closed, but don't allow any exceptions to
@@ -806,6 +873,8 @@ namespace e57
 
    void ImageFileImpl::readFileHeader( CheckedFile *file, E57FileHeader &header )
    {
+      E57_TRACE_SPAN( "readFileHeader" );
+
       /// Double check that compiler thinks sizeof header is what it is supposed to
       /// be
       static_assert( sizeof( E57FileHeader ) == 48, "Unexpected size of E57FileHeader" );
@@ -859,6 +928,78 @@ namespace e57
       }
    }
 
+   void ImageFileImpl::readXmlSectionRange( CheckedFile *file, uint64_t &logicalStart, uint64_t &logicalLength )
+   {
+      E57FileHeader header;
+      readFileHeader( file, header );
+
+      logicalStart = file->physicalToLogical( header.xmlPhysicalOffset );
+      logicalLength = header.xmlLogicalLength;
+   }
+
+   void ImageFileImpl::parseXml()
+   {
+      E57_TRACE_SPAN_ARG( "parseXml", "length", xmlLogicalLength_ );
+
+      /// Create parser state, its event handlers build up the node tree. The Xerces-C reader and the buffers are
+      /// kept by the thread for the next file.
+      E57XmlParser parser( shared_from_this() );
+
+      XmlParserPolicy policy = executionContext_.xmlParser;
+
+      if ( policy == XML_PARSER_DEFAULT )
+      {
+         policy = DEFAULT_XML_PARSER;
+      }
+
+      /// Only the built-in parser can skip parts of the section
+      if ( executionContext_.lazyMetadata )
+      {
+         policy = XML_PARSER_BUILTIN;
+      }
+
+      switch ( policy )
+      {
+         case XML_PARSER_XERCES:
+            parser.parseXerces( file_, xmlLogicalOffset_, xmlLogicalLength_ );
+            break;
+         case XML_PARSER_BUILTIN:
+            parser.parseBuiltin( file_, xmlLogicalOffset_, xmlLogicalLength_, executionContext_.lazyMetadata );
+            break;
+         default:
+            throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "xmlParser=" + toString( policy ) );
+      }
+   }
+
+   void ImageFileImpl::parseDeferred( const std::shared_ptr<StructureNodeImpl> &node, uint64_t logicalStart,
+                                      uint64_t logicalLength )
+   {
+      checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      E57_TRACE_SPAN_ARG( "parseDeferred", "length", logicalLength );
+
+      E57XmlParser parser( shared_from_this() );
+
+      parser.parseDeferred( node, file_, logicalStart, logicalLength );
+   }
+
+   std::recursive_mutex &ImageFileImpl::deferredMutex()
+   {
+      return deferredMutex_;
+   }
+
+   const ustring &ImageFileImpl::internName( const ustring &name )
+   {
+      std::lock_guard<std::mutex> lock( namePoolMutex_ );
+
+      return *namePool_.insert( name ).first;
+   }
+
+   const std::shared_ptr<NodeArena> &ImageFileImpl::nodeArena() const
+   {
+      return nodeArena_;
+   }
+
    void ImageFileImpl::checkImageFileOpen( const char *srcFileName, int srcLineNumber,
                                            const char *srcFunctionName ) const
    {
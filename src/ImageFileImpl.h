@@ -27,23 +27,37 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 
 #include "Common.h"
 
 namespace e57
 {
    class CheckedFile;
+   class CompressedVectorNodeImpl;
+   class CompressedVectorWriterImpl;
+   class NodeArena;
 
    struct E57FileHeader;
    struct NameSpace;
 
+   /// A CompressedVector section finished while another writer had the end of the file, waiting to be written there
+   struct SpooledSection
+   {
+      std::shared_ptr<CompressedVectorNodeImpl> cVector;
+      std::vector<char> packets; /// data packets, back to back as they will be in the file
+   };
+
    class ImageFileImpl : public std::enable_shared_from_this<ImageFileImpl>
    {
    public:
-      ImageFileImpl( ReadChecksumPolicy policy );
+      ImageFileImpl( ReadChecksumPolicy policy, const ExecutionContext &context = ExecutionContext() );
       void construct2( const ustring &fileName, const ustring &mode );
       void construct2( const char *input, const uint64_t size );
+      void construct2( std::vector<char> &output );
       std::shared_ptr<StructureNodeImpl> root();
       void close();
       void cancel();
@@ -53,6 +67,15 @@ namespace e57
       int readerCount() const;
       ~ImageFileImpl();
 
+      void setExecutionContext( const ExecutionContext &context );
+      ExecutionContext executionContext() const;
+
+      /// Readers and writers opened afterwards keep counters only if statistics are enabled
+      void setStatisticsEnabled( bool enabled );
+      bool statisticsEnabled() const;
+      ImageFileStatistics statistics() const;
+
+      /// Caller must hold writeMutex_ if CompressedVectorWriters may be open on other threads
       uint64_t allocateSpace( uint64_t byteCount, bool doExtendNow );
       CheckedFile *file() const;
       ustring fileName() const;
@@ -76,12 +99,26 @@ namespace e57
       void pathNameParse( const ustring &pathName, bool &isRelative, StringList &fields );
       ustring pathNameUnparse( bool isRelative, const StringList &fields );
 
-      unsigned bitsNeeded( int64_t minimum, int64_t maximum );
+      static unsigned bitsNeeded( int64_t minimum, int64_t maximum );
       void incrWriterCount();
       void decrWriterCount();
       void incrReaderCount();
       void decrReaderCount();
 
+      /// Parses children of a structure skipped by a lazy open, caller must hold deferredMutex()
+      void parseDeferred( const std::shared_ptr<StructureNodeImpl> &node, uint64_t logicalStart,
+                          uint64_t logicalLength );
+      std::recursive_mutex &deferredMutex();
+
+      /// Element names are shared by the nodes of the file, the strings live as long as it
+      const ustring &internName( const ustring &name );
+
+      /// Memory for the nodes created by the XML parser
+      const std::shared_ptr<NodeArena> &nodeArena() const;
+
+      /// Checks the header of a file opened for reading, and returns where its XML section is
+      static void readXmlSectionRange( CheckedFile *file, uint64_t &logicalStart, uint64_t &logicalLength );
+
       /// Diagnostic functions:
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) const;
@@ -96,16 +133,20 @@ namespace e57
                                                // friends too
 
       static void readFileHeader( CheckedFile *file, E57FileHeader &header );
+      void parseXml();
 
       void checkImageFileOpen( const char *srcFileName, int srcLineNumber, const char *srcFunctionName ) const;
 
       ustring fileName_;
       bool isWriter_;
-      int writerCount_;
-      int readerCount_;
+      std::atomic<int> writerCount_; /// readers and writers may be opened and closed on several threads
+      std::atomic<int> readerCount_;
 
       ReadChecksumPolicy checksumPolicy;
 
+      ExecutionContext executionContext_;
+      bool statisticsEnabled_ = false;
+
       CheckedFile *file_;
 
       /// Read file attributes
@@ -115,10 +156,26 @@ namespace e57
       /// Write file attributes
       uint64_t unusedLogicalStart_;
 
+      /// Several CompressedVectorWriters may be open on different threads. One at a time writes its packets straight
+      /// to the end of the file, so its section stays contiguous. The others spool their packets until the end of
+      /// the file is free.
+      std::mutex writeMutex_; /// guards file_ writes, unusedLogicalStart_ and everything below
+      CompressedVectorWriterImpl *tailWriter_ = nullptr; /// writer whose section is at the end of the file
+      std::vector<SpooledSection> spooledSections_;      /// finished sections waiting for tailWriter_ to close
+      uint64_t spooledBytes_ = 0; /// packets held by spooling writers and spooledSections_, limited by memoryBudget
+
       /// Bidirectional map from namespace prefix to uri
       std::vector<NameSpace> nameSpaces_;
 
       /// Smart pointer to metadata tree
       std::shared_ptr<StructureNodeImpl> root_;
+
+      /// Serializes parsing of deferred children, which may nest when a parsed node is accessed
+      std::recursive_mutex deferredMutex_;
+
+      std::mutex namePoolMutex_; /// guards namePool_, the strings themselves never move
+      std::unordered_set<ustring> namePool_;
+
+      std::shared_ptr<NodeArena> nodeArena_;
    };
 }
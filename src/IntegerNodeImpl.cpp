@@ -26,7 +26,7 @@
  */
 
 #include "IntegerNodeImpl.h"
-#include "CheckedFile.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -114,7 +114,7 @@ namespace e57
       }
    }
 
-   void IntegerNodeImpl::writeXml( ImageFileImplSharedPtr /*imf???*/, CheckedFile &cf, int indent,
+   void IntegerNodeImpl::writeXml( ImageFileImplSharedPtr /*imf???*/, XmlWriter &xml, int indent,
                                    const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -126,29 +126,29 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      cf << space( indent ) << "<" << fieldName << " type=\"Integer\"";
+      xml << space( indent ) << "<" << fieldName << " type=\"Integer\"";
 
       /// Don't need to write if are default values
       if ( minimum_ != E57_INT64_MIN )
       {
-         cf << " minimum=\"" << minimum_ << "\"";
+         xml << " minimum=\"" << minimum_ << "\"";
       }
       if ( maximum_ != E57_INT64_MAX )
       {
-         cf << " maximum=\"" << maximum_ << "\"";
+         xml << " maximum=\"" << maximum_ << "\"";
       }
 
       /// Write value as child text, unless it is the default value
       if ( value_ != 0 )
       {
-         cf << ">" << value_ << "</" << fieldName << ">\n";
+         xml << ">" << value_ << "</" << fieldName << ">\n";
       }
       else
       {
-         cf << "/>\n";
+         xml << "/>\n";
       }
    }
 
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include "NodeArena.h"
+
+namespace e57
+{
+   /// Holds a few hundred nodes
+   constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+   void *NodeArena::allocate( size_t size, size_t alignment )
+   {
+      /// Large requests get a chunk of their own, so the rest of the current chunk isn't wasted
+      if ( size > CHUNK_SIZE / 4 )
+      {
+         chunks_.emplace_back( new char[size] );
+         return chunks_.back().get();
+      }
+
+      void *p = pos_;
+      size_t space = static_cast<size_t>( end_ - pos_ );
+
+      if ( ( p == nullptr ) || ( std::align( alignment, size, p, space ) == nullptr ) )
+      {
+         chunks_.emplace_back( new char[CHUNK_SIZE] );
+
+         p = chunks_.back().get();
+         space = CHUNK_SIZE;
+         end_ = chunks_.back().get() + CHUNK_SIZE;
+
+         std::align( alignment, size, p, space );
+      }
+
+      pos_ = static_cast<char *>( p ) + size;
+
+      return p;
+   }
+} // end namespace e57
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace e57
+{
+   /// Memory of the nodes created by the XML parser of a file. The nodes of a file's tree are rarely destroyed before
+   /// the file, so memory is handed out from large chunks and only released with the arena.
+   class NodeArena
+   {
+   public:
+      NodeArena() = default;
+
+      NodeArena( const NodeArena & ) = delete;
+      NodeArena &operator=( const NodeArena & ) = delete;
+
+      /// Not thread-safe. The parsers of a file don't run at the same time.
+      void *allocate( size_t size, size_t alignment );
+
+   private:
+      std::vector<std::unique_ptr<char[]>> chunks_;
+      char *pos_ = nullptr;
+      char *end_ = nullptr;
+   };
+
+   /// Allocator for std::allocate_shared(). Each allocation keeps the arena alive, since handles to the nodes may
+   /// outlive the file.
+   template <typename T> class NodeAllocator
+   {
+   public:
+      using value_type = T;
+
+      explicit NodeAllocator( std::shared_ptr<NodeArena> arena ) : arena_( std::move( arena ) )
+      {
+      }
+
+      template <typename U> NodeAllocator( const NodeAllocator<U> &other ) : arena_( other.arena_ )
+      {
+      }
+
+      T *allocate( size_t n )
+      {
+         return static_cast<T *>( arena_->allocate( n * sizeof( T ), alignof( T ) ) );
+      }
+
+      void deallocate( T * /*p*/, size_t /*n*/ )
+      {
+         /// Released with the arena
+      }
+
+      template <typename U> bool operator==( const NodeAllocator<U> &other ) const
+      {
+         return arena_ == other.arena_;
+      }
+
+      template <typename U> bool operator!=( const NodeAllocator<U> &other ) const
+      {
+         return arena_ != other.arena_;
+      }
+
+   private:
+      template <typename U> friend class NodeAllocator;
+
+      std::shared_ptr<NodeArena> arena_;
+   };
+} // end namespace e57
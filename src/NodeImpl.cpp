@@ -32,7 +32,14 @@
 
 using namespace e57;
 
-NodeImpl::NodeImpl( ImageFileImplWeakPtr destImageFile ) : destImageFile_( destImageFile ), isAttached_( false )
+namespace
+{
+   /// Element name of nodes without a parent
+   const ustring NO_ELEMENT_NAME;
+}
+
+NodeImpl::NodeImpl( ImageFileImplWeakPtr destImageFile ) :
+   destImageFile_( destImageFile ), elementName_( &NO_ELEMENT_NAME ), isAttached_( false )
 {
    checkImageFileOpen( __FILE__, __LINE__,
                        static_cast<const char *>( __FUNCTION__ ) ); // does checking for all node type ctors
@@ -84,10 +91,10 @@ ustring NodeImpl::pathName() const
 
    if ( p->isRoot() )
    {
-      return ( "/" + elementName_ );
+      return ( "/" + *elementName_ );
    }
 
-   return ( p->pathName() + "/" + elementName_ );
+   return ( p->pathName() + "/" + *elementName_ );
 }
 
 ustring NodeImpl::relativePathName( const NodeImplSharedPtr &origin, ustring childPathName ) const
@@ -110,17 +117,17 @@ ustring NodeImpl::relativePathName( const NodeImplSharedPtr &origin, ustring chi
 
    if ( childPathName.empty() )
    {
-      return p->relativePathName( origin, elementName_ );
+      return p->relativePathName( origin, *elementName_ );
    }
 
-   return p->relativePathName( origin, elementName_ + "/" + childPathName );
+   return p->relativePathName( origin, *elementName_ + "/" + childPathName );
 }
 
 ustring NodeImpl::elementName() const
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
-   return elementName_;
+   return *elementName_;
 }
 
 ImageFileImplSharedPtr NodeImpl::destImageFile()
@@ -172,7 +179,7 @@ void NodeImpl::setParent( NodeImplSharedPtr parent, const ustring &elementName )
    }
 
    parent_ = parent;
-   elementName_ = elementName;
+   elementName_ = &ImageFileImplSharedPtr( destImageFile_ )->internName( elementName );
 
    /// If parent is attached then we are attached (and all of our children)
    if ( parent->isAttached() )
@@ -383,8 +390,11 @@ bool NodeImpl::findTerminalPosition( const NodeImplSharedPtr &target, uint64_t &
 #ifdef E57_DEBUG
 void NodeImpl::dump( int indent, std::ostream &os ) const
 {
-   /// don't checkImageFileOpen
-   os << space( indent ) << "elementName: " << elementName_ << std::endl;
+   /// don't checkImageFileOpen, but elementName_ points into the name pool of the file, so keep it alive while
+   /// dumping (throws if the file is already destroyed)
+   ImageFileImplSharedPtr destImageFile( destImageFile_ );
+
+   os << space( indent ) << "elementName: " << *elementName_ << std::endl;
    os << space( indent ) << "isAttached:  " << isAttached_ << std::endl;
    os << space( indent ) << "path:        " << pathName() << std::endl;
 }
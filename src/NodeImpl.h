@@ -32,7 +32,7 @@
 namespace e57
 {
 
-   class CheckedFile;
+   class XmlWriter;
 
    class NodeImpl : public std::enable_shared_from_this<NodeImpl>
    {
@@ -63,7 +63,7 @@ namespace e57
       void checkBuffers( const std::vector<SourceDestBuffer> &sdbufs, bool allowMissing );
       bool findTerminalPosition( const NodeImplSharedPtr &target, uint64_t &countFromLeft );
 
-      virtual void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
+      virtual void writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent,
                              const char *forcedFieldName = nullptr ) = 0;
 
       virtual ~NodeImpl() = default;
@@ -91,11 +91,16 @@ namespace e57
       {
          return NodeImplSharedPtr();
       }
+      /// Node at the path made of fields[level] onwards, relative to this node
+      virtual NodeImplSharedPtr lookup( const StringList & /*fields*/, unsigned /*level*/ )
+      {
+         return NodeImplSharedPtr();
+      }
       NodeImplSharedPtr getRoot();
 
       ImageFileImplWeakPtr destImageFile_;
       NodeImplWeakPtr parent_;
-      ustring elementName_;
+      const ustring *elementName_; /// interned by the ImageFileImpl
       bool isAttached_;
    };
 }
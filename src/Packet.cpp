@@ -29,6 +29,8 @@
 
 #include "CheckedFile.h"
 #include "Packet.h"
+#include "Statistics.h"
+#include "Trace.h"
 
 using namespace e57;
 
@@ -114,6 +116,11 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
          /// Mark entry with current useCount (keeps track of age of entry).
          entry.lastUsed_ = ++useCount_;
 
+         if ( statistics_ != nullptr )
+         {
+            ++statistics_->cacheHits;
+         }
+
          /// Publish buffer address to caller
          pkt = entry.buffer_;
 
@@ -147,7 +154,22 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
    std::cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << std::endl;
 #endif
 
-   readPacket( oldestEntry, packetLogicalOffset );
+   if ( statistics_ != nullptr )
+   {
+      ++statistics_->cacheMisses;
+
+      /// Entries that never held a packet still have offset 0
+      if ( entries_[oldestEntry].logicalOffset_ != 0 )
+      {
+         ++statistics_->cacheEvictions;
+      }
+   }
+
+   {
+      ScopedTimer<uint64_t> timer( statistics_ != nullptr ? &statistics_->ioNanoseconds : nullptr );
+
+      readPacket( oldestEntry, packetLogicalOffset );
+   }
 
    /// Publish buffer address to caller
    pkt = entries_[oldestEntry].buffer_;
@@ -161,6 +183,11 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
    return plock;
 }
 
+void PacketReadCache::setStatistics( CompressedVectorReaderStatistics *statistics )
+{
+   statistics_ = statistics;
+}
+
 void PacketReadCache::unlock( unsigned cacheIndex )
 {
    //??? why lockedEntry not used?
@@ -178,21 +205,33 @@ void PacketReadCache::unlock( unsigned cacheIndex )
 
 void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset )
 {
+   E57_TRACE_SPAN_ARG( "readPacket", "offset", packetLogicalOffset );
+
 #ifdef E57_MAX_VERBOSE
    std::cout << "PacketReadCache::readPacket() called, oldestEntry=" << oldestEntry
              << " packetLogicalOffset=" << packetLogicalOffset << std::endl;
 #endif
 
-   /// Read header of packet first to get length.  Use EmptyPacketHeader since
-   /// it has the fields common to all packets.
-   EmptyPacketHeader header;
+   auto &entry = entries_.at( oldestEntry );
+
+   /// Read the rest of the first logical page to get the header.  Its page is read and checksummed whole anyway, and
+   /// it usually holds the data packet's bytestreamBufferLength table and the start of its first buffer too.
+   const uint64_t pageRemaining = CheckedFile::logicalPageSize - packetLogicalOffset % CheckedFile::logicalPageSize;
+   const uint64_t fileRemaining = cFile_->length( CheckedFile::Logical ) - packetLogicalOffset;
+   const auto headLength = static_cast<unsigned>( std::min( pageRemaining, fileRemaining ) );
 
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+   if ( headLength < sizeof( EmptyPacketHeader ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLogicalOffset=" + toString( packetLogicalOffset ) );
+   }
+
+   cFile_->readAt( packetLogicalOffset, entry.buffer_, headLength );
 
-   /// Can't verify packet header here, because it is not really an
-   /// EmptyPacketHeader.
-   unsigned packetLength = header.packetLogicalLengthMinus1 + 1;
+   /// Use EmptyPacketHeader since it has the fields common to all packets.  Can't verify packet header here, because
+   /// it is not really an EmptyPacketHeader.
+   const auto header = reinterpret_cast<const EmptyPacketHeader *>( entry.buffer_ );
+   const uint8_t packetType = header->packetType;
+   unsigned packetLength = header->packetLogicalLengthMinus1 + 1;
 
    /// Be paranoid about packetLength before read
    if ( packetLength > DATA_PACKET_MAX )
@@ -200,14 +239,26 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString( packetLength ) );
    }
 
-   auto &entry = entries_.at( oldestEntry );
+   const unsigned filledEnd = std::min( headLength, packetLength );
+
+   /// Reader only consumes some bytestreams, so only fetch (and checksum) the pages it needs.
+   if ( packetType == DATA_PACKET && !neededBytestreams_.empty() )
+   {
+      readDataPacketPruned( entry.buffer_, packetLogicalOffset, packetLength, filledEnd );
 
-   /// Now read in whole packet into preallocated buffer_.  Note buffer is
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( entry.buffer_, packetLength );
+      entry.logicalOffset_ = packetLogicalOffset;
+      entry.lastUsed_ = ++useCount_;
+      return;
+   }
+
+   /// Now read in the rest of the packet into preallocated buffer_.
+   if ( packetLength > filledEnd )
+   {
+      cFile_->readAt( packetLogicalOffset + filledEnd, entry.buffer_ + filledEnd, packetLength - filledEnd );
+   }
 
    /// Verify that packet is good.
-   switch ( header.packetType )
+   switch ( packetType )
    {
       case DATA_PACKET:
       {
@@ -243,7 +294,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       }
       break;
       default:
-         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetType=" + toString( header.packetType ) );
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetType=" + toString( packetType ) );
    }
 
    entry.logicalOffset_ = packetLogicalOffset;
@@ -253,6 +304,139 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
    entry.lastUsed_ = ++useCount_;
 }
 
+void PacketReadCache::readDataPacketPruned( char *buffer, uint64_t packetLogicalOffset, unsigned packetLength,
+                                            unsigned filledEnd )
+{
+#ifdef E57_MAX_VERBOSE
+   std::cout << "PacketReadCache::readDataPacketPruned() called, packetLogicalOffset=" << packetLogicalOffset
+             << std::endl;
+#endif
+
+   auto dpkt = reinterpret_cast<DataPacket *>( buffer );
+
+   /// The first filledEnd bytes are already read.  Complete the fixed part of the header, then the
+   /// bytestreamBufferLength table whose size it gives, if they spill over the first page.
+   if ( filledEnd < sizeof( DataPacketHeader ) )
+   {
+      cFile_->readAt( packetLogicalOffset + filledEnd, buffer + filledEnd, sizeof( DataPacketHeader ) - filledEnd );
+      filledEnd = sizeof( DataPacketHeader );
+   }
+
+   dpkt->header.verify( packetLength );
+
+   const unsigned bytestreamCount = dpkt->header.bytestreamCount;
+   const unsigned tableEnd = sizeof( DataPacketHeader ) + 2 * bytestreamCount;
+
+   if ( filledEnd < tableEnd )
+   {
+      cFile_->readAt( packetLogicalOffset + filledEnd, buffer + filledEnd, tableEnd - filledEnd );
+      filledEnd = tableEnd;
+   }
+
+   /// If every bytestream in packet is needed, nothing to prune, so finish reading the packet normally.
+   unsigned neededCount = 0;
+   for ( unsigned i = 0; i < bytestreamCount && i < neededBytestreams_.size(); i++ )
+   {
+      if ( neededBytestreams_[i] )
+      {
+         ++neededCount;
+      }
+   }
+
+   if ( neededCount == bytestreamCount )
+   {
+      if ( packetLength > filledEnd )
+      {
+         cFile_->readAt( packetLogicalOffset + filledEnd, buffer + filledEnd, packetLength - filledEnd );
+      }
+      dpkt->verify( packetLength );
+      return;
+   }
+
+   /// Check the buffer lengths add up to the packet length.  The padding isn't read, so can't check it.
+   dpkt->verify( packetLength, false );
+
+   /// Read a range, less what is already in the buffer
+   auto readRange = [&]( unsigned rangeStart, unsigned rangeEnd ) {
+      rangeStart = std::max( rangeStart, filledEnd );
+
+      if ( rangeEnd <= rangeStart )
+      {
+         return;
+      }
+
+      /// Zero the skipped bytes so unneeded buffers don't hold a stale packet's data
+      memset( buffer + filledEnd, 0, rangeStart - filledEnd );
+
+      cFile_->readAt( packetLogicalOffset + rangeStart, buffer + rangeStart, rangeEnd - rangeStart );
+      filledEnd = rangeEnd;
+   };
+
+   /// Walk the bytestream buffers in packet order, coalescing the needed ones into ranges.  A gap shorter than a
+   /// logical page is read rather than skipped, since skipping it would read (and checksum) its boundary pages twice.
+   /// The first range starts with what is already read, so the first page isn't read again.
+   auto bsbLength = reinterpret_cast<const uint16_t *>( &dpkt->payload[0] );
+   unsigned rangeStart = 0;
+   unsigned rangeEnd = filledEnd;
+   unsigned offset = tableEnd;
+
+   for ( unsigned i = 0; i < bytestreamCount; i++ )
+   {
+      const unsigned length = bsbLength[i];
+
+      if ( length > 0 && i < neededBytestreams_.size() && neededBytestreams_[i] )
+      {
+         if ( offset <= rangeEnd || offset - rangeEnd < CheckedFile::logicalPageSize )
+         {
+            rangeEnd = std::max( rangeEnd, offset + length );
+         }
+         else
+         {
+            readRange( rangeStart, rangeEnd );
+
+            rangeStart = offset;
+            rangeEnd = offset + length;
+         }
+      }
+
+      offset += length;
+   }
+
+   readRange( rangeStart, rangeEnd );
+
+   if ( packetLength > filledEnd )
+   {
+      memset( buffer + filledEnd, 0, packetLength - filledEnd );
+   }
+}
+
+void PacketReadCache::setNeededBytestreams( const std::vector<unsigned> &bytestreamNumbers )
+{
+   if ( lockCount_ > 0 )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "lockCount=" + toString( lockCount_ ) );
+   }
+
+   neededBytestreams_.clear();
+
+   for ( unsigned bytestreamNumber : bytestreamNumbers )
+   {
+      if ( bytestreamNumber >= neededBytestreams_.size() )
+      {
+         neededBytestreams_.resize( bytestreamNumber + 1, false );
+      }
+
+      neededBytestreams_[bytestreamNumber] = true;
+   }
+
+   /// Cached packets may be missing buffers that are now needed, so forget them.
+   for ( auto &entry : entries_ )
+   {
+      entry.logicalOffset_ = 0;
+      entry.lastUsed_ = 0;
+   }
+}
+
 #ifdef E57_DEBUG
 void PacketReadCache::dump( int indent, std::ostream &os )
 {
@@ -406,7 +590,7 @@ DataPacket::DataPacket()
    static_assert( sizeof( DataPacket ) == 64 * 1024, "Unexpected size of DataPacket" );
 }
 
-void DataPacket::verify( unsigned bufferLength ) const
+void DataPacket::verify( unsigned bufferLength, bool checkPadding ) const
 {
    //??? do all packets need versions?  how extend without breaking older
    // checking?  need to check
@@ -440,7 +624,12 @@ void DataPacket::verify( unsigned bufferLength ) const
                             "needed=" + toString( needed ) + "packetLength=" + toString( packetLength ) );
    }
 
-   /// Verify that padding at end of packet is zero
+   /// Verify that padding at end of packet is zero (skipped if the padding wasn't read)
+   if ( !checkPadding )
+   {
+      return;
+   }
+
    for ( unsigned i = needed; i < packetLength; i++ )
    {
       if ( reinterpret_cast<const char *>( this )[i] != 0 )
@@ -56,6 +56,13 @@ namespace e57
       std::unique_ptr<PacketLock> lock( uint64_t packetLogicalOffset,
                                         char *&pkt ); //??? pkt could be const
 
+      /// Restrict data packet reads to the given bytestreams. Empty list means read whole packets.
+      void setNeededBytestreams( const std::vector<unsigned> &bytestreamNumbers );
+
+      /// Count hits, misses, evictions and the time spent reading packets into the reader's statistics.  nullptr
+      /// stops counting.
+      void setStatistics( CompressedVectorReaderStatistics *statistics );
+
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout );
 #endif
@@ -66,9 +73,16 @@ namespace e57
       void unlock( unsigned cacheIndex );
 
       void readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset );
+      void readDataPacketPruned( char *buffer, uint64_t packetLogicalOffset, unsigned packetLength,
+                                 unsigned filledEnd );
 
       struct CacheEntry
       {
+         /// User-provided, so value-initializing the entries doesn't zero the buffers
+         CacheEntry()
+         {
+         }
+
          uint64_t logicalOffset_ = 0;
          char buffer_[DATA_PACKET_MAX]; //! No need to init since it's a data buffer
          unsigned lastUsed_ = 0;
@@ -78,7 +92,12 @@ namespace e57
       unsigned useCount_ = 0;
       CheckedFile *cFile_ = nullptr;
 
+      /// If not empty, neededBytestreams_[i] is true when some reader channel consumes bytestream i
+      std::vector<bool> neededBytestreams_;
+
       std::vector<CacheEntry> entries_;
+
+      CompressedVectorReaderStatistics *statistics_ = nullptr;
    };
 
    class PacketLock
@@ -124,7 +143,7 @@ namespace e57
    public:
       DataPacket();
 
-      void verify( unsigned bufferLength = 0 ) const;
+      void verify( unsigned bufferLength = 0, bool checkPadding = true ) const;
       char *getBytestream( unsigned bytestreamNumber, unsigned &byteCount );
       unsigned getBytestreamBufferLength( unsigned bytestreamNumber );
 
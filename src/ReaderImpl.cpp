@@ -25,6 +25,14 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+#include "Common.h"
+#include "Execution.h"
 #include "ReaderImpl.h"
 
 namespace e57
@@ -36,6 +44,12 @@ namespace e57
    {
    }
 
+   ReaderImpl::ReaderImpl( const ustring &filePath, const ExecutionContext &context ) :
+      imf_( filePath, "r", context ), root_( imf_.root() ), data3D_( root_.get( "/data3D" ) ),
+      images2D_( root_.isDefined( "/images2D" ) ? root_.get( "/images2D" ) : VectorNode( imf_ ) )
+   {
+   }
+
    ReaderImpl::~ReaderImpl()
    {
       if ( IsOpen() )
@@ -1291,9 +1305,101 @@ namespace e57
       return true;
    }
 
+   namespace
+   {
+      /// A scan with only spherical coordinates is converted when cartesian buffers are given instead of spherical
+      /// ones. The spherical fields are read into the cartesian buffers, and converted in place.
+      template <typename COORDTYPE>
+      bool convertsSpherical( const StructureNode &proto, const Data3DPointsData_t<COORDTYPE> &buffers )
+      {
+         return !proto.isDefined( "cartesianX" ) && proto.isDefined( "sphericalRange" ) &&
+                proto.isDefined( "sphericalAzimuth" ) && proto.isDefined( "sphericalElevation" ) &&
+                ( buffers.cartesianX != nullptr ) && ( buffers.cartesianY != nullptr ) &&
+                ( buffers.cartesianZ != nullptr ) && ( buffers.sphericalRange == nullptr ) &&
+                ( buffers.sphericalAzimuth == nullptr ) && ( buffers.sphericalElevation == nullptr );
+      }
+
+      /// The invalid state is only converted if it has a buffer
+      ReadSphericalConversion sphericalConversion( const std::vector<SourceDestBuffer> &destBuffers )
+      {
+         ReadSphericalConversion conversion;
+
+         const bool haveInvalidState =
+            std::any_of( destBuffers.begin(), destBuffers.end(),
+                         []( const SourceDestBuffer &dbuf ) { return dbuf.pathName() == "sphericalInvalidState"; } );
+
+         if ( !haveInvalidState )
+         {
+            conversion.invalidStatePathName.clear();
+         }
+
+         return conversion;
+      }
+
+      /// Place a field's buffer at offset in base, if the field is wanted.  With a null base, only advance offset,
+      /// so the same calls can size the storage first.
+      template <typename T>
+      void placeBuffer( T *&buffer, bool wanted, size_t pointCount, char *base, size_t &offset )
+      {
+         if ( !wanted )
+         {
+            return;
+         }
+
+         if ( base != nullptr )
+         {
+            buffer = reinterpret_cast<T *>( base + offset );
+         }
+
+         // Keep every buffer aligned for double
+         offset += ( pointCount * sizeof( T ) + sizeof( double ) - 1 ) / sizeof( double ) * sizeof( double );
+      }
+   }
+
    template <typename COORDTYPE>
-   CompressedVectorReader ReaderImpl::SetUpData3DPointsData( int64_t dataIndex, size_t count,
-                                                             const Data3DPointsData_t<COORDTYPE> &buffers ) const
+   size_t ReaderImpl::PlaceData3DPointsBuffers( Data3DPointsData_t<COORDTYPE> &buffers,
+                                                const PointStandardizedFieldsAvailable &fields, size_t pointCount,
+                                                char *base )
+   {
+      size_t offset = 0;
+
+      placeBuffer( buffers.cartesianX, fields.cartesianXField, pointCount, base, offset );
+      placeBuffer( buffers.cartesianY, fields.cartesianYField, pointCount, base, offset );
+      placeBuffer( buffers.cartesianZ, fields.cartesianZField, pointCount, base, offset );
+      placeBuffer( buffers.cartesianInvalidState, fields.cartesianInvalidStateField, pointCount, base, offset );
+
+      placeBuffer( buffers.intensity, fields.intensityField, pointCount, base, offset );
+      placeBuffer( buffers.isIntensityInvalid, fields.isIntensityInvalidField, pointCount, base, offset );
+
+      placeBuffer( buffers.colorRed, fields.colorRedField, pointCount, base, offset );
+      placeBuffer( buffers.colorGreen, fields.colorGreenField, pointCount, base, offset );
+      placeBuffer( buffers.colorBlue, fields.colorBlueField, pointCount, base, offset );
+      placeBuffer( buffers.isColorInvalid, fields.isColorInvalidField, pointCount, base, offset );
+
+      placeBuffer( buffers.sphericalRange, fields.sphericalRangeField, pointCount, base, offset );
+      placeBuffer( buffers.sphericalAzimuth, fields.sphericalAzimuthField, pointCount, base, offset );
+      placeBuffer( buffers.sphericalElevation, fields.sphericalElevationField, pointCount, base, offset );
+      placeBuffer( buffers.sphericalInvalidState, fields.sphericalInvalidStateField, pointCount, base, offset );
+
+      placeBuffer( buffers.rowIndex, fields.rowIndexField, pointCount, base, offset );
+      placeBuffer( buffers.columnIndex, fields.columnIndexField, pointCount, base, offset );
+      placeBuffer( buffers.returnIndex, fields.returnIndexField, pointCount, base, offset );
+      placeBuffer( buffers.returnCount, fields.returnCountField, pointCount, base, offset );
+
+      placeBuffer( buffers.timeStamp, fields.timeStampField, pointCount, base, offset );
+      placeBuffer( buffers.isTimeStampInvalid, fields.isTimeStampInvalidField, pointCount, base, offset );
+
+      placeBuffer( buffers.normalX, fields.normalX, pointCount, base, offset );
+      placeBuffer( buffers.normalY, fields.normalY, pointCount, base, offset );
+      placeBuffer( buffers.normalZ, fields.normalZ, pointCount, base, offset );
+
+      return offset;
+   }
+
+   template <typename COORDTYPE>
+   std::vector<SourceDestBuffer>
+      ReaderImpl::SetUpData3DPointsBuffers( int64_t dataIndex, size_t count,
+                                            const Data3DPointsData_t<COORDTYPE> &buffers ) const
    {
       StructureNode scan( data3D_.get( dataIndex ) );
       CompressedVectorNode points( scan.get( "points" ) );
@@ -1302,6 +1408,8 @@ namespace e57
       int64_t protoCount = proto.childCount();
       int64_t protoIndex;
 
+      const bool convertSpherical = convertsSpherical( proto, buffers );
+
       std::vector<SourceDestBuffer> destBuffers;
 
       for ( protoIndex = 0; protoIndex < protoCount; protoIndex++ )
@@ -1350,6 +1458,24 @@ namespace e57
          {
             destBuffers.emplace_back( imf_, "sphericalInvalidState", buffers.sphericalInvalidState, count, true );
          }
+         else if ( convertSpherical && ( name == "sphericalRange" ) )
+         {
+            destBuffers.emplace_back( imf_, "sphericalRange", buffers.cartesianX, count, true, scaled );
+         }
+         else if ( convertSpherical && ( name == "sphericalAzimuth" ) )
+         {
+            destBuffers.emplace_back( imf_, "sphericalAzimuth", buffers.cartesianY, count, true, scaled );
+         }
+         else if ( convertSpherical && ( name == "sphericalElevation" ) )
+         {
+            destBuffers.emplace_back( imf_, "sphericalElevation", buffers.cartesianZ, count, true, scaled );
+         }
+         else if ( convertSpherical && ( name == "sphericalInvalidState" ) &&
+                   ( buffers.cartesianInvalidState != nullptr ) )
+         {
+            // The states mean the same for cartesian coordinates
+            destBuffers.emplace_back( imf_, "sphericalInvalidState", buffers.cartesianInvalidState, count, true );
+         }
          else if ( ( name == "rowIndex" ) && proto.isDefined( "rowIndex" ) && ( buffers.rowIndex != nullptr ) )
          {
             destBuffers.emplace_back( imf_, "rowIndex", buffers.rowIndex, count, true );
@@ -1418,16 +1544,816 @@ namespace e57
          }
       }
 
+      return destBuffers;
+   }
+
+   template <typename COORDTYPE>
+   CompressedVectorReader ReaderImpl::SetUpData3DPointsData( int64_t dataIndex, size_t count,
+                                                             const Data3DPointsData_t<COORDTYPE> &buffers,
+                                                             const Data3DPointsFilter &filter ) const
+   {
+      StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      StructureNode proto( points.prototype() );
+
+      const bool convertSpherical = convertsSpherical( proto, buffers );
+
+      std::vector<SourceDestBuffer> destBuffers = SetUpData3DPointsBuffers( dataIndex, count, buffers );
+
       CompressedVectorReader reader = points.reader( destBuffers );
 
+      if ( convertSpherical )
+      {
+         reader.setSphericalConversion( sphericalConversion( destBuffers ) );
+      }
+
+      /// Turn the filter into range conditions on the fields the scan has.  An unbounded range needs no test.
+      std::vector<ReadFilterCondition> conditions;
+
+      auto addRange = [&proto, &conditions]( const char *fieldName, double minimum, double maximum ) {
+         if ( proto.isDefined( fieldName ) && ( minimum > -E57_DOUBLE_MAX || maximum < E57_DOUBLE_MAX ) )
+         {
+            conditions.emplace_back( fieldName, minimum, maximum );
+         }
+      };
+
+      const CartesianBounds &bounds = filter.cartesianBounds;
+
+      // Converted coordinates are in the buffers of the spherical fields
+      addRange( convertSpherical ? "sphericalRange" : "cartesianX", bounds.xMinimum, bounds.xMaximum );
+      addRange( convertSpherical ? "sphericalAzimuth" : "cartesianY", bounds.yMinimum, bounds.yMaximum );
+      addRange( convertSpherical ? "sphericalElevation" : "cartesianZ", bounds.zMinimum, bounds.zMaximum );
+      addRange( "timeStamp", filter.timeMinimum, filter.timeMaximum );
+
+      if ( filter.rejectInvalidCartesian )
+      {
+         addRange( convertSpherical ? "sphericalInvalidState" : "cartesianInvalidState", 0.0, 0.0 );
+      }
+      if ( filter.rejectInvalidIntensity )
+      {
+         addRange( "isIntensityInvalid", 0.0, 0.0 );
+      }
+      if ( filter.rejectInvalidColor )
+      {
+         addRange( "isColorInvalid", 0.0, 0.0 );
+      }
+
+      if ( !conditions.empty() )
+      {
+         reader.setFilter( conditions );
+      }
+
       return reader;
    }
 
+   template <typename COORDTYPE>
+   bool ReaderImpl::ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                      Data3DPointsArrays_t<COORDTYPE> &points ) const
+   {
+      if ( !IsOpen() || ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) )
+      {
+         return false;
+      }
+
+      ReadData3DPointsOn( dataIndex, fields, points, imf_.executionContext() );
+
+      return true;
+   }
+
+   template <typename COORDTYPE>
+   void ReaderImpl::ReadData3DPointsOn( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                        Data3DPointsArrays_t<COORDTYPE> &points,
+                                        const ExecutionContext &context ) const
+   {
+      StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode pointsNode( scan.get( "points" ) );
+      StructureNode proto( pointsNode.prototype() );
+
+      // Size the arrays for the whole scan, so every field is decoded straight into its final place
+      const auto pointCount = static_cast<size_t>( pointsNode.childCount() );
+
+      points.pointCount = pointsNode.childCount();
+      points.buffers = Data3DPointsData_t<COORDTYPE>();
+
+      const size_t size = PlaceData3DPointsBuffers( points.buffers, fields, pointCount, nullptr );
+
+      points.storage.reset( new double[size / sizeof( double )] );
+      PlaceData3DPointsBuffers( points.buffers, fields, pointCount, reinterpret_cast<char *>( points.storage.get() ) );
+
+      if ( pointCount == 0 )
+      {
+         return;
+      }
+
+      std::vector<SourceDestBuffer> destBuffers = SetUpData3DPointsBuffers( dataIndex, pointCount, points.buffers );
+
+      if ( destBuffers.empty() )
+      {
+         return;
+      }
+
+      // Each field has its own bytestream, so each gets its own reader that can run on its own thread. Spherical
+      // coordinates being converted must be decoded together, and go first since they are the most work.
+      const bool convertSpherical = convertsSpherical( proto, points.buffers );
+
+      std::vector<std::vector<SourceDestBuffer>> groups( 1 );
+
+      for ( const auto &dbuf : destBuffers )
+      {
+         if ( convertSpherical && ( dbuf.pathName().compare( 0, 9, "spherical" ) == 0 ) )
+         {
+            groups[0].push_back( dbuf );
+         }
+         else
+         {
+            groups.emplace_back( 1, dbuf );
+         }
+      }
+
+      if ( groups[0].empty() )
+      {
+         groups.erase( groups.begin() );
+      }
+
+      // Readers are created on this thread, and each is read and closed by the worker that takes it
+      std::vector<CompressedVectorReader> readers;
+      readers.reserve( groups.size() );
+
+      for ( auto &group : groups )
+      {
+         readers.push_back( pointsNode.reader( group ) );
+      }
+
+      if ( convertSpherical )
+      {
+         readers[0].setSphericalConversion( sphericalConversion( groups[0] ) );
+      }
+
+      std::atomic<size_t> nextReader( 0 );
+
+      auto decode = [&readers, &nextReader, pointCount]() {
+         for ( size_t i = nextReader++; i < readers.size(); i = nextReader++ )
+         {
+            // The buffers hold the whole scan, so one read gets all of it. Fewer records means the binary section
+            // is short, and the rest of the arrays would be left uninitialized.
+            const size_t readCount = readers[i].read();
+
+            readers[i].close();
+
+            if ( readCount != pointCount )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
+                                     "pointCount=" + toString( pointCount ) + " readCount=" + toString( readCount ) );
+            }
+         }
+      };
+
+      std::exception_ptr error;
+
+      try
+      {
+         runWorkers( context, std::min( readers.size(), threadCount( context ) ), decode );
+      }
+      catch ( ... )
+      {
+         error = std::current_exception();
+      }
+
+      // Readers a failed worker didn't get to
+      for ( auto &reader : readers )
+      {
+         if ( reader.isOpen() )
+         {
+            reader.close();
+         }
+      }
+
+      if ( error )
+      {
+         std::rethrow_exception( error );
+      }
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                        const Data3DPointsCallback_t<COORDTYPE> &callback ) const
+   {
+      if ( !IsOpen() )
+      {
+         return false;
+      }
+
+      struct Job
+      {
+         int64_t dataIndex;
+         PointStandardizedFieldsAvailable fields;
+         uint64_t size; //!< bytes of point buffers
+      };
+
+      std::vector<int64_t> dataIndices = options.dataIndices;
+
+      if ( dataIndices.empty() )
+      {
+         for ( int64_t i = 0; i < data3D_.childCount(); ++i )
+         {
+            dataIndices.push_back( i );
+         }
+      }
+
+      // Size every scan up front, on this thread, so they can be scheduled
+      std::vector<Job> jobs;
+      jobs.reserve( dataIndices.size() );
+
+      for ( int64_t dataIndex : dataIndices )
+      {
+         Data3D header;
+         if ( !ReadData3D( dataIndex, header ) )
+         {
+            return false;
+         }
+
+         Data3DPointsData_t<COORDTYPE> buffers;
+         const auto pointCount = static_cast<size_t>( header.pointsSize );
+
+         jobs.push_back( { dataIndex, header.pointFields,
+                           PlaceData3DPointsBuffers( buffers, header.pointFields, pointCount, nullptr ) } );
+      }
+
+      if ( jobs.empty() )
+      {
+         return true;
+      }
+
+      // Largest scans first, so a large one started last doesn't keep one thread busy long after the others
+      std::stable_sort( jobs.begin(), jobs.end(), []( const Job &a, const Job &b ) { return a.size > b.size; } );
+
+      // Options left at 0 come from the file's context
+      const ExecutionContext context = imf_.executionContext();
+
+      const size_t totalThreadCount = ( options.threadCount != 0 ) ? options.threadCount : threadCount( context );
+      const uint64_t budget = ( options.memoryBudget != 0 ) ? options.memoryBudget : context.memoryBudget;
+
+      // With fewer scans than threads, the spare threads decode fields of the scans
+      const size_t scanThreadCount = std::min( totalThreadCount, jobs.size() );
+
+      ExecutionContext scanContext = context;
+      scanContext.threadCount = static_cast<unsigned>( totalThreadCount / scanThreadCount );
+
+      std::mutex mutex; // guards everything below, except the callback
+      std::condition_variable changed;
+      auto next = jobs.begin();
+      uint64_t sizeInUse = 0;
+      size_t running = 0;
+      std::exception_ptr error;
+
+      std::mutex callbackMutex;
+
+      auto work = [&]() {
+         while ( true )
+         {
+            Job job;
+
+            {
+               std::unique_lock<std::mutex> lock( mutex );
+
+               // Take the largest scan that fits in the budget. One that doesn't fit even on its own runs alone.
+               auto fits = [&]( const Job &candidate ) {
+                  return ( budget == 0 ) || ( running == 0 ) || ( sizeInUse + candidate.size <= budget );
+               };
+
+               changed.wait( lock, [&]() {
+                  if ( error || ( next == jobs.end() ) )
+                  {
+                     return true;
+                  }
+
+                  auto found = std::find_if( next, jobs.end(), fits );
+                  if ( found == jobs.end() )
+                  {
+                     return false;
+                  }
+
+                  // Keep the scans left in [next, end) by moving the one taken to the front
+                  std::rotate( next, found, found + 1 );
+                  return true;
+               } );
+
+               if ( error || ( next == jobs.end() ) )
+               {
+                  return;
+               }
+
+               job = *next++;
+               sizeInUse += job.size;
+               ++running;
+            }
+
+            try
+            {
+               Data3DPointsArrays_t<COORDTYPE> points;
+               ReadData3DPointsOn( job.dataIndex, job.fields, points, scanContext );
+
+               std::lock_guard<std::mutex> lock( callbackMutex );
+               callback( job.dataIndex, points );
+            }
+            catch ( ... )
+            {
+               std::lock_guard<std::mutex> lock( mutex );
+               if ( !error )
+               {
+                  error = std::current_exception();
+               }
+            }
+
+            {
+               std::lock_guard<std::mutex> lock( mutex );
+               sizeInUse -= job.size;
+               --running;
+            }
+            changed.notify_all();
+         }
+      };
+
+      runWorkers( context, scanThreadCount, work );
+
+      if ( error )
+      {
+         std::rethrow_exception( error );
+      }
+
+      return true;
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                        std::vector<Data3DPointsArrays_t<COORDTYPE>> &scans ) const
+   {
+      if ( !IsOpen() )
+      {
+         return false;
+      }
+
+      const size_t scanCount =
+         options.dataIndices.empty() ? static_cast<size_t>( data3D_.childCount() ) : options.dataIndices.size();
+
+      // The callback only gets the dataIndex, so map it back to the scan's place
+      std::vector<size_t> places( static_cast<size_t>( std::max<int64_t>( data3D_.childCount(), 0 ) ), scanCount );
+
+      for ( size_t i = 0; i < scanCount; ++i )
+      {
+         const int64_t dataIndex = options.dataIndices.empty() ? static_cast<int64_t>( i ) : options.dataIndices[i];
+
+         if ( ( dataIndex < 0 ) || ( dataIndex >= data3D_.childCount() ) ||
+              ( places[static_cast<size_t>( dataIndex )] != scanCount ) )
+         {
+            return false;
+         }
+
+         places[static_cast<size_t>( dataIndex )] = i;
+      }
+
+      std::vector<Data3DPointsArrays_t<COORDTYPE>> result( scanCount );
+
+      const bool read = ImportData3DPoints<COORDTYPE>(
+         options, [&result, &places]( int64_t dataIndex, Data3DPointsArrays_t<COORDTYPE> &points ) {
+            result[places[static_cast<size_t>( dataIndex )]] = std::move( points );
+         } );
+
+      if ( !read )
+      {
+         return false;
+      }
+
+      scans = std::move( result );
+
+      return true;
+   }
+
    // Explicit template instantiation
+   template size_t ReaderImpl::PlaceData3DPointsBuffers( Data3DPointsData_t<float> &buffers,
+                                                         const PointStandardizedFieldsAvailable &fields,
+                                                         size_t pointCount, char *base );
+
+   template size_t ReaderImpl::PlaceData3DPointsBuffers( Data3DPointsData_t<double> &buffers,
+                                                         const PointStandardizedFieldsAvailable &fields,
+                                                         size_t pointCount, char *base );
+
+   template bool ReaderImpl::ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                               Data3DPointsArrays_t<float> &points ) const;
+
+   template bool ReaderImpl::ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                                               Data3DPointsArrays_t<double> &points ) const;
+
+   template bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                                 const Data3DPointsCallback_t<float> &callback ) const;
+
+   template bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                                 const Data3DPointsCallback_t<double> &callback ) const;
+
+   template bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                                 std::vector<Data3DPointsArrays_t<float>> &scans ) const;
+
+   template bool ReaderImpl::ImportData3DPoints( const Data3DPointsImportOptions &options,
+                                                 std::vector<Data3DPointsArrays_t<double>> &scans ) const;
+
+   template std::vector<SourceDestBuffer> ReaderImpl::SetUpData3DPointsBuffers(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<float> &buffers ) const;
+
+   template std::vector<SourceDestBuffer> ReaderImpl::SetUpData3DPointsBuffers(
+      int64_t dataIndex, size_t pointCount, const Data3DPointsData_t<double> &buffers ) const;
+
    template CompressedVectorReader ReaderImpl::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
-                                                                      const Data3DPointsData_t<float> &buffers ) const;
+                                                                      const Data3DPointsData_t<float> &buffers,
+                                                                      const Data3DPointsFilter &filter ) const;
 
    template CompressedVectorReader ReaderImpl::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
-                                                                      const Data3DPointsData_t<double> &buffers ) const;
+                                                                      const Data3DPointsData_t<double> &buffers,
+                                                                      const Data3DPointsFilter &filter ) const;
+
+   CompressedVectorReader ReaderImpl::SetUpData3DPointsData( int64_t dataIndex, size_t count,
+                                                             const Data3DPointsLayout &layout ) const
+   {
+      StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      StructureNode proto( points.prototype() );
+
+      std::vector<SourceDestBuffer> destBuffers;
+
+      for ( const auto &field : layout.fields )
+      {
+         // Fields from an extension can only be in the prototype if the extension is declared
+         const size_t colon = field.name.find( ':' );
+         ustring extUri;
+
+         if ( ( colon != ustring::npos ) && !imf_.extensionsLookupPrefix( field.name.substr( 0, colon ), extUri ) )
+         {
+            continue;
+         }
+
+         if ( proto.isDefined( field.name ) )
+         {
+            const bool scaled = ( proto.get( field.name ).type() == E57_SCALED_INTEGER );
+
+            destBuffers.push_back( layout.sourceDestBuffer( imf_, field, count, scaled ) );
+         }
+      }
+
+      return points.reader( destBuffers );
+   }
+
+   namespace
+   {
+      /// Fill row major rotation matrix for a quaternion.  A zero quaternion is taken as no rotation, which is what
+      /// an undefined pose rotation means.
+      void quaternionToMatrix( const Quaternion &q, double m[3][3] )
+      {
+         const double norm = q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+         const double s = ( norm > 0. ) ? 2. / norm : 0.;
+
+         m[0][0] = 1. - s * ( q.y * q.y + q.z * q.z );
+         m[0][1] = s * ( q.x * q.y - q.w * q.z );
+         m[0][2] = s * ( q.x * q.z + q.w * q.y );
+         m[1][0] = s * ( q.x * q.y + q.w * q.z );
+         m[1][1] = 1. - s * ( q.x * q.x + q.z * q.z );
+         m[1][2] = s * ( q.y * q.z - q.w * q.x );
+         m[2][0] = s * ( q.x * q.z - q.w * q.y );
+         m[2][1] = s * ( q.y * q.z + q.w * q.x );
+         m[2][2] = 1. - s * ( q.x * q.x + q.y * q.y );
+      }
+   }
+
+   bool ReaderImpl::SetUpData3DPointsPose( int64_t dataIndex, CompressedVectorReader &reader,
+                                           const RigidBodyTransform &extraTransform ) const
+   {
+      Data3D data3DHeader;
+
+      if ( !ReadData3D( dataIndex, data3DHeader ) )
+      {
+         return false;
+      }
+
+      const PointStandardizedFieldsAvailable &fields = data3DHeader.pointFields;
+      ReadTransform transform;
+
+      if ( !fields.cartesianXField || !fields.cartesianYField || !fields.cartesianZField )
+      {
+         if ( !fields.sphericalRangeField || !fields.sphericalAzimuthField || !fields.sphericalElevationField )
+         {
+            return false;
+         }
+
+         // The reader converts spherical coordinates, so the cartesian ones are in the spherical fields' buffers
+         transform.xPathName = "sphericalRange";
+         transform.yPathName = "sphericalAzimuth";
+         transform.zPathName = "sphericalElevation";
+      }
+
+      // Compose extra * pose into a single rotation and translation
+      double poseRotation[3][3];
+      double extraRotation[3][3];
+
+      quaternionToMatrix( data3DHeader.pose.rotation, poseRotation );
+      quaternionToMatrix( extraTransform.rotation, extraRotation );
+
+      const double poseTranslation[3] = { data3DHeader.pose.translation.x, data3DHeader.pose.translation.y,
+                                          data3DHeader.pose.translation.z };
+      const double extraTranslation[3] = { extraTransform.translation.x, extraTransform.translation.y,
+                                           extraTransform.translation.z };
+
+      for ( int row = 0; row < 3; ++row )
+      {
+         for ( int col = 0; col < 3; ++col )
+         {
+            transform.rotation[row][col] = extraRotation[row][0] * poseRotation[0][col] +
+                                           extraRotation[row][1] * poseRotation[1][col] +
+                                           extraRotation[row][2] * poseRotation[2][col];
+         }
+
+         transform.translation[row] = extraRotation[row][0] * poseTranslation[0] +
+                                      extraRotation[row][1] * poseTranslation[1] +
+                                      extraRotation[row][2] * poseTranslation[2] + extraTranslation[row];
+      }
+
+      reader.setTransform( transform );
+
+      return true;
+   }
+
+   namespace
+   {
+      /// One field of a raster read.  Points are decoded into the staging buffer a block at a time, then moved to
+      /// their cells.
+      class RasterFieldBase
+      {
+      public:
+         virtual ~RasterFieldBase() = default;
+
+         /// Move staged values to cells, as (cell, staging index) pairs
+         virtual void scatter( const std::vector<std::pair<size_t, size_t>> &moves ) = 0;
+      };
+
+      template <typename T> class RasterField : public RasterFieldBase
+      {
+      public:
+         RasterField( T *cells, size_t cellCount, T empty, size_t blockSize ) : cells_( cells ), staging_( blockSize )
+         {
+            std::fill_n( cells_, cellCount, empty );
+         }
+
+         T *staging()
+         {
+            return staging_.data();
+         }
+
+         void scatter( const std::vector<std::pair<size_t, size_t>> &moves ) override
+         {
+            for ( const auto &move : moves )
+            {
+               cells_[move.first] = staging_[move.second];
+            }
+         }
+
+      private:
+         T *cells_;
+         std::vector<T> staging_;
+      };
+
+      using RasterFields = std::vector<std::unique_ptr<RasterFieldBase>>;
+
+      /// Add a field if the user gave a raster for it, and point the staging buffers at its staging buffer
+      template <typename T>
+      void addRasterField( RasterFields &fields, T *cells, T *&staged, size_t cellCount, T empty, size_t blockSize )
+      {
+         if ( cells == nullptr )
+         {
+            return;
+         }
+
+         auto field = new RasterField<T>( cells, cellCount, empty, blockSize );
+
+         staged = field->staging();
+         fields.emplace_back( field );
+      }
+   }
+
+   template <typename COORDTYPE>
+   bool ReaderImpl::ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_t<COORDTYPE> &rasters,
+                                            const Data3DPointsRasterWindow &window ) const
+   {
+      int64_t rows = 0;
+      int64_t columns = 0;
+      int64_t pointsSize = 0;
+      int64_t groupsSize = 0;
+      int64_t countSize = 0;
+      bool columnIndex = false;
+
+      if ( !GetData3DSizes( dataIndex, rows, columns, pointsSize, groupsSize, countSize, columnIndex ) )
+      {
+         return false;
+      }
+
+      StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      StructureNode proto( points.prototype() );
+
+      if ( !proto.isDefined( "rowIndex" ) || !proto.isDefined( "columnIndex" ) )
+      {
+         return false;
+      }
+
+      // Cells are placed by their absolute indices, so bounds not given come from the scan's indexBounds. Without
+      // them, the rows and columns counted by GetData3DSizes() start at 0.
+      int64_t scanRowMinimum = 0;
+      int64_t scanRowMaximum = rows - 1;
+      int64_t scanColumnMinimum = 0;
+      int64_t scanColumnMaximum = columns - 1;
+
+      if ( scan.isDefined( "indexBounds" ) )
+      {
+         StructureNode indexBounds( scan.get( "indexBounds" ) );
+
+         if ( indexBounds.isDefined( "rowMinimum" ) && indexBounds.isDefined( "rowMaximum" ) )
+         {
+            scanRowMinimum = IntegerNode( indexBounds.get( "rowMinimum" ) ).value();
+            scanRowMaximum = IntegerNode( indexBounds.get( "rowMaximum" ) ).value();
+         }
+         if ( indexBounds.isDefined( "columnMinimum" ) && indexBounds.isDefined( "columnMaximum" ) )
+         {
+            scanColumnMinimum = IntegerNode( indexBounds.get( "columnMinimum" ) ).value();
+            scanColumnMaximum = IntegerNode( indexBounds.get( "columnMaximum" ) ).value();
+         }
+      }
+
+      const int64_t rowMinimum = ( window.rowMinimum < 0 ) ? scanRowMinimum : window.rowMinimum;
+      const int64_t rowMaximum = ( window.rowMaximum < 0 ) ? scanRowMaximum : window.rowMaximum;
+      const int64_t columnMinimum = ( window.columnMinimum < 0 ) ? scanColumnMinimum : window.columnMinimum;
+      const int64_t columnMaximum = ( window.columnMaximum < 0 ) ? scanColumnMaximum : window.columnMaximum;
+
+      if ( ( rowMaximum < rowMinimum ) || ( columnMaximum < columnMinimum ) )
+      {
+         return false;
+      }
+
+      const int64_t windowColumns = columnMaximum - columnMinimum + 1;
+      const size_t cellCount = static_cast<size_t>( ( rowMaximum - rowMinimum + 1 ) * windowColumns );
+      const size_t blockSize = static_cast<size_t>( std::max<int64_t>( std::min<int64_t>( pointsSize, 65536 ), 1 ) );
+
+      // Fill every raster with its "no point" value, and set up staging buffers for the fields wanted
+      const COORDTYPE coordEmpty = static_cast<COORDTYPE>( window.sentinel );
+      const float floatEmpty = static_cast<float>( window.sentinel );
+
+      RasterFields fields;
+      Data3DPointsData_t<COORDTYPE> staged;
+
+      addRasterField( fields, rasters.cartesianX, staged.cartesianX, cellCount, coordEmpty, blockSize );
+      addRasterField( fields, rasters.cartesianY, staged.cartesianY, cellCount, coordEmpty, blockSize );
+      addRasterField( fields, rasters.cartesianZ, staged.cartesianZ, cellCount, coordEmpty, blockSize );
+      addRasterField( fields, rasters.cartesianInvalidState, staged.cartesianInvalidState, cellCount, int8_t( 2 ),
+                      blockSize );
+
+      addRasterField( fields, rasters.intensity, staged.intensity, cellCount, floatEmpty, blockSize );
+      addRasterField( fields, rasters.isIntensityInvalid, staged.isIntensityInvalid, cellCount, int8_t( 1 ),
+                      blockSize );
+
+      addRasterField( fields, rasters.colorRed, staged.colorRed, cellCount, uint8_t( 0 ), blockSize );
+      addRasterField( fields, rasters.colorGreen, staged.colorGreen, cellCount, uint8_t( 0 ), blockSize );
+      addRasterField( fields, rasters.colorBlue, staged.colorBlue, cellCount, uint8_t( 0 ), blockSize );
+      addRasterField( fields, rasters.isColorInvalid, staged.isColorInvalid, cellCount, int8_t( 1 ), blockSize );
+
+      addRasterField( fields, rasters.sphericalRange, staged.sphericalRange, cellCount, coordEmpty, blockSize );
+      addRasterField( fields, rasters.sphericalAzimuth, staged.sphericalAzimuth, cellCount, coordEmpty, blockSize );
+      addRasterField( fields, rasters.sphericalElevation, staged.sphericalElevation, cellCount, coordEmpty,
+                      blockSize );
+      addRasterField( fields, rasters.sphericalInvalidState, staged.sphericalInvalidState, cellCount, int8_t( 2 ),
+                      blockSize );
+
+      addRasterField( fields, rasters.rowIndex, staged.rowIndex, cellCount, int32_t( -1 ), blockSize );
+      addRasterField( fields, rasters.columnIndex, staged.columnIndex, cellCount, int32_t( -1 ), blockSize );
+      addRasterField( fields, rasters.returnIndex, staged.returnIndex, cellCount, int8_t( 0 ), blockSize );
+      addRasterField( fields, rasters.returnCount, staged.returnCount, cellCount, int8_t( 0 ), blockSize );
+
+      addRasterField( fields, rasters.timeStamp, staged.timeStamp, cellCount, window.sentinel, blockSize );
+      addRasterField( fields, rasters.isTimeStampInvalid, staged.isTimeStampInvalid, cellCount, int8_t( 1 ),
+                      blockSize );
+
+      addRasterField( fields, rasters.normalX, staged.normalX, cellCount, floatEmpty, blockSize );
+      addRasterField( fields, rasters.normalY, staged.normalY, cellCount, floatEmpty, blockSize );
+      addRasterField( fields, rasters.normalZ, staged.normalZ, cellCount, floatEmpty, blockSize );
+
+      // The indices are needed to find each point's cell, even if the user doesn't want them
+      std::vector<int32_t> rowStaging;
+      std::vector<int32_t> columnStaging;
+      std::vector<int8_t> returnStaging;
+
+      if ( staged.rowIndex == nullptr )
+      {
+         rowStaging.resize( blockSize );
+         staged.rowIndex = rowStaging.data();
+      }
+      if ( staged.columnIndex == nullptr )
+      {
+         columnStaging.resize( blockSize );
+         staged.columnIndex = columnStaging.data();
+      }
+      if ( ( staged.returnIndex == nullptr ) && proto.isDefined( "returnIndex" ) )
+      {
+         returnStaging.resize( blockSize );
+         staged.returnIndex = returnStaging.data();
+      }
+
+      // With line groups, only decode the lines that cross the window
+      std::vector<RecordRange> ranges;
+      bool selectLines = false;
+
+      if ( ( groupsSize > 0 ) && scan.isDefined( "pointGroupingSchemes/groupingByLine/groups" ) )
+      {
+         CompressedVectorNode groups( scan.get( "pointGroupingSchemes/groupingByLine/groups" ) );
+         StructureNode lineGroupRecord( groups.prototype() );
+
+         if ( lineGroupRecord.isDefined( "idElementValue" ) && lineGroupRecord.isDefined( "startPointIndex" ) &&
+              lineGroupRecord.isDefined( "pointCount" ) )
+         {
+            std::vector<int64_t> idElementValue( groupsSize );
+            std::vector<int64_t> startPointIndex( groupsSize );
+            std::vector<int64_t> pointCount( groupsSize );
+
+            ReadData3DGroupsData( dataIndex, groupsSize, idElementValue.data(), startPointIndex.data(),
+                                  pointCount.data() );
+
+            const int64_t idMinimum = columnIndex ? columnMinimum : rowMinimum;
+            const int64_t idMaximum = columnIndex ? columnMaximum : rowMaximum;
+
+            for ( int64_t i = 0; i < groupsSize; ++i )
+            {
+               if ( ( idElementValue[i] >= idMinimum ) && ( idElementValue[i] <= idMaximum ) && ( pointCount[i] > 0 ) )
+               {
+                  ranges.emplace_back( startPointIndex[i], pointCount[i] );
+               }
+            }
+
+            selectLines = true;
+         }
+      }
+
+      if ( selectLines && ranges.empty() )
+      {
+         // No line crosses the window, so every cell is empty
+         return true;
+      }
+
+      CompressedVectorReader reader = SetUpData3DPointsData( dataIndex, blockSize, staged );
+
+      if ( selectLines )
+      {
+         reader.setRecordRanges( ranges );
+      }
+
+      std::vector<std::pair<size_t, size_t>> moves;
+      moves.reserve( blockSize );
+
+      while ( const unsigned count = reader.read() )
+      {
+         moves.clear();
+
+         for ( unsigned i = 0; i < count; ++i )
+         {
+            // Only the first return of a point has a cell of its own
+            if ( ( staged.returnIndex != nullptr ) && ( staged.returnIndex[i] != 0 ) )
+            {
+               continue;
+            }
+
+            const int64_t row = staged.rowIndex[i];
+            const int64_t column = staged.columnIndex[i];
+
+            if ( ( row < rowMinimum ) || ( row > rowMaximum ) || ( column < columnMinimum ) ||
+                 ( column > columnMaximum ) )
+            {
+               continue;
+            }
+
+            const size_t cell =
+               static_cast<size_t>( ( row - rowMinimum ) * windowColumns + ( column - columnMinimum ) );
+
+            moves.emplace_back( cell, i );
+         }
+
+         for ( auto &field : fields )
+         {
+            field->scatter( moves );
+         }
+      }
+
+      reader.close();
+
+      return true;
+   }
+
+   // Explicit template instantiation
+   template bool ReaderImpl::ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_t<float> &rasters,
+                                                     const Data3DPointsRasterWindow &window ) const;
+
+   template bool ReaderImpl::ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_t<double> &rasters,
+                                                     const Data3DPointsRasterWindow &window ) const;
 
 } // end namespace e57
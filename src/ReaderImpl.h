@@ -37,6 +37,7 @@ namespace e57
    {
    public:
       ReaderImpl( const ustring &filePath );
+      ReaderImpl( const ustring &filePath, const ExecutionContext &context );
 
       ~ReaderImpl();
 
@@ -68,8 +69,40 @@ namespace e57
                                  int64_t *startPointIndex, int64_t *pointCount ) const;
 
       template <typename COORDTYPE>
+      static size_t PlaceData3DPointsBuffers( Data3DPointsData_t<COORDTYPE> &buffers,
+                                              const PointStandardizedFieldsAvailable &fields, size_t pointCount,
+                                              char *base );
+
+      template <typename COORDTYPE>
+      bool ReadData3DPoints( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                             Data3DPointsArrays_t<COORDTYPE> &points ) const;
+
+      template <typename COORDTYPE>
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options,
+                               const Data3DPointsCallback_t<COORDTYPE> &callback ) const;
+
+      template <typename COORDTYPE>
+      bool ImportData3DPoints( const Data3DPointsImportOptions &options,
+                               std::vector<Data3DPointsArrays_t<COORDTYPE>> &scans ) const;
+
+      template <typename COORDTYPE>
+      std::vector<SourceDestBuffer> SetUpData3DPointsBuffers( int64_t dataIndex, size_t pointCount,
+                                                              const Data3DPointsData_t<COORDTYPE> &buffers ) const;
+
+      template <typename COORDTYPE>
+      CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsData_t<COORDTYPE> &buffers,
+                                                    const Data3DPointsFilter &filter = {} ) const;
+
       CompressedVectorReader SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
-                                                    const Data3DPointsData_t<COORDTYPE> &buffers ) const;
+                                                    const Data3DPointsLayout &layout ) const;
+
+      bool SetUpData3DPointsPose( int64_t dataIndex, CompressedVectorReader &reader,
+                                  const RigidBodyTransform &extraTransform ) const;
+
+      template <typename COORDTYPE>
+      bool ReadData3DPointsRaster( int64_t dataIndex, const Data3DPointsData_t<COORDTYPE> &rasters,
+                                   const Data3DPointsRasterWindow &window ) const;
 
       StructureNode GetRawE57Root() const;
 
@@ -107,6 +140,11 @@ namespace e57
       //! @return number of bytes read
       int64_t ReadImage2DNode( StructureNode image, Image2DType imageType, void *pBuffer, int64_t start,
                                int64_t count ) const;
+
+      //! @brief Reads all the points of a scan, decoding its fields on up to the context's threadCount threads
+      template <typename COORDTYPE>
+      void ReadData3DPointsOn( int64_t dataIndex, const PointStandardizedFieldsAvailable &fields,
+                               Data3DPointsArrays_t<COORDTYPE> &points, const ExecutionContext &context ) const;
    }; // end Reader class
 
 } // end namespace e57
@@ -27,8 +27,8 @@
 
 #include <cmath>
 
-#include "CheckedFile.h"
 #include "ScaledIntegerNodeImpl.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -177,7 +177,7 @@ namespace e57
       }
    }
 
-   void ScaledIntegerNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, CheckedFile &cf, int indent,
+   void ScaledIntegerNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, XmlWriter &xml, int indent,
                                          const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -189,37 +189,37 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      cf << space( indent ) << "<" << fieldName << " type=\"ScaledInteger\"";
+      xml << space( indent ) << "<" << fieldName << " type=\"ScaledInteger\"";
 
       /// Don't need to write if are default values
       if ( minimum_ != E57_INT64_MIN )
       {
-         cf << " minimum=\"" << minimum_ << "\"";
+         xml << " minimum=\"" << minimum_ << "\"";
       }
       if ( maximum_ != E57_INT64_MAX )
       {
-         cf << " maximum=\"" << maximum_ << "\"";
+         xml << " maximum=\"" << maximum_ << "\"";
       }
       if ( scale_ != 1.0 )
       {
-         cf << " scale=\"" << scale_ << "\"";
+         xml << " scale=\"" << scale_ << "\"";
       }
       if ( offset_ != 0.0 )
       {
-         cf << " offset=\"" << offset_ << "\"";
+         xml << " offset=\"" << offset_ << "\"";
       }
 
       /// Write value as child text, unless it is the default value
       if ( value_ != 0 )
       {
-         cf << ">" << value_ << "</" << fieldName << ">\n";
+         xml << ">" << value_ << "</" << fieldName << ">\n";
       }
       else
       {
-         cf << "/>\n";
+         xml << "/>\n";
       }
    }
 
@@ -25,13 +25,103 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
 
 using namespace e57;
 
+constexpr size_t SourceDestBufferImpl::BatchSize;
+
+namespace
+{
+   /// Store count values of type T, starting at p, Stride bytes apart.  A compile time stride lets the compiler
+   /// unroll and vectorize the loop, both for contiguous buffers and for fields of a user's point structure.
+   template <typename T, size_t Stride, typename V> void storeFixedStride( char *p, const V *values, size_t count )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         *reinterpret_cast<T *>( p + i * Stride ) = static_cast<T>( values[i] );
+      }
+   }
+
+   /// Store count values of type T, starting at p, stride bytes apart.  Picks a specialized loop for the common
+   /// strides: contiguous, and the 16 and 32 byte point structures.
+   template <typename T, typename V> void storeValues( char *p, size_t stride, const V *values, size_t count )
+   {
+      switch ( stride )
+      {
+         case sizeof( T ):
+            storeFixedStride<T, sizeof( T )>( p, values, count );
+            break;
+         case 16:
+            storeFixedStride<T, 16>( p, values, count );
+            break;
+         case 32:
+            storeFixedStride<T, 32>( p, values, count );
+            break;
+         default:
+            for ( size_t i = 0; i < count; ++i )
+            {
+               *reinterpret_cast<T *>( p + i * stride ) = static_cast<T>( values[i] );
+            }
+            break;
+      }
+   }
+
+   /// Return index of first value that T can't represent, or count if all fit
+   template <typename T> size_t firstUnrepresentable( const int64_t *values, size_t count )
+   {
+      const auto minimum = static_cast<int64_t>( std::numeric_limits<T>::min() );
+      const auto maximum = static_cast<int64_t>( std::numeric_limits<T>::max() );
+
+      /// Common case is that everything fits, so test the whole batch without branching first
+      bool allFit = true;
+      for ( size_t i = 0; i < count; ++i )
+      {
+         allFit &= ( values[i] >= minimum ) & ( values[i] <= maximum );
+      }
+
+      if ( allFit )
+      {
+         return count;
+      }
+
+      size_t i = 0;
+      while ( values[i] >= minimum && values[i] <= maximum )
+      {
+         ++i;
+      }
+
+      return i;
+   }
+
+   /// Scale values and round to integer type T, stopping at the first one that T can't represent.
+   /// Return number of values stored, and the unrepresentable value in badValue.
+   template <typename T>
+   size_t storeScaledIntegers( char *p, size_t stride, const int64_t *values, size_t count, double scale,
+                               double offset, double &badValue )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double scaledValue = floor( values[i] * scale + offset + 0.5 );
+
+         if ( scaledValue < std::numeric_limits<T>::min() || std::numeric_limits<T>::max() < scaledValue )
+         {
+            badValue = scaledValue;
+            return i;
+         }
+
+         *reinterpret_cast<T *>( p + i * stride ) = static_cast<T>( scaledValue );
+      }
+
+      return count;
+   }
+}
+
 SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile, const ustring &pathName,
                                             const size_t capacity, bool doConversion, bool doScaling ) :
    destImageFile_( destImageFile ),
@@ -937,6 +1027,223 @@ void SourceDestBufferImpl::setNextDouble( double value )
    _setNextReal( value );
 }
 
+template <typename T> void SourceDestBufferImpl::_setNextIntegers( const int64_t *values, size_t count )
+{
+   const size_t fitCount = firstUnrepresentable<T>( values, count );
+
+   storeValues<T>( &base_[nextIndex_ * stride_], stride_, values, fitCount );
+   nextIndex_ += static_cast<unsigned>( fitCount );
+
+   if ( fitCount < count )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
+                            "pathName=" + pathName_ + " value=" + toString( values[fitCount] ) );
+   }
+}
+
+void SourceDestBufferImpl::setNextInt64s( const int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify have room
+   if ( count > capacity_ - nextIndex_ )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString( count ) );
+   }
+
+   switch ( memoryRepresentation_ )
+   {
+      case E57_INT8:
+         _setNextIntegers<int8_t>( values, count );
+         return;
+      case E57_UINT8:
+         _setNextIntegers<uint8_t>( values, count );
+         return;
+      case E57_INT16:
+         _setNextIntegers<int16_t>( values, count );
+         return;
+      case E57_UINT16:
+         _setNextIntegers<uint16_t>( values, count );
+         return;
+      case E57_INT32:
+         _setNextIntegers<int32_t>( values, count );
+         return;
+      case E57_UINT32:
+         _setNextIntegers<uint32_t>( values, count );
+         return;
+      case E57_INT64:
+         storeValues<int64_t>( &base_[nextIndex_ * stride_], stride_, values, count );
+         break;
+      case E57_REAL32:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
+         }
+         storeValues<float>( &base_[nextIndex_ * stride_], stride_, values, count );
+         break;
+      case E57_REAL64:
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
+         }
+         storeValues<double>( &base_[nextIndex_ * stride_], stride_, values, count );
+         break;
+      case E57_BOOL:
+      case E57_USTRING:
+         /// No batch version of these, let the single value routine handle them
+         for ( size_t i = 0; i < count; ++i )
+         {
+            setNextInt64( values[i] );
+         }
+         return;
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::setNextInt64s( const int64_t *values, size_t count, double scale, double offset )
+{
+   /// don't checkImageFileOpen
+
+   /// If the user did not request scaling, then we send raw values to user's buffer.
+   if ( !doScaling_ )
+   {
+      setNextInt64s( values, count );
+      return;
+   }
+
+   /// Verify have room
+   if ( count > capacity_ - nextIndex_ )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString( count ) );
+   }
+
+   char *p = &base_[nextIndex_ * stride_];
+   size_t storedCount = count;
+   double badValue = 0.0;
+
+   switch ( memoryRepresentation_ )
+   {
+      case E57_INT8:
+         storedCount = storeScaledIntegers<int8_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_UINT8:
+         storedCount = storeScaledIntegers<uint8_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_INT16:
+         storedCount = storeScaledIntegers<int16_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_UINT16:
+         storedCount = storeScaledIntegers<uint16_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_INT32:
+         storedCount = storeScaledIntegers<int32_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_UINT32:
+         storedCount = storeScaledIntegers<uint32_t>( p, stride_, values, count, scale, offset, badValue );
+         break;
+      case E57_REAL32:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
+         }
+
+         /// Value will be stored in floating point rep in user's buffer, so keep full resolution here.
+         double scaled[BatchSize];
+         for ( size_t start = 0; start < count; start += BatchSize )
+         {
+            const size_t n = std::min( count - start, BatchSize );
+            for ( size_t i = 0; i < n; ++i )
+            {
+               scaled[i] = values[start + i] * scale + offset;
+            }
+            storeValues<float>( p + start * stride_, stride_, scaled, n );
+         }
+         break;
+      }
+      case E57_REAL64:
+      {
+         if ( !doConversion_ )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
+         }
+
+         double scaled[BatchSize];
+         for ( size_t start = 0; start < count; start += BatchSize )
+         {
+            const size_t n = std::min( count - start, BatchSize );
+            for ( size_t i = 0; i < n; ++i )
+            {
+               scaled[i] = values[start + i] * scale + offset;
+            }
+            storeValues<double>( p + start * stride_, stride_, scaled, n );
+         }
+         break;
+      }
+      case E57_INT64:
+      case E57_BOOL:
+      case E57_USTRING:
+         /// No batch version of these, let the single value routine handle them
+         for ( size_t i = 0; i < count; ++i )
+         {
+            setNextInt64( values[i], scale, offset );
+         }
+         return;
+   }
+
+   nextIndex_ += static_cast<unsigned>( storedCount );
+
+   if ( storedCount < count )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
+                            "pathName=" + pathName_ + " scaledValue=" + toString( badValue ) );
+   }
+}
+
+template <typename T> void SourceDestBufferImpl::_setNextReals( const T *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify have room
+   if ( count > capacity_ - nextIndex_ )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString( count ) );
+   }
+
+   /// Only same or wider floating point reps can be copied without checks, let the single value routine handle
+   /// the rest.
+   if ( memoryRepresentation_ == E57_REAL64 || ( memoryRepresentation_ == E57_REAL32 && sizeof( T ) == 4 ) )
+   {
+      if ( memoryRepresentation_ == E57_REAL64 )
+      {
+         storeValues<double>( &base_[nextIndex_ * stride_], stride_, values, count );
+      }
+      else
+      {
+         storeValues<float>( &base_[nextIndex_ * stride_], stride_, values, count );
+      }
+      nextIndex_ += static_cast<unsigned>( count );
+   }
+   else
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         _setNextReal( values[i] );
+      }
+   }
+}
+
+void SourceDestBufferImpl::setNextFloats( const float *values, size_t count )
+{
+   _setNextReals( values, count );
+}
+
+void SourceDestBufferImpl::setNextDoubles( const double *values, size_t count )
+{
+   _setNextReals( values, count );
+}
+
 void SourceDestBufferImpl::setNextString( const ustring &value )
 {
    /// don't checkImageFileOpen
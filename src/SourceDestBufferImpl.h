@@ -88,6 +88,10 @@ namespace e57
       {
          nextIndex_ = 0;
       }
+      void setNextIndex( unsigned index )
+      {
+         nextIndex_ = index;
+      }
 
       int64_t getNextInt64();
       int64_t getNextInt64( double scale, double offset );
@@ -100,6 +104,15 @@ namespace e57
       void setNextDouble( double value );
       void setNextString( const ustring &value );
 
+      /// Batch versions of the above, for decoders that produce many values at once
+      void setNextInt64s( const int64_t *values, size_t count );
+      void setNextInt64s( const int64_t *values, size_t count, double scale, double offset );
+      void setNextFloats( const float *values, size_t count );
+      void setNextDoubles( const double *values, size_t count );
+
+      /// Suggested number of values per batch call
+      static constexpr size_t BatchSize = 64;
+
       void checkCompatible( const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const;
 
 #ifdef E57_DEBUG
@@ -108,6 +121,8 @@ namespace e57
 
    private:
       template <typename T> void _setNextReal( T inValue );
+      template <typename T> void _setNextReals( const T *values, size_t count );
+      template <typename T> void _setNextIntegers( const int64_t *values, size_t count );
 
       void checkState_() const; /// Common routine to check that constructor
                                 /// arguments were ok, throws if not
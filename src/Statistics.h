@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace e57
+{
+   /// Adds the time it lives, in nanoseconds, to a counter if it has one. Without a counter it only costs a test, so
+   /// pass nullptr when statistics are disabled. COUNTER is uint64_t, or std::atomic<uint64_t> if shared by threads.
+   template <typename COUNTER> class ScopedTimer
+   {
+   public:
+      explicit ScopedTimer( COUNTER *counter ) : counter_( counter )
+      {
+         if ( counter_ != nullptr )
+         {
+            start_ = std::chrono::steady_clock::now();
+         }
+      }
+
+      ~ScopedTimer()
+      {
+         if ( counter_ != nullptr )
+         {
+            const auto elapsed =
+               std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start_ );
+
+            *counter_ += static_cast<uint64_t>( elapsed.count() );
+         }
+      }
+
+      ScopedTimer( const ScopedTimer & ) = delete;
+      ScopedTimer &operator=( const ScopedTimer & ) = delete;
+
+   private:
+      COUNTER *counter_;
+      std::chrono::steady_clock::time_point start_;
+   };
+} // end namespace e57
@@ -26,7 +26,7 @@
  */
 
 #include "StringNodeImpl.h"
-#include "CheckedFile.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -77,7 +77,7 @@ namespace e57
       }
    }
 
-   void StringNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, CheckedFile &cf, int indent,
+   void StringNodeImpl::writeXml( ImageFileImplSharedPtr /*imf*/, XmlWriter &xml, int indent,
                                   const char *forcedFieldName )
    {
       // don't checkImageFileOpen
@@ -89,19 +89,19 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      cf << space( indent ) << "<" << fieldName << " type=\"String\"";
+      xml << space( indent ) << "<" << fieldName << " type=\"String\"";
 
       /// Write value as child text, unless it is the default value
       if ( value_.empty() )
       {
-         cf << "/>\n";
+         xml << "/>\n";
       }
       else
       {
-         cf << "><![CDATA[";
+         xml << "><![CDATA[";
 
          size_t currentPosition = 0;
          size_t len = value_.length();
@@ -115,21 +115,21 @@ namespace e57
             if ( found == std::string::npos )
             {
                /// Didn't find any more "]]>", so can send the rest.
-               cf << value_.substr( currentPosition );
+               xml << value_.substr( currentPosition );
                break;
             }
 
             /// Must output in two pieces, first send upto end of "]]"  (don't send
             /// the following ">").
-            cf << value_.substr( currentPosition, found - currentPosition + 2 );
+            xml << value_.substr( currentPosition, found - currentPosition + 2 );
 
             /// Then start a new CDATA
-            cf << "]]><![CDATA[";
+            xml << "]]><![CDATA[";
 
             /// Keep looping to send the ">" plus the remaining part of the string
             currentPosition = found + 2;
          }
-         cf << "]]></" << fieldName << ">\n";
+         xml << "]]></" << fieldName << ">\n";
       }
    }
 
@@ -27,12 +27,18 @@
 
 #include <climits>
 
-#include "CheckedFile.h"
 #include "ImageFileImpl.h"
 #include "StructureNodeImpl.h"
+#include "XmlWriter.h"
 
 using namespace e57;
 
+namespace
+{
+   /// Structures with more children than this index them by element name
+   constexpr size_t HASHED_CHILD_COUNT = 16;
+}
+
 StructureNodeImpl::StructureNodeImpl( ImageFileImplWeakPtr destImageFile ) : NodeImpl( destImageFile )
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
@@ -58,6 +64,9 @@ bool StructureNodeImpl::isTypeEquivalent( NodeImplSharedPtr ni )
    /// Downcast to shared_ptr<StructureNodeImpl>
    std::shared_ptr<StructureNodeImpl> si( std::static_pointer_cast<StructureNodeImpl>( ni ) );
 
+   loadDeferredChildren();
+   si->loadDeferredChildren();
+
    /// Same number of children?
    if ( childCount() != si->childCount() )
    {
@@ -80,11 +89,13 @@ bool StructureNodeImpl::isTypeEquivalent( NodeImplSharedPtr ni )
       {
          /// Children in different order, so lookup by name and check if equal
          /// to our child
-         if ( !si->isDefined( myChildsFieldName ) )
+         NodeImplSharedPtr siChild( si->findChild( myChildsFieldName ) );
+
+         if ( !siChild )
          {
             return ( false );
          }
-         if ( !children_.at( i )->isTypeEquivalent( si->lookup( myChildsFieldName ) ) )
+         if ( !children_.at( i )->isTypeEquivalent( siChild ) )
          {
             return ( false );
          }
@@ -107,7 +118,7 @@ void StructureNodeImpl::setAttachedRecursive()
    /// Mark this node as attached to an ImageFile
    isAttached_ = true;
 
-   /// Not a leaf node, so mark all our children
+   /// Not a leaf node, so mark all our children. Deferred children are marked as they are added.
    for ( auto &child : children_ )
    {
       child->setAttachedRecursive();
@@ -118,11 +129,14 @@ int64_t StructureNodeImpl::childCount() const
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
+   const_cast<StructureNodeImpl *>( this )->loadDeferredChildren();
+
    return children_.size();
 }
 NodeImplSharedPtr StructureNodeImpl::get( int64_t index )
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+   loadDeferredChildren();
    if ( index < 0 || index >= static_cast<int64_t>( children_.size() ) )
    { // %%% Possible truncation on platforms where size_t = uint64
       throw E57_EXCEPTION2( E57_ERROR_CHILD_INDEX_OUT_OF_BOUNDS, "this->pathName=" + this->pathName() +
@@ -144,67 +158,128 @@ NodeImplSharedPtr StructureNodeImpl::get( const ustring &pathName )
    return ( ni );
 }
 
+bool StructureNodeImpl::isDefined( const PathName &pathName )
+{
+   checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+   NodeImplSharedPtr ni( lookup( pathName.isRelative(), pathName.elementNames() ) );
+   return ( ni != nullptr );
+}
+
+NodeImplSharedPtr StructureNodeImpl::get( const PathName &pathName )
+{
+   checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+   NodeImplSharedPtr ni( lookup( pathName.isRelative(), pathName.elementNames() ) );
+
+   if ( !ni )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_PATH_UNDEFINED,
+                            "this->pathName=" + this->pathName() + " pathName=" + pathName.str() );
+   }
+   return ( ni );
+}
+
 NodeImplSharedPtr StructureNodeImpl::lookup( const ustring &pathName )
 {
    /// don't checkImageFileOpen
-   //??? use lookup(fields, level) instead, for speed.
    bool isRelative;
    std::vector<ustring> fields;
    ImageFileImplSharedPtr imf( destImageFile_ );
    imf->pathNameParse( pathName, isRelative, fields ); // throws if bad pathName
 
-   if ( isRelative || isRoot() )
+   return lookup( isRelative, fields );
+}
+
+NodeImplSharedPtr StructureNodeImpl::lookup( bool isRelative, const StringList &fields )
+{
+   /// don't checkImageFileOpen
+   if ( isRelative )
+   {
+      /// Parsing doesn't allow an empty relative path
+      return lookup( fields, 0 );
+   }
+
+   /// Absolute pathname, find root of the tree
+   NodeImplSharedPtr root( getRoot() );
+
+   if ( fields.empty() )
    {
-      if ( fields.empty() )
-      {
-         if ( isRelative )
-         {
-            return NodeImplSharedPtr(); /// empty pointer
-         }
+      return ( root );
+   }
 
-         NodeImplSharedPtr root( getRoot() );
-         return ( root );
-      }
+   return root->lookup( fields, 0 );
+}
 
-      /// Find child with elementName that matches first field in path
-      unsigned i;
-      for ( i = 0; i < children_.size(); i++ )
-      {
-         if ( fields.at( 0 ) == children_.at( i )->elementName() )
-         {
-            break;
-         }
-      }
-      if ( i == children_.size() )
+NodeImplSharedPtr StructureNodeImpl::lookup( const StringList &fields, unsigned level )
+{
+   /// don't checkImageFileOpen
+   loadDeferredChildren();
+
+   /// Find child with elementName that matches the field at this level
+   NodeImplSharedPtr child( findChild( fields.at( level ) ) );
+
+   if ( !child || ( level == fields.size() - 1 ) )
+   {
+      return ( child );
+   }
+
+   /// Call lookup on child object with remaining fields in path name
+   return child->lookup( fields, level + 1 );
+}
+
+NodeImplSharedPtr StructureNodeImpl::findChild( const ustring &elementName ) const
+{
+   if ( !childIndex_.empty() )
+   {
+      auto found = childIndex_.find( elementName );
+
+      if ( found == childIndex_.end() )
       {
          return NodeImplSharedPtr(); /// empty pointer
       }
 
-      if ( fields.size() == 1 )
+      return ( children_[found->second] );
+   }
+
+   for ( const auto &child : children_ )
+   {
+      if ( child->elementName() == elementName )
       {
-         return ( children_.at( i ) );
+         return ( child );
       }
+   }
 
-      //??? use level here rather than unparse
-      /// Remove first field in path
-      fields.erase( fields.begin() );
+   return NodeImplSharedPtr(); /// empty pointer
+}
 
-      /// Call lookup on child object with remaining fields in path name
-      return children_.at( i )->lookup( imf->pathNameUnparse( true, fields ) );
+void StructureNodeImpl::addChild( const NodeImplSharedPtr &ni )
+{
+   children_.push_back( ni );
+
+   if ( !childIndex_.empty() )
+   {
+      childIndex_.emplace( ni->elementName(), children_.size() - 1 );
    }
-   else
-   { /// Absolute pathname and we aren't at the root
-      /// Find root of the tree
-      NodeImplSharedPtr root( getRoot() );
+   else if ( children_.size() > HASHED_CHILD_COUNT )
+   {
+      childIndex_.reserve( children_.size() * 2 );
 
-      /// Call lookup on root
-      return ( root->lookup( pathName ) );
+      for ( size_t i = 0; i < children_.size(); i++ )
+      {
+         childIndex_.emplace( children_[i]->elementName(), i );
+      }
    }
 }
 
+void StructureNodeImpl::clearChildren()
+{
+   children_.clear();
+   childIndex_.clear();
+}
+
 void StructureNodeImpl::set( int64_t index64, NodeImplSharedPtr ni )
 {
    checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+   loadDeferredChildren();
 
    auto index = static_cast<unsigned>( index64 );
 
@@ -243,7 +318,7 @@ void StructureNodeImpl::set( int64_t index64, NodeImplSharedPtr ni )
    }
 
    ni->setParent( shared_from_this(), elementName.str() );
-   children_.push_back( ni );
+   addChild( ni );
 }
 
 void StructureNodeImpl::set( const ustring &pathName, NodeImplSharedPtr ni, bool autoPathCreate )
@@ -300,29 +375,30 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
       throw E57_EXCEPTION2( E57_ERROR_SET_TWICE, "this->pathName=" + this->pathName() + " element=/" );
    }
 
-   /// Serial search for matching field name, if find match, have error since
+   loadDeferredChildren();
+
+   /// Search for matching field name, if find match, have error since
    /// can't set twice
-   for ( auto &child : children_ )
+   NodeImplSharedPtr child( findChild( fields.at( level ) ) );
+
+   if ( child )
    {
-      if ( fields.at( level ) == child->elementName() )
+      if ( level == fields.size() - 1 )
       {
-         if ( level == fields.size() - 1 )
-         {
-            /// Enforce "set once" policy, don't allow reset
-            throw E57_EXCEPTION2( E57_ERROR_SET_TWICE,
-                                  "this->pathName=" + this->pathName() + " element=" + fields[level] );
-         }
+         /// Enforce "set once" policy, don't allow reset
+         throw E57_EXCEPTION2( E57_ERROR_SET_TWICE,
+                               "this->pathName=" + this->pathName() + " element=" + fields[level] );
+      }
 
-         /// Recurse on child
-         child->set( fields, level + 1, ni );
+      /// Recurse on child
+      child->set( fields, level + 1, ni );
 
-         return;
-      }
+      return;
    }
    /// Didn't find matching field name, so have a new child.
 
-   /// If this struct is type constrained, can't add new child
-   if ( isTypeConstrained() )
+   /// If this struct is type constrained, can't add new child. Deferred children were checked when it was parsed.
+   if ( !loading_ && isTypeConstrained() )
    {
       throw E57_EXCEPTION2( E57_ERROR_HOMOGENEOUS_VIOLATION, "this->pathName=" + this->pathName() );
    }
@@ -332,7 +408,7 @@ void StructureNodeImpl::set( const std::vector<ustring> &fields, unsigned level,
    {
       /// At bottom, so append node at end of children
       ni->setParent( shared_from_this(), fields.at( level ) );
-      children_.push_back( ni );
+      addChild( ni );
    }
    else
    {
@@ -365,11 +441,58 @@ void StructureNodeImpl::append( NodeImplSharedPtr ni )
    set( childCount(), ni );
 }
 
+void StructureNodeImpl::setDeferredChildren( uint64_t logicalStart, uint64_t logicalLength )
+{
+   /// don't checkImageFileOpen, called while the file is parsed
+   deferredStart_ = logicalStart;
+   deferredLength_ = logicalLength;
+   deferred_.store( true, std::memory_order_release );
+}
+
+void StructureNodeImpl::loadDeferredChildren()
+{
+   /// Fast path once loaded, readers on other threads see children_ complete
+   if ( !deferred_.load( std::memory_order_acquire ) )
+   {
+      return;
+   }
+
+   ImageFileImplSharedPtr imf( destImageFile_ );
+
+   std::lock_guard<std::recursive_mutex> lock( imf->deferredMutex() );
+
+   /// Loaded by another thread while we waited, or being loaded by this one and the parser is adding children
+   if ( !deferred_.load( std::memory_order_relaxed ) || loading_ )
+   {
+      return;
+   }
+
+   loading_ = true;
+
+   try
+   {
+      imf->parseDeferred( std::static_pointer_cast<StructureNodeImpl>( shared_from_this() ), deferredStart_,
+                          deferredLength_ );
+   }
+   catch ( ... )
+   {
+      /// Leave the node as it was, so the error is thrown again on the next access
+      clearChildren();
+      loading_ = false;
+      throw;
+   }
+
+   loading_ = false;
+   deferred_.store( false, std::memory_order_release );
+}
+
 //??? use visitor?
 void StructureNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
 {
    /// don't checkImageFileOpen
 
+   loadDeferredChildren();
+
    /// Not a leaf node, so check all our children
    for ( auto &child : children_ )
    {
@@ -378,7 +501,7 @@ void StructureNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSh
 }
 
 //??? use visitor?
-void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent, const char *forcedFieldName )
+void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent, const char *forcedFieldName )
 {
    /// don't checkImageFileOpen
 
@@ -389,10 +512,12 @@ void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, i
    }
    else
    {
-      fieldName = elementName_;
+      fieldName = *elementName_;
    }
 
-   cf << space( indent ) << "<" << fieldName << " type=\"Structure\"";
+   loadDeferredChildren();
+
+   xml << space( indent ) << "<" << fieldName << " type=\"Structure\"";
 
    const int numSpaces = indent + static_cast<int>( fieldName.length() ) + 2;
 
@@ -417,35 +542,35 @@ void StructureNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, i
 
          const int index = static_cast<int>( i );
 
-         cf << "\n"
-            << space( numSpaces ) << xmlnsExtension << imf->extensionsPrefix( index ) << "=\""
-            << imf->extensionsUri( index ) << "\"";
+         xml << "\n"
+             << space( numSpaces ) << xmlnsExtension << imf->extensionsPrefix( index ) << "=\""
+             << imf->extensionsUri( index ) << "\"";
       }
 
       /// If user didn't explicitly declare a default namespace, use the current
       /// E57 standard one.
       if ( !gotDefaultNamespace )
       {
-         cf << "\n" << space( numSpaces ) << "xmlns=\"" << E57_V1_0_URI << "\"";
+         xml << "\n" << space( numSpaces ) << "xmlns=\"" << E57_V1_0_URI << "\"";
       }
    }
    if ( !children_.empty() )
    {
-      cf << ">\n";
+      xml << ">\n";
 
       /// Write all children nested inside Structure element
       for ( auto &child : children_ )
       {
-         child->writeXml( imf, cf, indent + 2 );
+         child->writeXml( imf, xml, indent + 2 );
       }
 
       /// Write closing tag
-      cf << space( indent ) << "</" << fieldName << ">\n";
+      xml << space( indent ) << "</" << fieldName << ">\n";
    }
    else
    {
       /// XML element has no child elements
-      cf << "/>\n";
+      xml << "/>\n";
    }
 }
 
@@ -457,6 +582,7 @@ void StructureNodeImpl::dump( int indent, std::ostream &os ) const
    os << space( indent ) << "type:        Structure"
       << " (" << type() << ")" << std::endl;
    NodeImpl::dump( indent, os );
+   const_cast<StructureNodeImpl *>( this )->loadDeferredChildren();
    for ( unsigned i = 0; i < children_.size(); i++ )
    {
       os << space( indent ) << "child[" << i << "]:" << std::endl;
@@ -27,6 +27,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
+
 #include "NodeImpl.h"
 
 namespace e57
@@ -48,6 +51,10 @@ namespace e57
       virtual NodeImplSharedPtr get( int64_t index );
       NodeImplSharedPtr get( const ustring &pathName ) override;
 
+      /// Same as with a string, without parsing the path again
+      bool isDefined( const PathName &pathName );
+      NodeImplSharedPtr get( const PathName &pathName );
+
       virtual void set( int64_t index, NodeImplSharedPtr ni );
       void set( const ustring &pathName, NodeImplSharedPtr ni, bool autoPathCreate = false ) override;
       void set( const StringList &fields, unsigned level, NodeImplSharedPtr ni, bool autoPathCreate = false ) override;
@@ -55,7 +62,10 @@ namespace e57
 
       void checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin ) override;
 
-      void writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent,
+      /// The children are in this range of the XML section, and are parsed on first access
+      void setDeferredChildren( uint64_t logicalStart, uint64_t logicalLength );
+
+      void writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent,
                      const char *forcedFieldName = nullptr ) override;
 
 #ifdef E57_DEBUG
@@ -65,7 +75,26 @@ namespace e57
    protected:
       friend class CompressedVectorReaderImpl;
       NodeImplSharedPtr lookup( const ustring &pathName ) override;
+      NodeImplSharedPtr lookup( const StringList &fields, unsigned level ) override;
+      NodeImplSharedPtr lookup( bool isRelative, const StringList &fields );
+
+      /// Child with the element name, or an empty pointer
+      NodeImplSharedPtr findChild( const ustring &elementName ) const;
+      void addChild( const NodeImplSharedPtr &ni );
+      void clearChildren();
+
+      /// Parses deferred children, if any. Safe to call on several threads.
+      void loadDeferredChildren();
 
       std::vector<NodeImplSharedPtr> children_;
+
+   private:
+      std::atomic<bool> deferred_{ false }; /// children_ not parsed yet
+      bool loading_ = false;                /// children_ being parsed, under the file's deferredMutex()
+      uint64_t deferredStart_ = 0;
+      uint64_t deferredLength_ = 0;
+
+      /// Index of children_ by element name, kept once there are many children
+      std::unordered_map<ustring, size_t> childIndex_;
    };
 }
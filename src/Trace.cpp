@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+#include "Common.h"
+#include "Trace.h"
+
+namespace e57
+{
+#ifdef E57_ENABLE_TRACE
+   namespace
+   {
+      /// Tested without the lock, so spans cost one load while no trace is running
+      std::atomic<bool> traceActive( false );
+
+      std::mutex traceMutex; /// guards everything below
+      std::ofstream traceOutput;
+      bool traceFirstEvent = true;
+      std::chrono::steady_clock::time_point traceEpoch;
+
+      int64_t traceNow()
+      {
+         return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - traceEpoch )
+            .count();
+      }
+
+      /// Small numbers are easier to read in a trace viewer than hashed std::thread::ids
+      unsigned traceThreadId()
+      {
+         static std::atomic<unsigned> nextId( 1 );
+         thread_local unsigned id = nextId++;
+
+         return id;
+      }
+   }
+
+   TraceSpan::TraceSpan( const char *name, const char *argName, int64_t argValue ) :
+      name_( name ), argName_( argName ), argValue_( argValue ), start_( traceActive ? traceNow() : -1 )
+   {
+   }
+
+   TraceSpan::~TraceSpan()
+   {
+      if ( start_ < 0 )
+      {
+         return;
+      }
+
+      const int64_t end = traceNow();
+      const unsigned threadId = traceThreadId();
+
+      std::lock_guard<std::mutex> lock( traceMutex );
+
+      /// The trace may have been stopped while the span was open
+      if ( !traceOutput.is_open() )
+      {
+         return;
+      }
+
+      traceOutput << ( traceFirstEvent ? "\n" : ",\n" );
+      traceOutput << R"({"name":")" << name_ << R"(","cat":"e57","ph":"X","ts":)" << start_ << R"(,"dur":)"
+                  << ( end - start_ ) << R"(,"pid":1,"tid":)" << threadId;
+
+      if ( argName_ != nullptr )
+      {
+         traceOutput << R"(,"args":{")" << argName_ << R"(":)" << argValue_ << "}";
+      }
+
+      traceOutput << "}";
+      traceFirstEvent = false;
+   }
+#endif
+
+   /*!
+   @brief   Test whether the library was built with tracing support.
+   @details
+   Tracing is compiled in with the CMake option E57_ENABLE_TRACE. Without it,
+   Trace::start() does nothing and returns false.
+   @return  true if Trace::start() can record a trace.
+   @throw   No E57Exceptions.
+   @see     Trace::start
+   */
+   bool Trace::available()
+   {
+#ifdef E57_ENABLE_TRACE
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   /*!
+   @brief   Start recording the phases of reading and writing to a Chrome trace file.
+   @param   [in] fileName   The JSON file to write, replaced if it exists.
+   @details
+   Spans are recorded for reading the file header, parsing and writing the XML
+   section, reading and writing pages, verifying checksums, reading packets,
+   feeding packets to the decoders (and each decoder's share), writing packets,
+   and closing ImageFiles. They are recorded from all threads and all ImageFiles
+   until Trace::stop() is called.
+
+   The file uses the Chrome trace event format, and can be opened with
+   chrome://tracing or https://ui.perfetto.dev. A trace that is already running
+   is stopped first.
+   @return  false if the library was built without tracing, or the file couldn't
+   be created.
+   @throw   No E57Exceptions.
+   @see     Trace::stop, Trace::available
+   */
+   bool Trace::start( const ustring &fileName )
+   {
+#ifdef E57_ENABLE_TRACE
+      stop();
+
+      std::lock_guard<std::mutex> lock( traceMutex );
+
+      traceOutput.open( fileName, std::ios::out | std::ios::trunc );
+      if ( !traceOutput.is_open() )
+      {
+         return false;
+      }
+
+      traceOutput << R"({"traceEvents":[)";
+      traceFirstEvent = true;
+      traceEpoch = std::chrono::steady_clock::now();
+      traceActive = true;
+
+      return true;
+#else
+      (void)fileName;
+      return false;
+#endif
+   }
+
+   /*!
+   @brief   Stop recording, and complete the trace file.
+   @details
+   It is not an error to call this if no trace is running.
+   @throw   No E57Exceptions.
+   @see     Trace::start
+   */
+   void Trace::stop()
+   {
+#ifdef E57_ENABLE_TRACE
+      std::lock_guard<std::mutex> lock( traceMutex );
+
+      traceActive = false;
+
+      if ( traceOutput.is_open() )
+      {
+         traceOutput << "\n]}\n";
+         traceOutput.close();
+      }
+#endif
+   }
+} // end namespace e57
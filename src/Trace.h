@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include <cstdint>
+
+/// E57_TRACE_SPAN( name ) records the rest of the enclosing scope as a span of the trace started by Trace::start().
+/// E57_TRACE_SPAN_ARG also records one integer argument of the span.  Both compile to nothing unless the library is
+/// built with E57_ENABLE_TRACE.
+#ifdef E57_ENABLE_TRACE
+#define E57_TRACE_CONCAT_( a, b ) a##b
+#define E57_TRACE_CONCAT( a, b ) E57_TRACE_CONCAT_( a, b )
+#define E57_TRACE_SPAN( name ) ::e57::TraceSpan E57_TRACE_CONCAT( traceSpan, __LINE__ )( name )
+#define E57_TRACE_SPAN_ARG( name, argName, argValue )                                                                \
+   ::e57::TraceSpan E57_TRACE_CONCAT( traceSpan, __LINE__ )( name, argName, static_cast<int64_t>( argValue ) )
+#else
+#define E57_TRACE_SPAN( name )
+#define E57_TRACE_SPAN_ARG( name, argName, argValue )
+#endif
+
+namespace e57
+{
+#ifdef E57_ENABLE_TRACE
+   /// Writes a complete event to the trace when destroyed, if a trace was running when it was created
+   class TraceSpan
+   {
+   public:
+      explicit TraceSpan( const char *name, const char *argName = nullptr, int64_t argValue = 0 );
+      ~TraceSpan();
+
+      TraceSpan( const TraceSpan & ) = delete;
+      TraceSpan &operator=( const TraceSpan & ) = delete;
+
+   private:
+      const char *name_;    /// string literal
+      const char *argName_; /// string literal, nullptr if the span has no argument
+      int64_t argValue_;
+      int64_t start_; /// microseconds since the trace started, negative if no trace was running
+   };
+#endif
+} // end namespace e57
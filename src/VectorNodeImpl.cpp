@@ -26,7 +26,7 @@
  */
 
 #include "VectorNodeImpl.h"
-#include "CheckedFile.h"
+#include "XmlWriter.h"
 
 namespace e57
 {
@@ -98,7 +98,7 @@ namespace e57
       StructureNodeImpl::set( index64, ni );
    }
 
-   void VectorNodeImpl::writeXml( ImageFileImplSharedPtr imf, CheckedFile &cf, int indent, const char *forcedFieldName )
+   void VectorNodeImpl::writeXml( ImageFileImplSharedPtr imf, XmlWriter &xml, int indent, const char *forcedFieldName )
    {
       /// don't checkImageFileOpen
 
@@ -109,16 +109,16 @@ namespace e57
       }
       else
       {
-         fieldName = elementName_;
+         fieldName = *elementName_;
       }
 
-      cf << space( indent ) << "<" << fieldName << " type=\"Vector\" allowHeterogeneousChildren=\""
-         << static_cast<int64_t>( allowHeteroChildren_ ) << "\">\n";
+      xml << space( indent ) << "<" << fieldName << " type=\"Vector\" allowHeterogeneousChildren=\""
+          << static_cast<int64_t>( allowHeteroChildren_ ) << "\">\n";
       for ( auto &child : children_ )
       {
-         child->writeXml( imf, cf, indent + 2, "vectorChild" );
+         child->writeXml( imf, xml, indent + 2, "vectorChild" );
       }
-      cf << space( indent ) << "</" << fieldName << ">\n";
+      xml << space( indent ) << "</" << fieldName << ">\n";
    }
 
 #ifdef E57_DEBUG
@@ -34,7 +34,17 @@ namespace e57
 {
 
    WriterImpl::WriterImpl( const ustring &filePath, const ustring &coordinateMetadata ) :
-      imf_( filePath, "w" ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true )
+      WriterImpl( ImageFile( filePath, "w" ), coordinateMetadata )
+   {
+   }
+
+   WriterImpl::WriterImpl( std::vector<char> &output, const ustring &coordinateMetadata ) :
+      WriterImpl( ImageFile( output ), coordinateMetadata )
+   {
+   }
+
+   WriterImpl::WriterImpl( ImageFile imf, const ustring &coordinateMetadata ) :
+      imf_( imf ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true )
    {
       // We are using the E57 v1.0 data format standard fieldnames.
       // The standard fieldnames are used without an extension prefix (in the default namespace).
@@ -1065,6 +1075,40 @@ namespace e57
    template CompressedVectorWriter WriterImpl::SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                                       const Data3DPointsData_t<double> &buffers );
 
+   CompressedVectorWriter WriterImpl::SetUpData3DPointsData( int64_t dataIndex, size_t count,
+                                                             const Data3DPointsLayout &layout )
+   {
+      StructureNode scan( data3D_.get( dataIndex ) );
+      CompressedVectorNode points( scan.get( "points" ) );
+      StructureNode proto( points.prototype() );
+
+      std::vector<SourceDestBuffer> sourceBuffers;
+
+      for ( const auto &field : layout.fields )
+      {
+         // Fields from an extension can only be in the prototype if the extension is declared
+         const size_t colon = field.name.find( ':' );
+         ustring extUri;
+
+         if ( ( colon != ustring::npos ) && !imf_.extensionsLookupPrefix( field.name.substr( 0, colon ), extUri ) )
+         {
+            continue;
+         }
+
+         if ( proto.isDefined( field.name ) )
+         {
+            const bool scaled = ( proto.get( field.name ).type() == E57_SCALED_INTEGER );
+
+            sourceBuffers.push_back( layout.sourceDestBuffer( imf_, field, count, scaled ) );
+         }
+      }
+
+      // create the writer, all buffers must be setup before this call
+      CompressedVectorWriter writer = points.writer( sourceBuffers );
+
+      return writer;
+   }
+
    // This function writes out the group data
    bool WriterImpl::WriteData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
                                            int64_t *startPointIndex, int64_t *pointCount )
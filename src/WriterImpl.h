@@ -37,6 +37,7 @@ namespace e57
    {
    public:
       WriterImpl( const ustring &filePath, const ustring &coordinateMetaData );
+      WriterImpl( std::vector<char> &output, const ustring &coordinateMetaData );
 
       ~WriterImpl();
 
@@ -55,6 +56,9 @@ namespace e57
       CompressedVectorWriter SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
                                                     const Data3DPointsData_t<COORDTYPE> &buffers );
 
+      CompressedVectorWriter SetUpData3DPointsData( int64_t dataIndex, size_t pointCount,
+                                                    const Data3DPointsLayout &layout );
+
       bool WriteData3DGroupsData( int64_t dataIndex, int64_t groupCount, int64_t *idElementValue,
                                   int64_t *startPointIndex, int64_t *pointCount );
 
@@ -67,6 +71,8 @@ namespace e57
       ImageFile GetRawIMF();
 
    private:
+      WriterImpl( ImageFile imf, const ustring &coordinateMetaData );
+
       ImageFile imf_;
       StructureNode root_;
 
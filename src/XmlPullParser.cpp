@@ -0,0 +1,784 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "XmlPullParser.h"
+
+namespace e57
+{
+   namespace
+   {
+      const char *const XMLNS_URI = "http://www.w3.org/2000/xmlns/";
+
+      bool isWhitespace( char c )
+      {
+         return ( c == ' ' ) || ( c == '\t' ) || ( c == '\n' ) || ( c == '\r' );
+      }
+
+      /// Names are checked loosely: ASCII name characters, or any byte of a non-ASCII character
+      bool isNameStartChar( char c )
+      {
+         const unsigned char u = static_cast<unsigned char>( c );
+
+         return ( ( u >= 'a' ) && ( u <= 'z' ) ) || ( ( u >= 'A' ) && ( u <= 'Z' ) ) || ( u == '_' ) || ( u == ':' ) ||
+                ( u >= 0x80 );
+      }
+
+      bool isNameChar( char c )
+      {
+         return isNameStartChar( c ) || ( ( c >= '0' ) && ( c <= '9' ) ) || ( c == '-' ) || ( c == '.' );
+      }
+
+      /// Returns nullptr if s isn't found
+      const char *findString( const char *begin, const char *end, const char *s )
+      {
+         const char *found = std::search( begin, end, s, s + std::strlen( s ) );
+
+         return ( found == end ) ? nullptr : found;
+      }
+
+      /// Length of the UTF-8 encoded character at p, or 0 if it isn't valid
+      size_t utf8SequenceLength( const char *p, const char *end )
+      {
+         const unsigned char lead = static_cast<unsigned char>( *p );
+         size_t length;
+         uint32_t minimum;
+         uint32_t codePoint;
+
+         if ( lead < 0x80 )
+         {
+            return 1;
+         }
+         else if ( ( lead & 0xE0 ) == 0xC0 )
+         {
+            length = 2;
+            minimum = 0x80;
+            codePoint = lead & 0x1F;
+         }
+         else if ( ( lead & 0xF0 ) == 0xE0 )
+         {
+            length = 3;
+            minimum = 0x800;
+            codePoint = lead & 0x0F;
+         }
+         else if ( ( lead & 0xF8 ) == 0xF0 )
+         {
+            length = 4;
+            minimum = 0x10000;
+            codePoint = lead & 0x07;
+         }
+         else
+         {
+            return 0;
+         }
+
+         if ( static_cast<size_t>( end - p ) < length )
+         {
+            return 0;
+         }
+
+         for ( size_t i = 1; i < length; ++i )
+         {
+            const unsigned char c = static_cast<unsigned char>( p[i] );
+
+            if ( ( c & 0xC0 ) != 0x80 )
+            {
+               return 0;
+            }
+
+            codePoint = ( codePoint << 6 ) | ( c & 0x3F );
+         }
+
+         /// Overlong encodings, surrogates and code points past Unicode are invalid
+         if ( ( codePoint < minimum ) || ( ( codePoint >= 0xD800 ) && ( codePoint <= 0xDFFF ) ) ||
+              ( codePoint > 0x10FFFF ) )
+         {
+            return 0;
+         }
+
+         return length;
+      }
+
+      void appendUtf8( uint32_t codePoint, ustring &out )
+      {
+         if ( codePoint < 0x80 )
+         {
+            out += static_cast<char>( codePoint );
+         }
+         else if ( codePoint < 0x800 )
+         {
+            out += static_cast<char>( 0xC0 | ( codePoint >> 6 ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+         else if ( codePoint < 0x10000 )
+         {
+            out += static_cast<char>( 0xE0 | ( codePoint >> 12 ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+         else
+         {
+            out += static_cast<char>( 0xF0 | ( codePoint >> 18 ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+            out += static_cast<char>( 0x80 | ( codePoint & 0x3F ) );
+         }
+      }
+
+      void setLocalName( const ustring &qName, ustring &localName )
+      {
+         const size_t colon = qName.find( ':' );
+
+         if ( colon == ustring::npos )
+         {
+            localName = qName;
+         }
+         else
+         {
+            localName.assign( qName, colon + 1, ustring::npos );
+         }
+      }
+   }
+
+   XmlPullParser::XmlPullParser( const char *data, size_t size, bool isFragment )
+   {
+      reset( data, size, isFragment );
+   }
+
+   void XmlPullParser::reset( const char *data, size_t size, bool isFragment )
+   {
+      begin_ = data;
+      pos_ = data;
+      end_ = data + size;
+      isFragment_ = isFragment;
+
+      openElements_.clear();
+      rootEnded_ = false;
+      emptyElementPending_ = false;
+
+      /// Skip a byte order mark
+      if ( startsWith( "\xEF\xBB\xBF" ) )
+      {
+         pos_ += 3;
+      }
+   }
+
+   XmlPullParser::Event XmlPullParser::next()
+   {
+      if ( emptyElementPending_ )
+      {
+         emptyElementPending_ = false;
+         rootEnded_ = openElements_.empty();
+
+         return EndElement;
+      }
+
+      while ( pos_ < end_ )
+      {
+         if ( *pos_ != '<' )
+         {
+            const char *textEnd = static_cast<const char *>( std::memchr( pos_, '<', end_ - pos_ ) );
+
+            if ( textEnd == nullptr )
+            {
+               textEnd = end_;
+            }
+
+            if ( openElements_.empty() )
+            {
+               /// Only whitespace is allowed outside the root element, e.g. the padding of the XML section
+               for ( const char *p = pos_; p < textEnd; ++p )
+               {
+                  if ( !isWhitespace( *p ) )
+                  {
+                     fail( p, "text outside of the root element" );
+                  }
+               }
+
+               pos_ = textEnd;
+               continue;
+            }
+
+            text_.clear();
+            appendText( pos_, textEnd, CONTENT, text_ );
+            pos_ = textEnd;
+
+            return Characters;
+         }
+
+         if ( startsWith( "<?" ) )
+         {
+            skipProcessingInstruction();
+         }
+         else if ( startsWith( "<!--" ) )
+         {
+            skipComment();
+         }
+         else if ( startsWith( "<![CDATA[" ) )
+         {
+            if ( openElements_.empty() )
+            {
+               fail( pos_, "CDATA section outside of the root element" );
+            }
+
+            const char *cdataBegin = pos_ + 9;
+            const char *cdataEnd = findString( cdataBegin, end_, "]]>" );
+
+            if ( cdataEnd == nullptr )
+            {
+               fail( pos_, "unterminated CDATA section" );
+            }
+
+            text_.clear();
+            appendText( cdataBegin, cdataEnd, CDATA, text_ );
+            pos_ = cdataEnd + 3;
+
+            return Characters;
+         }
+         else if ( startsWith( "<!" ) )
+         {
+            fail( pos_, "document type declarations are not supported" );
+         }
+         else if ( startsWith( "</" ) )
+         {
+            return endTag();
+         }
+         else
+         {
+            return startTag();
+         }
+      }
+
+      if ( !openElements_.empty() )
+      {
+         fail( pos_, "document ended inside element " + openElements_.back() );
+      }
+
+      if ( !rootEnded_ && !isFragment_ )
+      {
+         fail( pos_, "document has no root element" );
+      }
+
+      return EndDocument;
+   }
+
+   const ustring &XmlPullParser::qName() const
+   {
+      return qName_;
+   }
+
+   const ustring &XmlPullParser::localName() const
+   {
+      return localName_;
+   }
+
+   const XmlAttributeList &XmlPullParser::attributes() const
+   {
+      return attributes_;
+   }
+
+   const ustring &XmlPullParser::text() const
+   {
+      return text_;
+   }
+
+   size_t XmlPullParser::offset() const
+   {
+      return pos_ - begin_;
+   }
+
+   void XmlPullParser::skipContent()
+   {
+      if ( emptyElementPending_ )
+      {
+         return;
+      }
+
+      /// Elements started in the skipped content
+      size_t depth = 0;
+
+      while ( true )
+      {
+         const char *tag = static_cast<const char *>( std::memchr( pos_, '<', end_ - pos_ ) );
+
+         if ( tag == nullptr )
+         {
+            fail( end_, "document ended inside element " + openElements_.back() );
+         }
+
+         pos_ = tag;
+
+         if ( startsWith( "<!--" ) )
+         {
+            skipComment();
+         }
+         else if ( startsWith( "<![CDATA[" ) )
+         {
+            const char *cdataEnd = findString( pos_ + 9, end_, "]]>" );
+
+            if ( cdataEnd == nullptr )
+            {
+               fail( pos_, "unterminated CDATA section" );
+            }
+
+            pos_ = cdataEnd + 3;
+         }
+         else if ( startsWith( "<?" ) )
+         {
+            skipProcessingInstruction();
+         }
+         else if ( startsWith( "</" ) )
+         {
+            if ( depth == 0 )
+            {
+               return;
+            }
+
+            --depth;
+
+            const char *tagEnd = static_cast<const char *>( std::memchr( pos_, '>', end_ - pos_ ) );
+
+            if ( tagEnd == nullptr )
+            {
+               fail( pos_, "unterminated end tag" );
+            }
+
+            pos_ = tagEnd + 1;
+         }
+         else
+         {
+            /// Find the end of the start tag, '>' may be in attribute values
+            const char *p = pos_ + 1;
+            char quote = 0;
+
+            for ( ; p < end_; ++p )
+            {
+               if ( quote != 0 )
+               {
+                  if ( *p == quote )
+                  {
+                     quote = 0;
+                  }
+               }
+               else if ( ( *p == '"' ) || ( *p == '\'' ) )
+               {
+                  quote = *p;
+               }
+               else if ( *p == '>' )
+               {
+                  break;
+               }
+            }
+
+            if ( p == end_ )
+            {
+               fail( pos_, "unterminated start tag" );
+            }
+
+            if ( p[-1] != '/' )
+            {
+               ++depth;
+            }
+
+            pos_ = p + 1;
+         }
+      }
+   }
+
+   XmlPullParser::Event XmlPullParser::startTag()
+   {
+      if ( rootEnded_ && !isFragment_ )
+      {
+         fail( pos_, "element after the root element" );
+      }
+
+      ++pos_;
+      parseName( qName_ );
+      setLocalName( qName_, localName_ );
+
+      size_t count = 0;
+
+      while ( true )
+      {
+         const bool hadWhitespace = skipWhitespace();
+
+         if ( pos_ >= end_ )
+         {
+            fail( pos_, "unterminated start tag of element " + qName_ );
+         }
+
+         if ( *pos_ == '>' )
+         {
+            ++pos_;
+            break;
+         }
+
+         if ( startsWith( "/>" ) )
+         {
+            pos_ += 2;
+            emptyElementPending_ = true;
+            break;
+         }
+
+         if ( !hadWhitespace )
+         {
+            fail( pos_, "missing whitespace before attribute of element " + qName_ );
+         }
+
+         if ( count == attributes_.size() )
+         {
+            attributes_.emplace_back();
+         }
+
+         XmlAttribute &attribute = attributes_[count++];
+
+         parseName( attribute.qName );
+         skipWhitespace();
+
+         if ( ( pos_ >= end_ ) || ( *pos_ != '=' ) )
+         {
+            fail( pos_, "missing '=' after attribute " + attribute.qName );
+         }
+
+         ++pos_;
+         skipWhitespace();
+         parseAttributeValue( attribute.value );
+
+         for ( size_t i = 0; i + 1 < count; ++i )
+         {
+            if ( attributes_[i].qName == attribute.qName )
+            {
+               fail( pos_, "duplicate attribute " + attribute.qName );
+            }
+         }
+
+         /// Only prefixed declarations get the xmlns URI, so "xmlns" itself declares the default namespace
+         if ( attribute.qName.compare( 0, 6, "xmlns:" ) == 0 )
+         {
+            attribute.uri = XMLNS_URI;
+         }
+         else
+         {
+            attribute.uri.clear();
+         }
+
+         setLocalName( attribute.qName, attribute.localName );
+      }
+
+      attributes_.resize( count );
+
+      /// An empty element is never open, next() returns its EndElement right away
+      if ( !emptyElementPending_ )
+      {
+         openElements_.push_back( qName_ );
+      }
+
+      return StartElement;
+   }
+
+   XmlPullParser::Event XmlPullParser::endTag()
+   {
+      const char *tagBegin = pos_;
+
+      pos_ += 2;
+      parseName( qName_ );
+      skipWhitespace();
+
+      if ( ( pos_ >= end_ ) || ( *pos_ != '>' ) )
+      {
+         fail( pos_, "unterminated end tag of element " + qName_ );
+      }
+
+      ++pos_;
+
+      if ( openElements_.empty() || ( openElements_.back() != qName_ ) )
+      {
+         fail( tagBegin, "end tag of element " + qName_ + " doesn't match its start tag" );
+      }
+
+      openElements_.pop_back();
+      rootEnded_ = openElements_.empty();
+      setLocalName( qName_, localName_ );
+
+      return EndElement;
+   }
+
+   void XmlPullParser::skipProcessingInstruction()
+   {
+      const char *piBegin = pos_ + 2;
+      const char *piEnd = findString( piBegin, end_, "?>" );
+
+      if ( piEnd == nullptr )
+      {
+         fail( pos_, "unterminated processing instruction" );
+      }
+
+      /// The XML declaration may only declare UTF-8
+      if ( ( piEnd - piBegin > 3 ) && ( std::memcmp( piBegin, "xml", 3 ) == 0 ) && isWhitespace( piBegin[3] ) )
+      {
+         const ustring declaration( piBegin, piEnd );
+         const size_t encoding = declaration.find( "encoding" );
+
+         if ( encoding != ustring::npos )
+         {
+            const size_t quote = declaration.find_first_of( "\"'", encoding );
+            const size_t quoteEnd =
+               ( quote == ustring::npos ) ? ustring::npos : declaration.find( declaration[quote], quote + 1 );
+
+            if ( quoteEnd == ustring::npos )
+            {
+               fail( pos_, "malformed XML declaration" );
+            }
+
+            ustring name = declaration.substr( quote + 1, quoteEnd - quote - 1 );
+
+            std::transform( name.begin(), name.end(), name.begin(), ::toupper );
+
+            if ( ( name != "UTF-8" ) && ( name != "UTF8" ) )
+            {
+               fail( pos_, "unsupported encoding " + declaration.substr( quote + 1, quoteEnd - quote - 1 ) );
+            }
+         }
+      }
+
+      pos_ = piEnd + 2;
+   }
+
+   void XmlPullParser::skipComment()
+   {
+      const char *commentEnd = findString( pos_ + 4, end_, "-->" );
+
+      if ( commentEnd == nullptr )
+      {
+         fail( pos_, "unterminated comment" );
+      }
+
+      pos_ = commentEnd + 3;
+   }
+
+   void XmlPullParser::parseName( ustring &name )
+   {
+      const char *nameBegin = pos_;
+
+      if ( ( pos_ >= end_ ) || !isNameStartChar( *pos_ ) )
+      {
+         fail( pos_, "expected a name" );
+      }
+
+      while ( ( pos_ < end_ ) && isNameChar( *pos_ ) )
+      {
+         ++pos_;
+      }
+
+      name.assign( nameBegin, pos_ );
+   }
+
+   void XmlPullParser::parseAttributeValue( ustring &value )
+   {
+      if ( ( pos_ >= end_ ) || ( ( *pos_ != '"' ) && ( *pos_ != '\'' ) ) )
+      {
+         fail( pos_, "expected a quoted attribute value" );
+      }
+
+      const char quote = *pos_++;
+      const char *valueEnd = static_cast<const char *>( std::memchr( pos_, quote, end_ - pos_ ) );
+
+      if ( valueEnd == nullptr )
+      {
+         fail( pos_, "unterminated attribute value" );
+      }
+
+      value.clear();
+      appendText( pos_, valueEnd, ATTRIBUTE_VALUE, value );
+      pos_ = valueEnd + 1;
+   }
+
+   void XmlPullParser::appendText( const char *begin, const char *end, TextKind kind, ustring &out ) const
+   {
+      /// Unchanged characters are appended in runs
+      const char *run = begin;
+      const char *p = begin;
+
+      while ( p < end )
+      {
+         const unsigned char c = static_cast<unsigned char>( *p );
+
+         if ( c >= 0x80 )
+         {
+            const size_t length = utf8SequenceLength( p, end );
+
+            if ( length == 0 )
+            {
+               fail( p, "invalid UTF-8" );
+            }
+
+            p += length;
+         }
+         else if ( ( c == '&' ) && ( kind != CDATA ) )
+         {
+            out.append( run, p );
+            p = appendReference( p, end, out );
+            run = p;
+         }
+         else if ( ( c == '<' ) && ( kind == ATTRIBUTE_VALUE ) )
+         {
+            fail( p, "'<' in attribute value" );
+         }
+         else if ( ( c == '\r' ) || ( ( kind == ATTRIBUTE_VALUE ) && ( ( c == '\n' ) || ( c == '\t' ) ) ) )
+         {
+            /// Line ends become \n, and whitespace in attribute values spaces
+            out.append( run, p );
+            out += ( kind == ATTRIBUTE_VALUE ) ? ' ' : '\n';
+
+            if ( ( c == '\r' ) && ( p + 1 < end ) && ( p[1] == '\n' ) )
+            {
+               ++p;
+            }
+
+            ++p;
+            run = p;
+         }
+         else if ( ( c < 0x20 ) && ( c != '\n' ) && ( c != '\t' ) )
+         {
+            fail( p, "control character " + toString( static_cast<unsigned>( c ) ) );
+         }
+         else
+         {
+            ++p;
+         }
+      }
+
+      out.append( run, end );
+   }
+
+   const char *XmlPullParser::appendReference( const char *p, const char *end, ustring &out ) const
+   {
+      const char *semicolon = static_cast<const char *>( std::memchr( p, ';', end - p ) );
+
+      if ( semicolon == nullptr )
+      {
+         fail( p, "unterminated reference" );
+      }
+
+      const char *name = p + 1;
+      const size_t length = semicolon - name;
+
+      if ( ( length >= 2 ) && ( name[0] == '#' ) )
+      {
+         const bool isHex = ( name[1] == 'x' );
+         const char *digit = name + ( isHex ? 2 : 1 );
+         uint32_t codePoint = 0;
+
+         if ( digit == semicolon )
+         {
+            fail( p, "empty character reference" );
+         }
+
+         for ( ; digit < semicolon; ++digit )
+         {
+            uint32_t value;
+
+            if ( ( *digit >= '0' ) && ( *digit <= '9' ) )
+            {
+               value = *digit - '0';
+            }
+            else if ( isHex && ( *digit >= 'a' ) && ( *digit <= 'f' ) )
+            {
+               value = *digit - 'a' + 10;
+            }
+            else if ( isHex && ( *digit >= 'A' ) && ( *digit <= 'F' ) )
+            {
+               value = *digit - 'A' + 10;
+            }
+            else
+            {
+               fail( p, "malformed character reference " + ustring( p, semicolon + 1 ) );
+            }
+
+            codePoint = codePoint * ( isHex ? 16 : 10 ) + value;
+
+            if ( codePoint > 0x10FFFF )
+            {
+               fail( p, "character reference out of range " + ustring( p, semicolon + 1 ) );
+            }
+         }
+
+         /// Control characters other than whitespace, and surrogates, aren't XML characters
+         if ( ( ( codePoint < 0x20 ) && ( codePoint != '\t' ) && ( codePoint != '\n' ) && ( codePoint != '\r' ) ) ||
+              ( ( codePoint >= 0xD800 ) && ( codePoint <= 0xDFFF ) ) )
+         {
+            fail( p, "character reference out of range " + ustring( p, semicolon + 1 ) );
+         }
+
+         appendUtf8( codePoint, out );
+      }
+      else if ( ( length == 2 ) && ( std::memcmp( name, "lt", 2 ) == 0 ) )
+      {
+         out += '<';
+      }
+      else if ( ( length == 2 ) && ( std::memcmp( name, "gt", 2 ) == 0 ) )
+      {
+         out += '>';
+      }
+      else if ( ( length == 3 ) && ( std::memcmp( name, "amp", 3 ) == 0 ) )
+      {
+         out += '&';
+      }
+      else if ( ( length == 4 ) && ( std::memcmp( name, "quot", 4 ) == 0 ) )
+      {
+         out += '"';
+      }
+      else if ( ( length == 4 ) && ( std::memcmp( name, "apos", 4 ) == 0 ) )
+      {
+         out += '\'';
+      }
+      else
+      {
+         fail( p, "unknown entity reference " + ustring( p, semicolon + 1 ) );
+      }
+
+      return semicolon + 1;
+   }
+
+   bool XmlPullParser::skipWhitespace()
+   {
+      const char *start = pos_;
+
+      while ( ( pos_ < end_ ) && isWhitespace( *pos_ ) )
+      {
+         ++pos_;
+      }
+
+      return pos_ != start;
+   }
+
+   bool XmlPullParser::startsWith( const char *s ) const
+   {
+      const size_t length = std::strlen( s );
+
+      return ( static_cast<size_t>( end_ - pos_ ) >= length ) && ( std::memcmp( pos_, s, length ) == 0 );
+   }
+
+   void XmlPullParser::fail( const char *p, const ustring &message ) const
+   {
+      /// Lines and columns are only needed for errors, so they aren't tracked while parsing
+      const char *at = std::min( p, end_ );
+      const char *lineBegin = begin_;
+      size_t line = 1;
+
+      for ( const char *c = begin_; c < at; ++c )
+      {
+         if ( *c == '\n' )
+         {
+            ++line;
+            lineBegin = c + 1;
+         }
+      }
+
+      throw E57_EXCEPTION2( E57_ERROR_XML_PARSER, "xmlLine=" + toString( line ) +
+                                                     " xmlColumn=" + toString( at - lineBegin + 1 ) +
+                                                     " parserMessage=" + message );
+   }
+} // end namespace e57
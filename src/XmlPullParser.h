@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+
+namespace e57
+{
+   /// An attribute of an XML start tag, all strings UTF-8
+   struct XmlAttribute
+   {
+      ustring uri; /// "http://www.w3.org/2000/xmlns/" for prefixed namespace declarations, empty otherwise
+      ustring localName;
+      ustring qName;
+      ustring value;
+   };
+
+   using XmlAttributeList = std::vector<XmlAttribute>;
+
+   /// Non-validating pull parser of the subset of XML used by E57 files: UTF-8 elements and attributes, character
+   /// data, CDATA sections, predefined entity and character references, comments and processing instructions.
+   /// Document type declarations are rejected.
+   class XmlPullParser
+   {
+   public:
+      enum Event
+      {
+         StartElement,
+         EndElement,
+         Characters,
+         EndDocument
+      };
+
+      /// The data must outlive the parser, or the next reset(). A fragment is the content of an element, any number
+      /// of elements instead of one root.
+      XmlPullParser( const char *data, size_t size, bool isFragment = false );
+
+      /// Start parsing other data, keeping the capacity of the strings
+      void reset( const char *data, size_t size, bool isFragment = false );
+
+      XmlPullParser( const XmlPullParser & ) = delete;
+      XmlPullParser &operator=( const XmlPullParser & ) = delete;
+
+      Event next();
+
+      /// Names of the element of the last StartElement or EndElement
+      const ustring &qName() const;
+      const ustring &localName() const;
+
+      /// Attributes of the last StartElement
+      const XmlAttributeList &attributes() const;
+
+      /// Text of the last Characters, with references replaced and line ends normalized
+      const ustring &text() const;
+
+      /// Byte offset of the parser in the data
+      size_t offset() const;
+
+      /// After a StartElement, moves to the end tag of the element without parsing its content, which isn't checked
+      /// either. The next event is its EndElement.
+      void skipContent();
+
+   private:
+      enum TextKind
+      {
+         CONTENT,
+         ATTRIBUTE_VALUE,
+         CDATA
+      };
+
+      Event startTag();
+      Event endTag();
+      void skipProcessingInstruction();
+      void skipComment();
+      void parseName( ustring &name );
+      void parseAttributeValue( ustring &value );
+      void appendText( const char *begin, const char *end, TextKind kind, ustring &out ) const;
+      const char *appendReference( const char *p, const char *end, ustring &out ) const;
+      bool skipWhitespace();
+      bool startsWith( const char *s ) const;
+
+      /// Throws E57_ERROR_XML_PARSER with the line and column of p
+      void fail( const char *p, const ustring &message ) const;
+
+      const char *begin_;
+      const char *pos_;
+      const char *end_;
+
+      std::vector<ustring> openElements_; /// qNames of the elements not yet ended, outermost first
+      bool isFragment_ = false;
+      bool rootEnded_ = false;
+      bool emptyElementPending_ = false; /// the last start tag was <name/>, so its EndElement comes next
+
+      ustring qName_;
+      ustring localName_;
+      XmlAttributeList attributes_; /// reused between start tags, so its strings keep their capacity
+      ustring text_;
+   };
+} // end namespace e57
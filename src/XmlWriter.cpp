@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "XmlWriter.h"
+
+namespace e57
+{
+   /// Most files have small XML sections, larger ones grow the buffer geometrically
+   constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+
+   XmlWriter::XmlWriter()
+   {
+      buffer_.reserve( INITIAL_CAPACITY );
+   }
+
+   XmlWriter &XmlWriter::operator<<( const char *s )
+   {
+      append( s, std::strlen( s ) );
+      return *this;
+   }
+
+   XmlWriter &XmlWriter::operator<<( const ustring &s )
+   {
+      append( s.data(), s.length() );
+      return *this;
+   }
+
+   XmlWriter &XmlWriter::operator<<( int64_t i )
+   {
+      /// Negate as unsigned, so E57_INT64_MIN works too
+      if ( i < 0 )
+      {
+         append( "-", 1 );
+         return *this << ( ~static_cast<uint64_t>( i ) + 1 );
+      }
+
+      return *this << static_cast<uint64_t>( i );
+   }
+
+   XmlWriter &XmlWriter::operator<<( uint64_t i )
+   {
+      char digits[20];
+      char *end = digits + sizeof( digits );
+      char *p = end;
+
+      do
+      {
+         *--p = static_cast<char>( '0' + i % 10 );
+         i /= 10;
+      } while ( i != 0 );
+
+      append( p, static_cast<size_t>( end - p ) );
+      return *this;
+   }
+
+   XmlWriter &XmlWriter::operator<<( float f )
+   {
+      /// 9 significant digits always round trip a float
+      return writeFloatingPoint( f, 6, 9 );
+   }
+
+   XmlWriter &XmlWriter::operator<<( double d )
+   {
+      /// 17 significant digits always round trip a double
+      return writeFloatingPoint( d, 15, 17 );
+   }
+
+   const char *XmlWriter::data() const
+   {
+      return buffer_.data();
+   }
+
+   size_t XmlWriter::size() const
+   {
+      return buffer_.size();
+   }
+
+   void XmlWriter::append( const char *s, size_t length )
+   {
+      buffer_.append( s, length );
+   }
+
+   /// Write the fewest significant digits that read back as the same value, e.g. 0.1 rather than
+   /// 1.00000000000000006e-01
+   template <class FTYPE> XmlWriter &XmlWriter::writeFloatingPoint( FTYPE value, int minPrecision, int maxPrecision )
+   {
+      char text[32];
+      int length = 0;
+
+      for ( int precision = minPrecision; precision <= maxPrecision; ++precision )
+      {
+         length = std::snprintf( text, sizeof( text ), "%.*g", precision, static_cast<double>( value ) );
+
+         /// Read back the way E57XmlParser does
+         if ( static_cast<FTYPE>( std::strtod( text, nullptr ) ) == value )
+         {
+            break;
+         }
+      }
+
+      /// snprintf() and strtod() follow the C locale, but XML needs a '.'
+      const char decimalPoint = *std::localeconv()->decimal_point;
+      if ( decimalPoint != '.' )
+      {
+         std::replace( text, text + length, decimalPoint, '.' );
+      }
+
+      append( text, static_cast<size_t>( length ) );
+      return *this;
+   }
+} // end namespace e57
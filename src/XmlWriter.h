@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: BSL-1.0
+
+#pragma once
+
+#include "Common.h"
+
+namespace e57
+{
+   /// Formats the XML section in memory, so ImageFileImpl::close() can write it to the file in one piece instead of
+   /// a page read-modify-write and checksum for every fragment
+   class XmlWriter
+   {
+   public:
+      XmlWriter();
+
+      XmlWriter &operator<<( const char *s );
+      XmlWriter &operator<<( const ustring &s );
+      XmlWriter &operator<<( int64_t i );
+      XmlWriter &operator<<( uint64_t i );
+      XmlWriter &operator<<( float f );
+      XmlWriter &operator<<( double d );
+
+      const char *data() const;
+      size_t size() const;
+
+   private:
+      void append( const char *s, size_t length );
+      template <class FTYPE> XmlWriter &writeFloatingPoint( FTYPE value, int minPrecision, int maxPrecision );
+
+      ustring buffer_;
+   };
+} // end namespace e57